@@ -3,12 +3,7 @@
 
 #include <cstdint>
 #include <cstdlib>
-
-struct RadioPacket
-{
-    uint8_t data[255];
-    size_t len;
-};
+#include "framePool.h"
 
 /**
  * @brief IRadioManager Interface
@@ -24,6 +19,20 @@ public:
     virtual bool enqueueTxPacket(const uint8_t *data, size_t len) = 0;
     virtual bool enqueueRxPacket(const uint8_t *data, size_t len) = 0;
     virtual bool dequeueRxPacket(RadioPacket **packet) = 0;
+
+    /**
+     * @brief Queue a FramePool frame for transmission without copying it.
+     *
+     * Takes over the caller's reference whether or not it succeeds. The
+     * default copies through enqueueTxPacket for radios that keep their own
+     * buffers.
+     */
+    virtual bool enqueueTxFrame(RadioPacket *frame)
+    {
+        bool ok = enqueueTxPacket(frame->data, frame->len);
+        FramePool::instance().release(frame);
+        return ok;
+    }
 };
 
-#endif
\ No newline at end of file
+#endif
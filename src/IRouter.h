@@ -22,6 +22,8 @@ public:
     virtual bool haveGateway() const = 0;
     virtual void addPubKey(uint32_t userID, std::array<uint8_t, 32>) = 0;
     virtual void sendMoveUserReq(uint32_t userID, uint32_t oldNodeID) = 0;
+    // local users joined or left; routers that announce them can do so early
+    virtual void userSessionsChanged() {}
 };
 
 #endif
\ No newline at end of file
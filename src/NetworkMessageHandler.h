@@ -55,6 +55,9 @@ public:
 
     void announcePubKey(uint32_t userID, const uint8_t pk[32]);
 
+    // a local user joined or left; tell the rest of the mesh early
+    void userSessionsChanged() { _router->userSessionsChanged(); }
+
     std::vector<uint32_t> getKnownNodes() const
     {
         return _router->getKnownNodeIDs();
@@ -1,11 +1,16 @@
-#include "AODVRouter.h"
+#include "aodvRouter.h"
 #include <Arduino.h>
 #include <gatewayManager.h>
-#include "DisplayManager.h"
+#include <DisplayManager.h>
 extern DisplayManager displayManager;
 
 static const uint8_t MAX_HOPS = 5; // TODO: need to adjusted
 
+static inline bool routeExpired(const RouteEntry &re, TickType_t now)
+{
+    return (int32_t)(now - re.expiresAt) >= 0;
+}
+
 AODVRouter::AODVRouter(IRadioManager *radioManager, MQTTManager *MQTTManager, uint32_t myNodeID, UserSessionManager *usm, IClientNotifier *icm)
     : _radioManager(radioManager), _mqttManager(MQTTManager), _myNodeID(myNodeID), _routerTaskHandler(nullptr), _usm(usm), _clientNotifier(icm)
 {
@@ -16,11 +21,37 @@ AODVRouter::AODVRouter(IRadioManager *radioManager, MQTTManager *MQTTManager, ui
     // Create gatway structs mutex
     _gwMtx = xSemaphoreCreateRecursiveMutex();
     configASSERT(_gwMtx);
+
+    // Random start so a rebooted node lands outside its old window rather than inside it
+    _originSeq = (uint16_t)esp_random();
+
+    _timers.clear(xTaskGetTickCount());
+}
+
+AODVRouter::~AODVRouter()
+{
+    Lock l(_mutex);
+    for (auto &kv : ackBuffer)
+        FramePool::instance().release(kv.second.frame);
+    ackBuffer.clear();
+    for (auto &kv : _repairFrames)
+        FramePool::instance().release(kv.second.second);
+    _repairFrames.clear();
 }
 
 // TODO: can the ifdef be removed?
 bool AODVRouter::begin()
 {
+    // the periodic work runs off the timer wheel like every other deadline
+    TickType_t now = xTaskGetTickCount();
+    {
+        Lock l(_mutex);
+        _trickle.start(now, esp_random());
+        _beaconTimer = armTimer(RouterTimer::Broadcast, 0, _trickle.nextEvent());
+    }
+    armTimer(RouterTimer::RoutePurge, 0, now + ROUTE_PURGE_PERIOD_TICKS);
+    armTimer(RouterTimer::NeighbourCheck, 0, now + NEIGHBOUR_CHECK_PERIOD_TICKS);
+
 #ifdef UNIT_TEST
     // For unit tests, skip task creation and assume initialisation is successful.
     // Serial.println("[AODVRouter] Run Begin");
@@ -53,53 +84,6 @@ bool AODVRouter::begin()
         3,
         &_timerWorkerHandle);
 
-    /*
-
-    Create a software timer to send the broadcast every hour.
-
-    FreeRTOS is written in C, therefore the callback is declared static as it cannot be a
-    member function. As it is not a member function it does not have a this pointer. Therefore,
-    to ensure the pvTimerID is set to the pointer to this
-    */
-    _broadcastTimer = xTimerCreate(
-        "BroadcastTimer",
-        pdMS_TO_TICKS(60000),    // 900000ms = 15 minute
-        pdTRUE,                  // Auto-reload for periodic execution
-        (void *)this,            // Pass the current router instance as timer ID
-        broadcastTimerCallback); // Callback to send broadcast info
-
-    if (_broadcastTimer == nullptr)
-    {
-        Serial.println("[AODVRouter] Failed to create broadcast timer");
-    }
-    else
-    {
-        if (xTimerStart(_broadcastTimer, 0) != pdPASS)
-        {
-            Serial.println("[AODVRouter] Failed to start broadcast timer");
-        }
-    }
-
-    _ackBufferCleanupTimer = xTimerCreate(
-        "AckCleanupTimer",
-        ACK_CLEANUP_PERIOD_TICKS, // runs every minute
-        pdTRUE,                   // Auto-reload for periodic execution
-        (void *)this,             // Pass the current router instance as timer ID
-        ackCleanupCallback        // Callback to perform ack cleanup
-    );
-
-    if (_ackBufferCleanupTimer == nullptr)
-    {
-        Serial.println("[AODVRouter] Failed to create ack cleanup timer");
-    }
-    else
-    {
-        if (xTimerStart(_ackBufferCleanupTimer, 0) != pdPASS)
-        {
-            Serial.println("[AODVRouter] Failed to start ack cleanup timer");
-        }
-    }
-
     return true;
 #endif
 }
@@ -117,30 +101,34 @@ void AODVRouter::routerTask(void *pvParameters)
         if (router->_radioManager->dequeueRxPacket(&packet))
         {
             router->handlePacket(packet);
-            vPortFree(packet);
+            FramePool::instance().release(packet);
+            // a lookup on the way may have found a route expired, or made room for a new one
+            router->flushDroppedRoutes();
         }
     }
 }
 
-// worker task simply waits for notifications and dispatches
+// worker task sleeps until the next deadline on the wheel, or until an earlier one is armed
 void AODVRouter::timerWorkerTask(void *pv)
 {
     AODVRouter *self = static_cast<AODVRouter *>(pv);
     uint32_t bits;
     for (;;)
     {
-        // Block until either bit is set
+        self->runTimers();
+
+        TickType_t wait = portMAX_DELAY;
+        TickType_t at;
+        if (self->nextTimerDeadline(at))
+        {
+            int32_t left = (int32_t)(at - xTaskGetTickCount());
+            wait = left > 0 ? (TickType_t)left : 0;
+        }
         xTaskNotifyWait(
             0,           // clear on entry
             0xFFFFFFFFu, // clear on exit
             &bits,
-            portMAX_DELAY);
-
-        if (bits & BROADCAST_NOTIFY_BIT)
-            self->sendBroadcastInfo();
-
-        if (bits & CLEANUP_NOTIFY_BIT)
-            self->cleanupAckBuffer();
+            wait);
     }
 }
 #endif
@@ -161,69 +149,209 @@ void AODVRouter::sendBroadcastInfo()
     bh.hopCount = 0;
     bh.reserved = 0;
 
+    {
+        Lock l(_mutex);
+        _lastBeaconAt = xTaskGetTickCount();
+        _lastBeaconGateway = bh.flags == I_AM_GATEWAY;
+        _beaconDirty = false;
+    }
+
     std::vector<uint32_t> added, removed;
     _usm->getAndClearDiff(added, removed);
 
-    constexpr size_t MAX_BUF = 255;
+    // our neighbours for the trailer, the MPRs we picked from them first
+    std::vector<uint32_t> oneHop;
+    selectMprs(oneHop);
+    std::vector<uint32_t> advertised;
+    {
+        Lock l(_mutex);
+        advertised = _neighbourhood.mprs();
+    }
+    size_t numMprs = std::min(advertised.size(), (size_t)MPR_MAX_ADVERTISED);
+    for (uint32_t n : oneHop)
+    {
+        if (std::find(advertised.begin(), advertised.end(), n) == advertised.end())
+            advertised.push_back(n);
+    }
+    if (advertised.size() > MPR_MAX_ADVERTISED)
+        advertised.resize(MPR_MAX_ADVERTISED);
+    bool withList;
+    {
+        Lock l(_mutex);
+        withList = _neighbourhood.advertise(advertised, (uint8_t)numMprs);
+    }
+    if (!withList)
+        advertised.clear();
+
+    constexpr size_t MAX_BUF = sizeof(RadioPacket::data);
     constexpr size_t BASE_HDR = sizeof(BaseHeader);
     constexpr size_t DIFF_HDR = sizeof(DiffBroadcastInfoHeader);
-    constexpr size_t SPACE = MAX_BUF - BASE_HDR - DIFF_HDR;
+    constexpr size_t SPACE = MAX_BUF - BASE_HDR - DIFF_HDR - TAG_LEN;
     constexpr size_t IDS_PER_PKT = SPACE / sizeof(uint32_t);
+    constexpr size_t TRAILER_IDS = (sizeof(NeighbourListHeader) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    static_assert(IDS_PER_PKT >= MPR_MAX_ADVERTISED + TRAILER_IDS, "neighbour list must fit one BROADCAST_INFO");
 
     // TODO edit the code below to contain a new flag to signify that this node is a gateway in the periodic broadcast
 
+    // the first frame carries the neighbour list, if it goes out this time,
+    // after its user IDs; send at least that one even when no users changed
     size_t idxA = 0, idxR = 0;
-    if (added.empty() && removed.empty())
+    bool first = true;
+    while (first || idxA < added.size() || idxR < removed.size())
     {
+        size_t capacity = first && withList ? IDS_PER_PKT - advertised.size() - TRAILER_IDS : IDS_PER_PKT;
+        size_t numA = std::min(capacity, added.size() - idxA);
+        size_t remaining = capacity - numA;
+        size_t numR = remaining == 0 ? 0 : std::min(remaining, removed.size() - idxR);
+
         DiffBroadcastInfoHeader dh;
-        dh.numAdded = 0;
-        dh.numRemoved = 0;
+        dh.numAdded = uint16_t(numA);
+        dh.numRemoved = uint16_t(numR);
+        // no longer need the originNode here included in the baseHeader
 
-        transmitPacket(bh, reinterpret_cast<const uint8_t *>(&dh), DIFF_HDR);
-    }
-    else
-    {
+        std::vector<uint8_t> payload;
+        payload.reserve((numA + numR + advertised.size()) * sizeof(uint32_t) + sizeof(NeighbourListHeader));
 
-        while (idxA < added.size() || idxR < removed.size())
+        // first the added IDs
+        for (size_t i = 0; i < numA; ++i)
+        {
+            uint32_t uid = added[idxA + i];
+            auto p = reinterpret_cast<const uint8_t *>(&uid);
+            payload.insert(payload.end(), p, p + sizeof(uid));
+        }
+        // then the removed IDs
+        for (size_t i = 0; i < numR; ++i)
         {
+            uint32_t uid = removed[idxR + i];
+            auto p = reinterpret_cast<const uint8_t *>(&uid);
+            payload.insert(payload.end(), p, p + sizeof(uid));
+        }
+        // then, once, our neighbours
+        if (first && withList)
+        {
+            NeighbourListHeader nh;
+            nh.numNeighbours = uint8_t(advertised.size());
+            nh.numMprs = uint8_t(numMprs);
+            size_t at = payload.size();
+            payload.resize(at + sizeof(nh) + advertised.size() * sizeof(uint32_t));
+            at = serialiseNeighbourListHeader(nh, payload.data(), at);
+            memcpy(payload.data() + at, advertised.data(), advertised.size() * sizeof(uint32_t));
+        }
 
-            size_t numA = std::min(IDS_PER_PKT, added.size() - idxA);
-            size_t remaining = IDS_PER_PKT - numA;
-            size_t numR = remaining == 0 ? 0 : std::min(remaining, removed.size() - idxR);
+        transmitPacket(
+            bh,
+            reinterpret_cast<const uint8_t *>(&dh), DIFF_HDR,
+            payload.data(), payload.size());
 
-            DiffBroadcastInfoHeader dh;
-            dh.numAdded = uint16_t(numA);
-            dh.numRemoved = uint16_t(numR);
-            // no longer need the originNode here included in the baseHeader
+        idxA += numA;
+        idxR += numR;
+        first = false;
+    }
+    Serial.println("Send broadcastInfo");
+}
 
-            std::vector<uint8_t> payload;
-            payload.reserve((numA + numR) * sizeof(uint32_t));
+void AODVRouter::onBeaconTimer()
+{
+    bool gateway = _gwMgr && _gwMgr->isOnline(); // before _mutex: lock order
+    bool send = false;
+    {
+        Lock l(_mutex);
+        TickType_t now = xTaskGetTickCount();
+        switch (_trickle.fire(now, esp_random()))
+        {
+        case TrickleAction::Transmit:
+            send = true;
+            break;
+        case TrickleAction::Suppress:
+            // neighbours' beacons say nothing about our users, our gateway
+            // state, or routes to us – those still have to go out
+            send = _beaconDirty || gateway != _lastBeaconGateway ||
+                   now - _lastBeaconAt >= BEACON_MAX_SILENCE_TICKS;
+            break;
+        case TrickleAction::None:
+            break;
+        }
+        _beaconTimer = armTimer(RouterTimer::Broadcast, 0, _trickle.nextEvent());
+    }
+    if (send)
+        sendBroadcastInfo();
+}
 
-            // first the added IDs
-            for (size_t i = 0; i < numA; ++i)
-            {
-                uint32_t uid = added[idxA + i];
-                auto p = reinterpret_cast<const uint8_t *>(&uid);
-                payload.insert(payload.end(), p, p + sizeof(uid));
-            }
-            // then the removed IDs
-            for (size_t i = 0; i < numR; ++i)
-            {
-                uint32_t uid = removed[idxR + i];
-                auto p = reinterpret_cast<const uint8_t *>(&uid);
-                payload.insert(payload.end(), p, p + sizeof(uid));
-            }
+void AODVRouter::resetBeacon()
+{
+    Lock l(_mutex);
+    if (!_trickle.reset(xTaskGetTickCount(), esp_random()))
+        return; // already at Imin, the next beacon is near anyway
+    _timers.cancel(_beaconTimer);
+    _beaconTimer = armTimer(RouterTimer::Broadcast, 0, _trickle.nextEvent());
+}
 
-            transmitPacket(
-                bh,
-                reinterpret_cast<const uint8_t *>(&dh), DIFF_HDR,
-                payload.data(), payload.size());
+bool AODVRouter::selectMprs(std::vector<uint32_t> &oneHop)
+{
+    Lock l(_mutex);
+    oneHop.clear();
+    _routeTable.forEach([&](uint32_t dest, const RouteEntry &re)
+                        {
+                            if (re.hopcount == 1)
+                                oneHop.push_back(dest);
+                        });
+    // a neighbour we route to over a cheaper detour is still a neighbour
+    _links.forEach([&](uint32_t n, const LinkQuality &)
+                   { oneHop.push_back(n); });
+    std::sort(oneHop.begin(), oneHop.end());
+    oneHop.erase(std::unique(oneHop.begin(), oneHop.end()), oneHop.end());
+    return _neighbourhood.select(oneHop, _myNodeID);
+}
 
-            idxA += numA;
-            idxR += numR;
-        }
+void AODVRouter::userSessionsChanged()
+{
+    {
+        Lock l(_mutex);
+        _beaconDirty = true;
     }
-    Serial.println("Send broadcastInfo");
+    resetBeacon();
+}
+
+void AODVRouter::setTrickleConfig(const TrickleConfig &cfg)
+{
+    Lock l(_mutex);
+    _trickle.configure(cfg);
+}
+
+TrickleStats AODVRouter::getBeaconStats() const
+{
+    Lock l(_mutex);
+    return _trickle.stats();
+}
+
+NeighbourhoodStats AODVRouter::getNeighbourhoodStats() const
+{
+    Lock l(_mutex);
+    return _neighbourhood.stats();
+}
+
+bool AODVRouter::getLinkQuality(uint32_t neighbour, LinkQuality &out) const
+{
+    Lock l(_mutex);
+    return _links.find(neighbour, out);
+}
+
+LinkEstimatorStats AODVRouter::getLinkStats() const
+{
+    Lock l(_mutex);
+    return _links.stats();
+}
+
+RouteBackupStats AODVRouter::getRouteBackupStats() const
+{
+    Lock l(_mutex);
+    return _backupStats;
+}
+
+RouteErrorStats AODVRouter::getRouteErrorStats() const
+{
+    Lock l(_mutex);
+    return _rerrStats;
 }
 
 // void AODVRouter::cleanupAckBuffer()
@@ -283,111 +411,296 @@ void AODVRouter::sendBroadcastInfo()
 //     }
 // }
 
-void AODVRouter::cleanupAckBuffer()
+void AODVRouter::runTimers()
 {
-    TickType_t now = xTaskGetTickCount();
-
-    /*  Entries that exceeded the retry budget get *moved* here (so we can
-        access the packet afterwards without holding the mutex).            */
-    std::vector<std::pair<uint32_t, ackBufferEntry>> expired;
-
+    std::vector<std::pair<RouterTimer, uint32_t>> due;
     {
-        Lock l(_mutex); // ── shortest possible critical section
+        Lock l(_mutex);
+        _timers.advance(xTaskGetTickCount(), [&](uint8_t kind, uint32_t key)
+                        {
+            if ((RouterTimer)kind == RouterTimer::PendingExpiry)
+                _pendingTimer = 0;
+            due.push_back({(RouterTimer)kind, key}); });
+    }
 
-        for (auto it = ackBuffer.begin(); it != ackBuffer.end();)
+    // run outside the lock: these transmit and notify
+    bool discoveries = false;
+    for (auto &t : due)
+    {
+        switch (t.first)
         {
-            ackBufferEntry &ent = it->second;
+        case RouterTimer::AckTimeout:
+            onAckTimeout(t.second);
+            break;
+        case RouterTimer::Discovery:
+            discoveries = true; // one pass covers every discovery that is due
+            break;
+        case RouterTimer::PendingExpiry:
+            expirePendingMessages();
+            break;
+        case RouterTimer::Broadcast:
+            onBeaconTimer();
+            break;
+        case RouterTimer::RoutePurge:
+            purgeExpiredRoutes();
+            armTimer(RouterTimer::RoutePurge, 0, xTaskGetTickCount() + ROUTE_PURGE_PERIOD_TICKS);
+            break;
+        case RouterTimer::NeighbourCheck:
+            checkNeighbours();
+            armTimer(RouterTimer::NeighbourCheck, 0, xTaskGetTickCount() + NEIGHBOUR_CHECK_PERIOD_TICKS);
+            break;
+        }
+    }
+    if (discoveries)
+        checkRouteDiscoveries();
+}
 
-            if (now - ent.timestamp < ACK_TIMEOUT_TICKS)
-            {
-                ++it; // still waiting
-                continue;
-            }
+bool AODVRouter::nextTimerDeadline(TickType_t &at) const
+{
+    Lock l(_mutex);
+    return _timers.nextDeadline(at);
+}
 
-            if (ent.attempts < MAX_RETRANS)
-            {
-                if (_radioManager->enqueueTxPacket(ent.packet, ent.length))
-                {
-                    ent.timestamp = now;
-                    ++ent.attempts;
-                    Serial.printf("[AODVRouter] Retry via %u for pkt %u (attempt %u)\n",
-                                  ent.expectedNextHop, it->first, ent.attempts);
-                }
-                ++it;
-            }
-            else
+TimerWheelStats AODVRouter::getTimerStats() const
+{
+    Lock l(_mutex);
+    return _timers.stats();
+}
+
+uint32_t AODVRouter::armTimer(RouterTimer kind, uint32_t key, TickType_t at)
+{
+    Lock l(_mutex);
+    TickType_t before;
+    bool had = _timers.nextDeadline(before);
+    uint32_t handle = _timers.schedule(at, (uint8_t)kind, key);
+    if (handle == 0)
+    {
+        Serial.printf("[AODVRouter] Timer wheel full, kind %u for %u not armed\n", (unsigned)kind, key);
+        return 0;
+    }
+    // the worker sleeps until `before`; wake it to re-plan if this comes first
+    if (_timerWorkerHandle && (!had || (int32_t)(at - before) < 0))
+        xTaskNotify(_timerWorkerHandle, TIMER_NOTIFY_BIT, eSetBits);
+    return handle;
+}
+
+void AODVRouter::onAckTimeout(uint32_t packetID)
+{
+    ackBufferEntry ent;
+    bool lost;
+    {
+        Lock l(_mutex); // ── shortest possible critical section
+        auto it = ackBuffer.find(packetID);
+        if (it == ackBuffer.end())
+            return; // acknowledged meanwhile
+
+        TickType_t now = xTaskGetTickCount();
+        ackBufferEntry &e = it->second;
+        // a next hop we know but have not heard a frame from since handing it this one is taken for gone
+        LinkQuality lq;
+        lost = e.attempts + 1 >= NEIGHBOUR_SILENT_ACK_TIMEOUTS && _links.find(e.expectedNextHop, lq) &&
+               (int32_t)(lq.lastHeard - e.firstSent) < 0;
+        if (!lost && e.attempts < MAX_RETRANS)
+        {
+            FramePool::instance().retain(e.frame);
+            if (_radioManager->enqueueTxFrame(e.frame))
             {
-                /*  Move the entry *out* of the map so we can use it after the
-                    lock — no copy of the packet buffer is made.            */
-                expired.emplace_back(it->first, std::move(ent));
-                it = ackBuffer.erase(it);
+                ++e.attempts;
+                Serial.printf("[AODVRouter] Retry via %u for pkt %u (attempt %u)\n",
+                              e.expectedNextHop, packetID, e.attempts);
             }
+            e.timestamp = now;
+            e.timer = armTimer(RouterTimer::AckTimeout, packetID, now + ACK_TIMEOUT_TICKS);
+            return;
         }
+
+        /*  Take the entry *out* of the map so we can use it after the
+            lock — no copy of the packet buffer is made.              */
+        ent = e;
+        ackBuffer.erase(it);
     } // ── mutex released here ───────────────────────────────────────────
 
-    /*  Now safe to do heavier work: craft RERRs and free memory.            */
-    for (auto &kv : expired)
+    if (lost)
     {
-        uint32_t pid = kv.first;
-        ackBufferEntry &ent = kv.second;
+        Serial.printf("[AODVRouter] Next hop %u silent since pkt %u was sent – rerouting\n", ent.expectedNextHop, packetID);
+        neighbourLost(ent.expectedNextHop);
+        rerouteFrame(packetID, ent);
+        return;
+    }
+    // the next hop is alive but not getting through: try a backup before giving up
+    rerouteFrame(packetID, ent);
+}
 
-        Serial.printf("[AODVRouter] Retries exhausted for pkt %u – sending RERR\n", pid);
+void AODVRouter::ackRetriesExhausted(uint32_t pid, const ackBufferEntry &ent)
+{
+    Serial.printf("[AODVRouter] Retries exhausted for pkt %u – sending RERR\n", pid);
 
-        BaseHeader bh;
-        deserialiseBaseHeader(ent.packet, bh);
+    // the headers we need are inside the sealed body
+    BaseHeader bh;
+    uint8_t plain[sizeof(RadioPacket::data)] = {};
+    size_t plainLen;
+    if (!openFrame(ent.frame, bh, plain, plainLen))
+        Serial.printf("[AODVRouter] pkt %u did not open, reporting it blind\n", pid);
 
-        switch (bh.packetType)
-        {
-        case PKT_DATA:
-        {
-            DATAHeader dh;
-            deserialiseDATAHeader(ent.packet, dh, sizeof(BaseHeader));
-            sendRERR(_myNodeID, bh.originNodeID, dh.finalDestID, pid);
-            _clientNotifier->notify(Outgoing{BleType::BLE_ACK_FAILURE, 0, 0, nullptr, 0, pid});
-            break;
-        }
-        case PKT_USER_MSG:
+    switch (bh.packetType)
+    {
+    case PKT_DATA:
+    {
+        DATAHeader dh;
+        deserialiseDATAHeader(plain, dh, 0);
+        sendRERR(_myNodeID, bh.originNodeID, dh.finalDestID, pid);
+        _clientNotifier->notify(Outgoing{BleType::BLE_ACK_FAILURE, 0, 0, nullptr, 0, pid});
+        break;
+    }
+    case PKT_USER_MSG:
+    {
+        UserMsgHeader uh;
+        deserialiseUserMsgHeader(plain, uh, 0);
+        sendRERR(_myNodeID, bh.originNodeID, uh.toNodeID, pid);
+        _clientNotifier->notify(Outgoing{BleType::BLE_ACK_FAILURE, uh.fromUserID, 0, nullptr, 0, pid});
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    FramePool::instance().release(ent.frame); // finally release the buffer
+}
+
+void AODVRouter::checkNeighbours()
+{
+    std::vector<uint32_t> gone;
+    {
+        Lock l(_mutex);
+        _links.expire(xTaskGetTickCount(), BEACON_MAX_SILENCE_TICKS, NEIGHBOUR_MISSED_BEACONS, gone);
+    }
+    for (uint32_t n : gone)
+    {
+        Serial.printf("[AODVRouter] Neighbour %u missed %u beacons, dropping its routes\n", n, NEIGHBOUR_MISSED_BEACONS);
+        neighbourLost(n);
+    }
+}
+
+void AODVRouter::neighbourLost(uint32_t neighbour)
+{
+    std::vector<std::pair<uint32_t, ackBufferEntry>> waiting;
+    {
+        Lock l(_mutex);
+        for (auto it = ackBuffer.begin(); it != ackBuffer.end();)
         {
-            UserMsgHeader uh;
-            deserialiseUserMsgHeader(ent.packet, uh, sizeof(BaseHeader));
-            sendRERR(_myNodeID, bh.originNodeID, uh.toNodeID, pid);
-            _clientNotifier->notify(Outgoing{BleType::BLE_ACK_FAILURE, uh.fromUserID, 0, nullptr, 0, pid});
-            break;
+            if (it->second.expectedNextHop != neighbour)
+            {
+                ++it;
+                continue;
+            }
+            _timers.cancel(it->second.timer);
+            waiting.push_back(*it);
+            it = ackBuffer.erase(it);
         }
+    }
 
-        default:
-            break;
-        }
+    invalidateRoute(neighbour, neighbour, _myNodeID);
 
-        vPortFree(ent.packet); // finally release the buffer
-    }
+    for (auto &w : waiting)
+        rerouteFrame(w.first, w.second);
 }
 
-#ifndef UNIT_TEST
-void AODVRouter::broadcastTimerCallback(TimerHandle_t xTimer)
+void AODVRouter::rerouteFrame(uint32_t packetID, const ackBufferEntry &ent)
 {
-    AODVRouter *self = (AODVRouter *)pvTimerGetTimerID(xTimer);
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    xTaskNotifyFromISR(
-        self->_timerWorkerHandle,
-        BROADCAST_NOTIFY_BIT,
-        eSetBits,
-        &xHigherPriorityTaskWoken);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    BaseHeader bh;
+    uint8_t plain[sizeof(RadioPacket::data)];
+    size_t plainLen;
+    if (!openFrame(ent.frame, bh, plain, plainLen))
+    {
+        ackRetriesExhausted(packetID, ent);
+        return;
+    }
+
+    uint32_t finalDest;
+    size_t bodyAt;
+    DATAHeader dh{};
+    UserMsgHeader uh{};
+    if (bh.packetType == PKT_DATA && plainLen >= sizeof(DATAHeader))
+    {
+        bodyAt = deserialiseDATAHeader(plain, dh, 0);
+        finalDest = dh.finalDestID;
+    }
+    else if (bh.packetType == PKT_USER_MSG && plainLen >= sizeof(UserMsgHeader))
+    {
+        bodyAt = deserialiseUserMsgHeader(plain, uh, 0);
+        finalDest = uh.toNodeID;
+    }
+    else
+    {
+        ackRetriesExhausted(packetID, ent);
+        return;
+    }
+
+    failoverRoute(finalDest, ent.expectedNextHop);
+    RouteEntry re;
+    bool viaOld = getRoute(finalDest, re) && re.nextHop == ent.expectedNextHop;
+
+    if (bh.originNodeID == _myNodeID && !viaOld)
+    {
+        // ours: as if the client sent it again, under the same packet id it is waiting on
+        uint8_t flags = bh.flags & ~FLAG_ENCRYPTED;
+        if (bh.packetType == PKT_DATA)
+            sendData(finalDest, plain + bodyAt, plainLen - bodyAt, packetID, flags);
+        else
+            sendUserMessage(uh.fromUserID, uh.toUserID, plain + bodyAt, plainLen - bodyAt, packetID, flags);
+        FramePool::instance().release(ent.frame);
+        return;
+    }
+
+    if (bh.originNodeID == _myNodeID)
+    {
+        ackRetriesExhausted(packetID, ent);
+        return;
+    }
+    if (viaOld || !getRoute(finalDest, re))
+    {
+        // nowhere else to send it: repair the route from here before telling the origin
+        if (viaOld)
+            removeItemRoutingTable(finalDest);
+        if (!repairRoute(finalDest, packetID, ent.frame))
+            ackRetriesExhausted(packetID, ent);
+        return;
+    }
+    Serial.printf("[AODVRouter] Rerouting pkt %u for %u via %u\n", packetID, finalDest, re.nextHop);
+    touchRoute(finalDest);
+    bh.destNodeID = re.nextHop;
+    serialiseBaseHeader(bh, ent.frame->data);
+    sendFrame(bh, ent.frame);
 }
 
-void AODVRouter::ackCleanupCallback(TimerHandle_t xTimer)
+bool AODVRouter::openFrame(const RadioPacket *frame, BaseHeader &bh, uint8_t *plain, size_t &plainLen)
 {
-    AODVRouter *self = (AODVRouter *)pvTimerGetTimerID(xTimer);
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    xTaskNotifyFromISR(
-        self->_timerWorkerHandle,
-        CLEANUP_NOTIFY_BIT,
-        eSetBits,
-        &xHigherPriorityTaskWoken);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    plainLen = 0;
+    if (frame->len < sizeof(BaseHeader))
+        return false;
+    deserialiseBaseHeader(frame->data, bh);
+    const uint8_t *body = frame->data + sizeof(BaseHeader);
+    size_t bodyLen = frame->len - sizeof(BaseHeader);
+    if (!(bh.flags & FLAG_ENCRYPTED))
+    {
+        memcpy(plain, body, bodyLen);
+        plainLen = bodyLen;
+        return true;
+    }
+    if (bodyLen < TAG_LEN)
+        return false;
+
+    uint8_t nonce[NONCE_LEN];
+    buildNonce(bh, nonce);
+    uint8_t aad[sizeof(BaseHeader)];
+    size_t aadLen = buildAad(bh, aad);
+    if (!aes_gcm_decrypt(nonce, NONCE_LEN, aad, aadLen, body, bodyLen - TAG_LEN,
+                         body + bodyLen - TAG_LEN, TAG_LEN, plain))
+        return false;
+    plainLen = bodyLen - TAG_LEN;
+    return true;
 }
-#endif
 
 void AODVRouter::sendData(uint32_t destNodeID, const uint8_t *data, size_t len, uint32_t packetId, uint8_t flags)
 {
@@ -420,6 +733,8 @@ void AODVRouter::sendData(uint32_t destNodeID, const uint8_t *data, size_t len,
             return;
         }
         bh.destNodeID = re.nextHop;
+        touchRoute(destNodeID);
+        touchRoute(re.nextHop);
     }
     else
     {
@@ -543,6 +858,8 @@ void AODVRouter::sendUserMessage(uint32_t fromUserID, uint32_t toUserID, const u
         Serial.println("[AODVRouter] Error whilst constructing a user to user message --> destNodeID or nextHopID unset - message lost :(");
         return;
     }
+    touchRoute(destNodeID);
+    touchRoute(nextHopID);
 
     BaseHeader bh;
     bh.destNodeID = nextHopID;
@@ -597,21 +914,42 @@ void AODVRouter::sendMoveUserReq(uint32_t userID, uint32_t oldNodeID)
 
 void AODVRouter::handlePacket(RadioPacket *rxPacket)
 {
-    if (rxPacket->len < sizeof(BaseHeader))
+    {
+        Lock l(_mutex);
+        ++_rxStats.received;
+    }
+
+    if (rxPacket->len < sizeof(BaseHeader))
     {
         Serial.printf("length of packet %u\n", rxPacket->len);
         Serial.println("[AODVRouter] Received packet with size less than baseheader size. Discarded");
+        Lock l(_mutex);
+        ++_rxStats.malformed;
         return;
     }
 
     BaseHeader bh;
     deserialiseBaseHeader(rxPacket->data, bh);
+    _rxSealed.valid = false;
+
+    // the BaseHeader travels in the clear (it is the AAD), so most frames are dropped here without any crypto
+    bool backupOnly;
+    if (!acceptBeforeDecrypt(bh, backupOnly))
+        return;
+
+    uint8_t *payload = rxPacket->data + sizeof(BaseHeader);
+    size_t payloadLen = rxPacket->len - sizeof(BaseHeader);
+    uint8_t plain[255]; // plaintext of a frame that stays sealed for relaying
 
     if (bh.flags & FLAG_ENCRYPTED)
     {
         Serial.println("Decrypting packet");
         if (rxPacket->len < sizeof(BaseHeader) + TAG_LEN)
-            return; /* malformed */
+        {
+            Lock l(_mutex);
+            ++_rxStats.malformed;
+            return;
+        }
 
         size_t cipherLen = rxPacket->len - sizeof(BaseHeader) - TAG_LEN;
         uint8_t *cipher = rxPacket->data + sizeof(BaseHeader);
@@ -619,58 +957,70 @@ void AODVRouter::handlePacket(RadioPacket *rxPacket)
 
         uint8_t nonce[NONCE_LEN];
         buildNonce(bh, nonce);
+        uint8_t aad[sizeof(BaseHeader)];
+        size_t aadLen = buildAad(bh, aad);
 
-        /* allocate a small stack buffer – cipherLen ≤ 227 */
-        uint8_t plain[255];
+        /* A hop-invariant frame stays sealed so a relay can send this very
+           buffer on; anything else is decrypted in place.              */
+        bool keepSealed = hopInvariant(bh.packetType);
+        uint8_t *out = keepSealed ? plain : cipher;
         if (!aes_gcm_decrypt(nonce, NONCE_LEN,
-                             rxPacket->data, sizeof(BaseHeader), /* AAD */
+                             aad, aadLen,
                              cipher, cipherLen,
                              tag, TAG_LEN,
-                             plain))
+                             out))
         {
             Serial.println("[AODV] Auth failed – drop");
+            Lock l(_mutex);
+            ++_rxStats.authFailed;
             return;
         }
 
-        /* overwrite cipher with plaintext in-place */
-        memcpy(cipher, plain, cipherLen);
-        rxPacket->len = sizeof(BaseHeader) + cipherLen;
-
-        bh.flags &= ~FLAG_ENCRYPTED;                       // clear for high-level logic
-        rxPacket->data[sizeof(BaseHeader) - 3] = bh.flags; // header byte  (offset 17)
-    }
+        if (keepSealed)
+        {
+            _rxSealed.originNodeID = bh.originNodeID;
+            _rxSealed.packetID = bh.packetID;
+            _rxSealed.flags = bh.flags;
+            _rxSealed.frame = rxPacket;
+            _rxSealed.plain = plain;
+            _rxSealed.plainLen = cipherLen;
+            _rxSealed.valid = true;
+        }
+        else
+        {
+            rxPacket->len = sizeof(BaseHeader) + cipherLen;
+            rxPacket->data[BASE_HDR_FLAGS_OFFSET] = bh.flags & ~FLAG_ENCRYPTED; // header byte  (offset 17)
+        }
+        payload = out;
+        payloadLen = cipherLen;
 
-    if (tryImplicitAck(bh.packetID))
-        return;
+        bh.flags &= ~FLAG_ENCRYPTED; // clear for high-level logic
 
-    if (isDuplicatePacketID(bh.packetID))
-    {
-        Serial.println("[AODVRouter] Received packet which has already been processed");
-        return;
+        Lock l(_mutex);
+        ++_rxStats.decrypted;
     }
 
-    storePacketID(bh.packetID);
-
-    if (bh.prevHopID == _myNodeID)
+    if (backupOnly)
     {
-        Serial.println("[AODVRouter] Reveived packet with prevHopID == myNodeID. Not expected behaviour! Unless I sent a broadcast");
+        // the duplicate is genuine: whoever relayed it is another way back to its origin
+        _rxSealed.valid = false;
+        learnBackup(bh.originNodeID, bh.prevHopID, bh.hopCount + 1, 0, ACTIVE_ROUTE_TIMEOUT_TICKS);
         return;
     }
 
-    if (bh.destNodeID != BROADCAST_ADDR && bh.destNodeID != _myNodeID)
+    // recorded only once authenticated, so a forged header cannot suppress the real frame meant for us
+    storePacket(bh);
     {
-        Serial.printf("[AODVRouter] Not a message for me bh.destnodeid: %u\n", bh.destNodeID);
-        return;
+        Lock l(_mutex);
+        ++_rxStats.accepted;
+        // likewise only authenticated frames move the sender's link estimate
+        _links.sample(bh.prevHopID, rxPacket->rssi, rxPacket->snr, xTaskGetTickCount());
     }
 
     Serial.printf("Packet ID: %U\n", bh.packetID);
 
     // Check if prev. seen message, hopCount etc.
 
-    size_t offset = sizeof(BaseHeader);
-    size_t payloadLen = rxPacket->len - offset;
-    uint8_t *payload = rxPacket->data + offset;
-
     switch (bh.packetType)
     {
     case PKT_RREQ:
@@ -724,6 +1074,7 @@ void AODVRouter::handlePacket(RadioPacket *rxPacket)
         Serial.printf("[AODVRouter] Unknown packet type :( %u\n", bh.packetType);
         break;
     }
+    _rxSealed.valid = false;
 }
 
 void AODVRouter::handleRREQ(const BaseHeader &base, const uint8_t *payload, size_t payloadLen)
@@ -737,11 +1088,17 @@ void AODVRouter::handleRREQ(const BaseHeader &base, const uint8_t *payload, size
     RREQHeader rreq;
     memcpy(&rreq, payload, sizeof(RREQHeader));
 
-    // add route to origin node through the node sending if the hopcount is less than any previous route
-    updateRoute(base.originNodeID, base.prevHopID, base.hopCount + 1);
+    // the RREQ carries the ETX of the path it came along; add the link it just crossed
+    uint16_t linkEtx = linkCost(base.prevHopID);
+    uint32_t pathEtx = (uint32_t)rreq.metric + linkEtx;
+    rreq.metric = pathEtx > 0xFFFF ? 0xFFFF : (uint16_t)pathEtx;
+
+    // add route to origin node through the node sending if it is fresher or cheaper than any previous route
+    updateRoute(base.originNodeID, base.prevHopID, base.hopCount + 1, rreq.originSeqNum,
+                ACTIVE_ROUTE_TIMEOUT_TICKS, rreq.metric);
 
     // technically shoudl also add the neighbour who sent it as you may not have them saved either
-    updateRoute(base.prevHopID, base.prevHopID, 1);
+    updateRoute(base.prevHopID, base.prevHopID, 1, 0, ACTIVE_ROUTE_TIMEOUT_TICKS, linkEtx);
 
     if (rreq.RREQDestNodeID == _myNodeID)
     {
@@ -750,21 +1107,42 @@ void AODVRouter::handleRREQ(const BaseHeader &base, const uint8_t *payload, size
         // Changed hop count to not use the prev hop count as it may take a different route to get back to the
         // the origin node so we reset to 0. To improve this we would need to store the route taken by this packet.
         // Therefore, numHops needds to incremented everytime it is forwarded.
-        sendRREP(base.originNodeID, _myNodeID, base.prevHopID, 0);
+        uint32_t seq;
+        {
+            // answer with at least the freshness the requester asked for
+            Lock l(_mutex);
+            if (rreq.destSeqNum != 0 && seqNumNewer(rreq.destSeqNum, _ownSeqNum))
+                _ownSeqNum = rreq.destSeqNum;
+            seq = _ownSeqNum;
+        }
+        sendRREP(base.originNodeID, _myNodeID, base.prevHopID, 0, seq);
         return;
     }
 
     RouteEntry re;
     if (getRoute(rreq.RREQDestNodeID, re))
     {
-        if (re.hopcount >= routeReplyThreshold)
+        // only answer for the destination if our route is at least as fresh as requested
+        bool freshEnough = re.destSeqNum != 0 &&
+                           (rreq.destSeqNum == 0 || !seqNumNewer(rreq.destSeqNum, re.destSeqNum));
+        if (re.hopcount >= routeReplyThreshold && freshEnough)
         {
             Serial.printf("[AODVRouter] I have a route to %u, so I'll send RREP back to %u.\n", rreq.RREQDestNodeID, base.originNodeID);
+            addPrecursor(rreq.RREQDestNodeID, base.prevHopID);
             // There is a route to the node, therefore use the entry as the base number of hops
-            sendRREP(base.originNodeID, rreq.RREQDestNodeID, base.prevHopID, re.hopcount);
+            sendRREP(base.originNodeID, rreq.RREQDestNodeID, base.prevHopID, re.hopcount, re.destSeqNum, remainingLifetimeS(re),
+                     re.metric);
             return;
         }
     }
+    // expanding ring: the requester only asked this far out
+    uint8_t ttl = rreq.ttl ? rreq.ttl : NET_DIAMETER;
+    if (base.hopCount + 1 >= ttl)
+    {
+        Serial.printf("[AODVRouter] RREQ for %u reached its ttl %u, not forwarding\n", rreq.RREQDestNodeID, ttl);
+        return;
+    }
+
     Serial.println("[AODVRouter] Forwading RREQ");
 
     RREQHeader forwardRreq = rreq;
@@ -779,7 +1157,7 @@ void AODVRouter::handleRREQ(const BaseHeader &base, const uint8_t *payload, size
     fwdBase.destNodeID = BROADCAST_ADDR;
     fwdBase.packetType = PKT_RREQ;
 
-    transmitPacket(fwdBase, (uint8_t *)&forwardRreq, sizeof(RREQHeader));
+    relayFlood(fwdBase, (uint8_t *)&forwardRreq, sizeof(RREQHeader));
 }
 
 void AODVRouter::handleRREP(const BaseHeader &base, const uint8_t *payload, size_t payloadLen)
@@ -796,10 +1174,14 @@ void AODVRouter::handleRREP(const BaseHeader &base, const uint8_t *payload, size
     memcpy(&rrep, payload, sizeof(RREPHeader));
 
     // update route to the rrep.RREPDESTNODEID if not already found
-    updateRoute(rrep.RREPDestNodeID, base.prevHopID, rrep.numHops + 1);
+    TickType_t lifetime = rrep.lifetime ? pdMS_TO_TICKS((uint32_t)rrep.lifetime * 1000u) : ACTIVE_ROUTE_TIMEOUT_TICKS;
+    uint16_t linkEtx = linkCost(base.prevHopID);
+    uint32_t pathEtx = (uint32_t)rrep.metric + linkEtx;
+    rrep.metric = pathEtx > 0xFFFF ? 0xFFFF : (uint16_t)pathEtx;
+    updateRoute(rrep.RREPDestNodeID, base.prevHopID, rrep.numHops + 1, rrep.destSeqNum, lifetime, rrep.metric);
 
     // technically should also add the neighbour who sent it as you may not have them saved either
-    updateRoute(base.prevHopID, base.prevHopID, 1);
+    updateRoute(base.prevHopID, base.prevHopID, 1, 0, ACTIVE_ROUTE_TIMEOUT_TICKS, linkEtx);
 
     if (hasRoute(rrep.RREPDestNodeID))
     {
@@ -807,12 +1189,15 @@ void AODVRouter::handleRREP(const BaseHeader &base, const uint8_t *payload, size
         flushDataQueue(rrep.RREPDestNodeID);
         flushMoveReqBuffer(rrep.RREPDestNodeID);
         flushUserRouteBuffer(rrep.RREPDestNodeID);
+        flushRepairFrames(rrep.RREPDestNodeID);
     }
 
     // If I initially sent the RREQ no need to continue forwarding
     if (_myNodeID == base.originNodeID)
     {
         Serial.println("[AODVRouter] Got RREP for rreq");
+        Lock l(_mutex);
+        endDiscovery(_discoveries, rrep.RREPDestNodeID);
         return;
     }
 
@@ -822,6 +1207,9 @@ void AODVRouter::handleRREP(const BaseHeader &base, const uint8_t *payload, size
         Serial.println("[AODVRouter] Got RREP but no route to the origin!");
         return;
     }
+    // each end of the new route now reaches the other through us (RFC 3561 §6.7)
+    addPrecursor(rrep.RREPDestNodeID, re.nextHop);
+    addPrecursor(base.originNodeID, base.prevHopID);
 
     Serial.println("[AODVRouter] Forwading RREP");
     RREPHeader newRrep = rrep; // need to increment the number of hops in rrep header as per note
@@ -857,6 +1245,16 @@ void AODVRouter::handleRERR(const BaseHeader &base, const uint8_t *payload, size
     RERRHeader rerr;
     memcpy(&rerr, payload, sizeof(RERRHeader));
 
+    // a neighbour's own break report to its precursors, not one frame's error on its way to the origin
+    if (base.originNodeID == base.prevHopID && rerr.originalPacketID == 0)
+    {
+        handlePrecursorRERR(base, rerr, payload, payloadLen);
+        return;
+    }
+
+    // adopt the reporter's bumped sequence number before dropping the route
+    recordSeqNum(rerr.originalDestNodeID, rerr.destSeqNum);
+
     if (rerr.brokenNodeID != rerr.reporterNodeID)
     {
         invalidateRoute(rerr.brokenNodeID, rerr.originalDestNodeID, base.prevHopID);
@@ -896,6 +1294,70 @@ void AODVRouter::handleRERR(const BaseHeader &base, const uint8_t *payload, size
     transmitPacket(fwdBase, (uint8_t *)&rerr, sizeof(RERRHeader));
 }
 
+void AODVRouter::handlePrecursorRERR(const BaseHeader &base, const RERRHeader &rerr, const uint8_t *payload, size_t payloadLen)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> listed{{rerr.originalDestNodeID, rerr.destSeqNum}};
+    if (payloadLen >= sizeof(RERRHeader) + sizeof(RERRDestListHeader))
+    {
+        RERRDestListHeader lh;
+        size_t at = deserialiseRERRDestListHeader(payload, lh, sizeof(RERRHeader));
+        for (uint8_t i = 0; i < lh.numDests && at + 2 * sizeof(uint32_t) <= payloadLen; ++i)
+        {
+            uint32_t dest, seq;
+            memcpy(&dest, payload + at, 4);
+            memcpy(&seq, payload + at + 4, 4);
+            at += 2 * sizeof(uint32_t);
+            listed.emplace_back(dest, seq);
+        }
+    }
+
+    {
+        Lock l(_mutex);
+        ++_rerrStats.received;
+    }
+
+    // only routes through the sender are cut; a backup around it takes over if there is one
+    std::vector<std::pair<uint32_t, uint32_t>> lost;
+    std::vector<uint32_t> precursors;
+    for (const auto &d : listed)
+    {
+        {
+            Lock l(_mutex);
+            const RouteEntry *re = _routeTable.find(d.first);
+            if (re == nullptr || re->nextHop != base.prevHopID)
+                continue;
+        }
+        if (failoverRoute(d.first, base.prevHopID, rerr.brokenNodeID))
+            continue;
+        recordSeqNum(d.first, d.second);
+        Lock l(_mutex);
+        collectPrecursors(d.first, base.prevHopID, precursors);
+        _routeTable.erase(d.first);
+        ++_rerrStats.invalidated;
+        lost.emplace_back(d.first, knownSeqNum(d.first));
+    }
+
+    Serial.printf("[AODVRouter] RERR from %u: %u of %u destinations lost\n", base.prevHopID,
+                  (unsigned)lost.size(), (unsigned)listed.size());
+    if (lost.empty())
+        return;
+
+    if (_mqttManager != nullptr && _mqttManager->connected)
+    {
+        for (const auto &d : lost)
+            _mqttManager->publishInvalidateRoute(d.first);
+    }
+
+    // on upstream, as our own report: each node only tells the ones that used it
+    if (precursors.empty())
+    {
+        Lock l(_mutex);
+        ++_rerrStats.unheard;
+        return;
+    }
+    sendPrecursorRERR(rerr.brokenNodeID, lost, precursors);
+}
+
 void AODVRouter::handleData(const BaseHeader &base, const uint8_t *payload, size_t payloadLen)
 {
     if (payloadLen < sizeof(DATAHeader))
@@ -934,7 +1396,6 @@ void AODVRouter::handleData(const BaseHeader &base, const uint8_t *payload, size
     fwd.prevHopID = _myNodeID;
     if (dataHeader.finalDestID == BROADCAST_ADDR)
     {
-        // TODO: need to stop the broadcast at some point
         Serial.println("[AODVRouter] Entered I am received BROADCAST DATA path");
         // TODO: need to properly extract the data without the header
         Serial.printf("[AODVRouter] Received DATA for me. PayloadLen=%u\n", (unsigned)payloadLen);
@@ -958,6 +1419,9 @@ void AODVRouter::handleData(const BaseHeader &base, const uint8_t *payload, size
 
         if (!getRoute(dataHeader.finalDestID, re))
         {
+            // look for it from here first; the origin only hears of it if that fails
+            if (holdForRepair(fwd, dataHeader.finalDestID))
+                return;
             Serial.printf("[AODVRouter] No route to forward data to %u, dropping.\n", dataHeader.finalDestID);
             // special case where node self reports broken link therefore brokenNodeID == originNodeID
             sendRERR(_myNodeID, base.originNodeID, dataHeader.finalDestID, base.packetID);
@@ -966,6 +1430,10 @@ void AODVRouter::handleData(const BaseHeader &base, const uint8_t *payload, size
         }
 
         fwd.destNodeID = re.nextHop;
+        addPrecursor(dataHeader.finalDestID, base.prevHopID);
+        touchRoute(dataHeader.finalDestID);
+        touchRoute(re.nextHop);
+        touchRoute(base.originNodeID);
     }
 
     Serial.println("[AODVRouter] Forwading Data");
@@ -975,7 +1443,10 @@ void AODVRouter::handleData(const BaseHeader &base, const uint8_t *payload, size
     // we don't change src node in data message because we should not be learning
     // any new routes at this point
 
-    transmitPacket(fwd, (uint8_t *)&dataHeader, sizeof(DATAHeader), actualData, actualDataLen);
+    if (fwd.destNodeID == BROADCAST_ADDR)
+        relayFlood(fwd, (uint8_t *)&dataHeader, sizeof(DATAHeader), actualData, actualDataLen);
+    else
+        forwardPacket(fwd, (uint8_t *)&dataHeader, sizeof(DATAHeader), actualData, actualDataLen);
 }
 
 void AODVRouter::handleBroadcastInfo(const BaseHeader &base, const uint8_t *payload, size_t payloadLen)
@@ -989,6 +1460,22 @@ void AODVRouter::handleBroadcastInfo(const BaseHeader &base, const uint8_t *payl
     DiffBroadcastInfoHeader dh;
     memcpy(&dh, payload, sizeof(DiffBroadcastInfoHeader));
 
+    bool newNeighbour;
+    {
+        Lock l(_mutex);
+        const RouteEntry *re = _routeTable.find(base.prevHopID);
+        // heard before this frame: known, even if a cheaper detour carries our route to it
+        LinkQuality lq;
+        bool heardBefore = _links.find(base.prevHopID, lq) && lq.frames > 1;
+        newNeighbour = !heardBefore && (re == nullptr || re->hopcount != 1);
+        // a neighbour's own beacon with nothing new makes ours redundant
+        if (!newNeighbour && base.hopCount == 0 && dh.numAdded == 0 && dh.numRemoved == 0)
+            _trickle.consistent();
+    }
+    // topology changed around us: let the newcomer hear from us soon
+    if (newNeighbour)
+        resetBeacon();
+
     if (!isNodeIDKnown(base.prevHopID))
     {
         saveNodeID(base.prevHopID);
@@ -1022,6 +1509,7 @@ void AODVRouter::handleBroadcastInfo(const BaseHeader &base, const uint8_t *payl
 
     // update the routing table
     updateRoute(base.prevHopID, base.prevHopID, 1);
+    refreshRoutesVia(base.prevHopID);
 
     // update route to the originNode
     if (base.originNodeID != _myNodeID)
@@ -1057,6 +1545,30 @@ void AODVRouter::handleBroadcastInfo(const BaseHeader &base, const uint8_t *payl
         removeGutEntry(uid);
     }
 
+    // the origin's neighbour list, taken only off its own beacon: a relayed
+    // copy carries the same list but says nothing about who the relay reaches
+    size_t idsEnd = sizeof(DiffBroadcastInfoHeader) + ((size_t)dh.numAdded + dh.numRemoved) * sizeof(uint32_t);
+    NeighbourListHeader nh;
+    if (base.hopCount == 0 && base.originNodeID == base.prevHopID &&
+        idsEnd + sizeof(NeighbourListHeader) <= payloadLen &&
+        idsEnd + sizeof(NeighbourListHeader) + (size_t)payload[idsEnd] * sizeof(uint32_t) == payloadLen)
+    {
+        offset = deserialiseNeighbourListHeader(payload, nh, idsEnd);
+        std::vector<uint32_t> ids(nh.numNeighbours);
+        memcpy(ids.data(), payload + offset, ids.size() * sizeof(uint32_t));
+
+        bool changed;
+        {
+            Lock l(_mutex);
+            changed = _neighbourhood.heard(base.prevHopID, ids.data(), nh.numNeighbours, nh.numMprs, _myNodeID);
+        }
+        // the new MPR set goes out with our next beacon; until then the
+        // old MPRs still relay and a declined beacon can be rescued
+        std::vector<uint32_t> oneHop;
+        if (changed)
+            selectMprs(oneHop);
+    }
+
     Serial.println("[AODVRouter] Forwading BroadcastINFO");
     // increment number of hops
     BaseHeader fwd = base;
@@ -1070,8 +1582,24 @@ void AODVRouter::handleBroadcastInfo(const BaseHeader &base, const uint8_t *payl
         return;
     }
 
+    // only the multipoint relays of whoever sent it pass it on
+    bool relay;
+    {
+        Lock l(_mutex);
+        relay = _neighbourhood.shouldRelay(base.prevHopID);
+        if (relay)
+            _neighbourhood.relayed();
+        else
+            _neighbourhood.declined(base.originNodeID, base.packetID);
+    }
+    if (!relay)
+    {
+        Serial.printf("[AODVRouter] Not an MPR of %u, broadcast info not relayed\n", base.prevHopID);
+        return;
+    }
+
     // forward the message, keep src id as the same
-    transmitPacket(fwd, reinterpret_cast<const uint8_t *>(&dh), sizeof(dh), payload + sizeof(dh), payloadLen - sizeof(dh));
+    forwardPacket(fwd, reinterpret_cast<const uint8_t *>(&dh), sizeof(dh), payload + sizeof(dh), payloadLen - sizeof(dh));
 }
 
 void AODVRouter::handleUserMessage(const BaseHeader &base, const uint8_t *payload, size_t payloadLen)
@@ -1181,6 +1709,10 @@ void AODVRouter::handleUserMessage(const BaseHeader &base, const uint8_t *payloa
 
     if (!getRoute(umh.toNodeID, re))
     {
+        BaseHeader fwd = base;
+        fwd.prevHopID = _myNodeID;
+        if (holdForRepair(fwd, umh.toNodeID))
+            return;
         Serial.printf("[AODVRouter] No route to forward data to %u, dropping.\n", umh.toNodeID);
         // special case where node self reports broken link therefore brokenNodeID == originNodeID
         sendRERR(_myNodeID, base.originNodeID, umh.toNodeID, base.packetID);
@@ -1188,6 +1720,10 @@ void AODVRouter::handleUserMessage(const BaseHeader &base, const uint8_t *payloa
         return;
     }
     Serial.println("[AODVRouter] Forwading Data");
+    addPrecursor(umh.toNodeID, base.prevHopID);
+    touchRoute(umh.toNodeID);
+    touchRoute(re.nextHop);
+    touchRoute(base.originNodeID);
 
     BaseHeader fwd = base;
     fwd.prevHopID = _myNodeID;
@@ -1195,7 +1731,7 @@ void AODVRouter::handleUserMessage(const BaseHeader &base, const uint8_t *payloa
     fwd.hopCount++;
     fwd.packetType = PKT_USER_MSG;
 
-    transmitPacket(fwd, (uint8_t *)&umh, sizeof(UserMsgHeader), message, messageLen);
+    forwardPacket(fwd, (uint8_t *)&umh, sizeof(UserMsgHeader), message, messageLen);
 }
 
 void AODVRouter::handleUREQ(const BaseHeader &base, const uint8_t *payload, size_t payloadlen)
@@ -1234,7 +1770,7 @@ void AODVRouter::handleUREQ(const BaseHeader &base, const uint8_t *payload, size
     fwd.prevHopID = _myNodeID;
     fwd.hopCount++;
 
-    transmitPacket(fwd, (uint8_t *)&ureq, sizeof(UREQHeader));
+    relayFlood(fwd, (uint8_t *)&ureq, sizeof(UREQHeader));
 }
 
 void AODVRouter::handleUREP(const BaseHeader &base, const uint8_t *payload, size_t payloadlen)
@@ -1243,7 +1779,8 @@ void AODVRouter::handleUREP(const BaseHeader &base, const uint8_t *payload, size
     deserialiseUREPHeader(payload, urep, 0);
 
     updateRoute(base.prevHopID, base.prevHopID, 1);
-    updateRoute(urep.destNodeID, base.prevHopID, base.hopCount + 1);
+    TickType_t lifetime = urep.lifetime ? pdMS_TO_TICKS((uint32_t)urep.lifetime * 1000u) : ACTIVE_ROUTE_TIMEOUT_TICKS;
+    updateRoute(urep.destNodeID, base.prevHopID, base.hopCount + 1, 0, lifetime);
     GutEntry ge;
     ge.nodeID = urep.destNodeID;
     ge.seq = 0; // TODO: will need to be changed to actually handle seq number
@@ -1252,21 +1789,11 @@ void AODVRouter::handleUREP(const BaseHeader &base, const uint8_t *payload, size
 
     if (_myNodeID == base.originNodeID)
     {
-        // if (hasBufferedUserMessages(urep.userID))
-        // {
-        //     // flushUserRouteBuffer(urep.userID);
-        // }
-
-        auto pending = popBufferedUserMessages(urep.userID);
-        for (auto &msg : pending)
         {
-            sendUserMessage(msg.senderID,
-                            urep.userID,
-                            msg.message,
-                            msg.length,
-                            msg.packetID); // keeps original pktId
-            vPortFree(msg.message);
+            Lock l(_mutex);
+            endDiscovery(_userDiscoveries, urep.userID);
         }
+        flushUserMessageBuffer(urep.userID);
         return;
     }
 
@@ -1378,15 +1905,12 @@ void AODVRouter::handlePubKeyReq(const BaseHeader &base,
         return;
     }
 
-    /*  otherwise forward like a UREQ (same hop-limit logic) */
+    /*  otherwise forward like a UREQ */
     BaseHeader fwd = base;
     fwd.prevHopID = _myNodeID;
     fwd.hopCount++;
 
-    if (fwd.hopCount >= MAX_HOPS)
-        return;
-
-    transmitPacket(fwd, pl, len);
+    relayFlood(fwd, pl, len);
 }
 
 void AODVRouter::handlePubKeyResp(const BaseHeader &base,
@@ -1419,7 +1943,7 @@ void AODVRouter::handlePubKeyResp(const BaseHeader &base,
     fwd.prevHopID = _myNodeID;
     fwd.hopCount++;
 
-    transmitPacket(fwd, pl, len);
+    forwardPacket(fwd, pl, len);
 }
 
 void AODVRouter::handleMoveUserReq(const BaseHeader &base, const uint8_t *payload, size_t payloadLen)
@@ -1446,7 +1970,7 @@ void AODVRouter::handleMoveUserReq(const BaseHeader &base, const uint8_t *payloa
         fwd.prevHopID = _myNodeID;
         fwd.destNodeID = re.nextHop;
         fwd.hopCount++;
-        transmitPacket(fwd, payload, payloadLen);
+        forwardPacket(fwd, payload, payloadLen);
         return;
     }
 
@@ -1467,11 +1991,338 @@ void AODVRouter::handleMoveUserReq(const BaseHeader &base, const uint8_t *payloa
     }
 
     _usm->remove(mvr.userID);
+    userSessionsChanged();
 }
 
 // HELPER FUNCTIONS: sendRREQ, sendRREP, sendRERR
 
 void AODVRouter::sendRREQ(uint32_t destNodeID)
+{
+    uint8_t ttl;
+    {
+        Lock l(_mutex);
+        TickType_t now = xTaskGetTickCount();
+        auto it = _discoveries.find(destNodeID);
+        if (it == _discoveries.end())
+        {
+            // start the ring just beyond where the destination last was (RFC 3561 §6.4);
+            // with no such hint a small ring is a flood that finds nothing, so go wide
+            auto h = _destHistory.find(destNodeID);
+            uint8_t start = (h != _destHistory.end() && h->second.hopCount != 0)
+                                ? h->second.hopCount + RREQ_TTL_INCREMENT
+                                : NET_DIAMETER;
+            if (start > RREQ_TTL_THRESHOLD)
+                start = NET_DIAMETER;
+            it = _discoveries.emplace(destNodeID, RouteDiscovery{start, 0, 0, false}).first;
+            ++_discoveryStats.started;
+        }
+        else if (discoveryInFlight(it->second, now))
+        {
+            // the last RREQ has not had time to come back: just wait for it
+            ++_discoveryStats.coalesced;
+            Serial.printf("[AODVRouter] Discovery for %u already pending\n", destNodeID);
+            return;
+        }
+        else
+        {
+            ++_discoveryStats.retries;
+        }
+        armDiscovery(it->second, destNodeID, now);
+        ttl = it->second.ttl;
+    }
+    transmitRREQ(destNodeID, ttl);
+}
+
+TickType_t AODVRouter::ringTraversalTicks(uint8_t ttl)
+{
+    return 2 * NODE_TRAVERSAL_TICKS * (ttl + RREQ_TIMEOUT_BUFFER);
+}
+
+TickType_t AODVRouter::discoveryTimeout(const RouteDiscovery &d)
+{
+    if (d.ttl < NET_DIAMETER)
+        return ringTraversalTicks(d.ttl);
+    // network-wide: the last chance for a late RREP before giving up
+    return DISCOVERY_HOLD_TICKS;
+}
+
+void AODVRouter::armDiscovery(RouteDiscovery &d, uint32_t key, TickType_t now)
+{
+    d.deadline = now + discoveryTimeout(d);
+    _timers.cancel(d.timer);
+    d.timer = armTimer(RouterTimer::Discovery, key, d.deadline);
+}
+
+void AODVRouter::endDiscovery(std::map<uint32_t, RouteDiscovery> &discoveries, uint32_t key)
+{
+    auto it = discoveries.find(key);
+    if (it == discoveries.end())
+        return;
+    _timers.cancel(it->second.timer);
+    discoveries.erase(it);
+}
+
+bool AODVRouter::discoveryInFlight(const RouteDiscovery &d, TickType_t now)
+{
+    TickType_t sent = d.deadline - discoveryTimeout(d);
+    return now - sent < ringTraversalTicks(d.ttl);
+}
+
+bool AODVRouter::advanceDiscovery(RouteDiscovery &d)
+{
+    if (d.ttl < RREQ_TTL_THRESHOLD)
+        d.ttl += RREQ_TTL_INCREMENT;
+    else if (d.ttl < NET_DIAMETER)
+        d.ttl = NET_DIAMETER;
+    else
+        return false;
+    if (d.ttl > RREQ_TTL_THRESHOLD)
+        d.ttl = NET_DIAMETER;
+    return true;
+}
+
+void AODVRouter::checkRouteDiscoveries()
+{
+    std::vector<uint32_t> resolved, failed, repairsFailed;
+    std::vector<std::pair<uint32_t, uint8_t>> resend;
+    std::vector<uint32_t> usersResolved, usersFailed;
+    {
+        Lock l(_mutex);
+        TickType_t now = xTaskGetTickCount();
+        for (auto it = _discoveries.begin(); it != _discoveries.end();)
+        {
+            RouteDiscovery &d = it->second;
+            const RouteEntry *re = _routeTable.find(it->first);
+            if (re != nullptr && !routeExpired(*re, now))
+            {
+                // learned some other way than an RREP to us (overheard RREQ, data)
+                _timers.cancel(d.timer);
+                resolved.push_back(it->first);
+                it = _discoveries.erase(it);
+                continue;
+            }
+            if ((int32_t)(now - d.deadline) < 0)
+            {
+                ++it;
+                continue;
+            }
+
+            // held frames get one ring: the origins rediscover once they hear our RERR
+            if (_repairFrames.count(it->first))
+                repairsFailed.push_back(it->first);
+            if (d.localRepair)
+            {
+                ++_discoveryStats.repairsFailed;
+                d.localRepair = false;
+                bool ours = _pending.count(PendingKind::Data, it->first) != 0 ||
+                            _pending.count(PendingKind::UserRoute, it->first) != 0 ||
+                            _pending.count(PendingKind::MoveReq, it->first) != 0;
+                if (!ours)
+                {
+                    it = _discoveries.erase(it);
+                    continue;
+                }
+                // our own messages joined it meanwhile: they get the full ring
+            }
+
+            if (!advanceDiscovery(d))
+            {
+                ++_discoveryStats.failed;
+                failed.push_back(it->first);
+                it = _discoveries.erase(it);
+                continue;
+            }
+            ++_discoveryStats.retries;
+            armDiscovery(d, it->first, now);
+            resend.push_back({it->first, d.ttl});
+            ++it;
+        }
+
+        // UREQs are always network-wide: there is no ring to widen, only the hold
+        for (auto it = _userDiscoveries.begin(); it != _userDiscoveries.end();)
+        {
+            RouteDiscovery &d = it->second;
+            if (_gut.count(it->first))
+            {
+                _timers.cancel(d.timer);
+                usersResolved.push_back(it->first);
+                it = _userDiscoveries.erase(it);
+                continue;
+            }
+            if ((int32_t)(now - d.deadline) < 0)
+            {
+                ++it;
+                continue;
+            }
+            ++_discoveryStats.failed;
+            usersFailed.push_back(it->first);
+            it = _userDiscoveries.erase(it);
+        }
+    }
+
+    for (uint32_t dest : resolved)
+    {
+        flushDataQueue(dest);
+        flushMoveReqBuffer(dest);
+        flushUserRouteBuffer(dest);
+        flushRepairFrames(dest);
+    }
+    for (uint32_t dest : repairsFailed)
+        failRepair(dest);
+    for (auto &r : resend)
+    {
+        Serial.printf("[AODVRouter] No RREP for %u, retrying with ttl %u\n", r.first, r.second);
+        transmitRREQ(r.first, r.second);
+    }
+    for (uint32_t dest : failed)
+        failRouteDiscovery(dest);
+
+    for (uint32_t user : usersResolved)
+        flushUserMessageBuffer(user);
+    for (uint32_t user : usersFailed)
+        failUserDiscovery(user);
+}
+
+void AODVRouter::failUserDiscovery(uint32_t userID)
+{
+    Serial.printf("[AODVRouter] User discovery for %u failed\n", userID);
+    for (auto &msg : popBufferedUserMessages(userID))
+    {
+        _clientNotifier->notify(Outgoing{BleType::BLE_ACK_FAILURE, msg.senderID, 0, nullptr, 0, msg.packetID});
+        vPortFree(msg.message);
+    }
+}
+
+DiscoveryStats AODVRouter::getDiscoveryStats() const
+{
+    Lock l(_mutex);
+    return _discoveryStats;
+}
+
+void AODVRouter::failRouteDiscovery(uint32_t destNodeID)
+{
+    Serial.printf("[AODVRouter] Route discovery for %u failed\n", destNodeID);
+
+    std::vector<PendingMessage> data;
+    {
+        Lock l(_mutex);
+        data = _pending.take(PendingKind::Data, destNodeID);
+    }
+    for (auto &pending : data)
+    {
+        _clientNotifier->notify(Outgoing{BleType::BLE_ACK_FAILURE, 0, 0, nullptr, 0, pending.packetID});
+        vPortFree(pending.data);
+    }
+
+    for (auto &entry : popPendingUserRouteMessages(destNodeID))
+    {
+        _clientNotifier->notify(Outgoing{BleType::BLE_ACK_FAILURE, entry.senderID, 0, nullptr, 0, entry.packetID});
+        vPortFree(entry.message);
+    }
+
+    popMoveReq(destNodeID); // the user stays registered here; nothing to report
+    failRepair(destNodeID);
+}
+
+bool AODVRouter::repairRoute(uint32_t finalDest, uint32_t packetID, RadioPacket *frame)
+{
+    uint8_t ttl;
+    {
+        Lock l(_mutex);
+        if (_repairFrames.size() >= LOCAL_REPAIR_MAX_FRAMES)
+            return false;
+        auto cur = _discoveries.find(finalDest);
+        if (cur != _discoveries.end() && discoveryInFlight(cur->second, xTaskGetTickCount()))
+        {
+            // somebody is looking already: wait on that
+            _repairFrames.emplace(finalDest, std::make_pair(packetID, frame));
+            ++_discoveryStats.coalesced;
+            return true;
+        }
+        auto h = _destHistory.find(finalDest);
+        if (cur != _discoveries.end() || h == _destHistory.end() || h->second.hopCount == 0 ||
+            h->second.hopCount + LOCAL_REPAIR_ADD_TTL > LOCAL_REPAIR_MAX_TTL)
+            return false;
+        ttl = h->second.hopCount + LOCAL_REPAIR_ADD_TTL;
+        auto it = _discoveries.emplace(finalDest, RouteDiscovery{ttl, 0, 0, true}).first;
+        armDiscovery(it->second, finalDest, xTaskGetTickCount());
+        _repairFrames.emplace(finalDest, std::make_pair(packetID, frame));
+        ++_discoveryStats.repairs;
+    }
+    Serial.printf("[AODVRouter] Local repair of route to %u, ttl %u, holding pkt %u\n", finalDest, ttl, packetID);
+    transmitRREQ(finalDest, ttl);
+    return true;
+}
+
+bool AODVRouter::holdForRepair(const BaseHeader &fwd, uint32_t finalDest)
+{
+    if (!_rxSealed.valid || !hopInvariant(fwd.packetType) ||
+        fwd.originNodeID != _rxSealed.originNodeID || fwd.packetID != _rxSealed.packetID)
+        return false;
+
+    // the frame as it would be relayed; its next hop is filled in once there is one
+    RadioPacket *frame = FramePool::instance().share(_rxSealed.frame);
+    if (frame == nullptr)
+        return false;
+    BaseHeader hdr = fwd;
+    hdr.hopCount++;
+    hdr.flags = _rxSealed.flags;
+    serialiseBaseHeader(hdr, frame->data);
+    if (!repairRoute(finalDest, hdr.packetID, frame))
+    {
+        FramePool::instance().release(frame);
+        return false;
+    }
+    _rxSealed.valid = false; // the buffer now belongs to the TX path
+    return true;
+}
+
+std::vector<std::pair<uint32_t, RadioPacket *>> AODVRouter::takeRepairFrames(uint32_t destNodeID)
+{
+    std::vector<std::pair<uint32_t, RadioPacket *>> held;
+    Lock l(_mutex);
+    auto range = _repairFrames.equal_range(destNodeID);
+    for (auto it = range.first; it != range.second; ++it)
+        held.push_back(it->second);
+    _repairFrames.erase(range.first, range.second);
+    return held;
+}
+
+void AODVRouter::flushRepairFrames(uint32_t destNodeID)
+{
+    for (auto &h : takeRepairFrames(destNodeID))
+    {
+        RouteEntry re;
+        BaseHeader bh;
+        deserialiseBaseHeader(h.second->data, bh);
+        if (!getRoute(destNodeID, re))
+        {
+            sendRERR(_myNodeID, bh.originNodeID, destNodeID, h.first);
+            FramePool::instance().release(h.second);
+            continue;
+        }
+        Serial.printf("[AODVRouter] Route to %u repaired, sending pkt %u via %u\n", destNodeID, h.first, re.nextHop);
+        touchRoute(destNodeID);
+        touchRoute(re.nextHop);
+        bh.destNodeID = re.nextHop;
+        serialiseBaseHeader(bh, h.second->data);
+        sendFrame(bh, h.second);
+    }
+}
+
+void AODVRouter::failRepair(uint32_t destNodeID)
+{
+    for (auto &h : takeRepairFrames(destNodeID))
+    {
+        BaseHeader bh;
+        deserialiseBaseHeader(h.second->data, bh);
+        Serial.printf("[AODVRouter] Local repair of route to %u failed – sending RERR for pkt %u\n", destNodeID, h.first);
+        sendRERR(_myNodeID, bh.originNodeID, destNodeID, h.first);
+        FramePool::instance().release(h.second);
+    }
+}
+
+void AODVRouter::transmitRREQ(uint32_t destNodeID, uint8_t ttl)
 {
     BaseHeader bh;
     bh.destNodeID = BROADCAST_ADDR;
@@ -1485,11 +2336,20 @@ void AODVRouter::sendRREQ(uint32_t destNodeID)
 
     RREQHeader rreq;
     rreq.RREQDestNodeID = destNodeID; // ID of node route required for
+    {
+        Lock l(_mutex);
+        if (++_ownSeqNum == 0)
+            ++_ownSeqNum;
+        rreq.originSeqNum = _ownSeqNum;
+    }
+    rreq.destSeqNum = knownSeqNum(destNodeID);
+    rreq.ttl = ttl;
 
     transmitPacket(bh, (uint8_t *)&rreq, sizeof(RREQHeader));
 }
 
-void AODVRouter::sendRREP(uint32_t originNodeID, uint32_t destNodeID, uint32_t nextHop, uint8_t hopCount)
+void AODVRouter::sendRREP(uint32_t originNodeID, uint32_t destNodeID, uint32_t nextHop, uint8_t hopCount, uint32_t destSeqNum, uint16_t lifetimeS,
+                          uint16_t metric)
 {
     BaseHeader bh;
     bh.destNodeID = nextHop;
@@ -1503,8 +2363,10 @@ void AODVRouter::sendRREP(uint32_t originNodeID, uint32_t destNodeID, uint32_t n
 
     RREPHeader rrep;
     rrep.RREPDestNodeID = destNodeID; // destination of the route
-    rrep.lifetime = 0;
+    rrep.lifetime = lifetimeS;
     rrep.numHops = hopCount;
+    rrep.destSeqNum = destSeqNum;
+    rrep.metric = metric;
 
     transmitPacket(bh, (uint8_t *)&rrep, sizeof(RREPHeader));
 }
@@ -1526,23 +2388,109 @@ void AODVRouter::sendRERR(uint32_t brokenNodeID, uint32_t originNodeID, uint32_t
     rerr.brokenNodeID = brokenNodeID;
     rerr.originalDestNodeID = originalDest;
     rerr.originalPacketID = originalPacketID;
+    // the reported route is dead: advertise a seq newer than the one it had
+    uint32_t known = knownSeqNum(originalDest);
+    rerr.destSeqNum = seqNumNext(known);
 
     transmitPacket(bh, (uint8_t *)&rerr, sizeof(RERRHeader));
 }
 
-void AODVRouter::sendUREQ(uint32_t userID)
+void AODVRouter::sendPrecursorRERR(uint32_t brokenNodeID, const std::vector<std::pair<uint32_t, uint32_t>> &unreachable,
+                                   const std::vector<uint32_t> &precursors)
 {
+    if (unreachable.empty() || precursors.empty())
+        return;
+
+    // the first destination rides in the RERRHeader, the rest in the trailer
+    constexpr size_t PAIR = 2 * sizeof(uint32_t);
+    constexpr size_t SPACE = sizeof(RadioPacket::data) - sizeof(BaseHeader) - TAG_LEN -
+                             sizeof(RERRHeader) - sizeof(RERRDestListHeader);
+    constexpr size_t DESTS_PER_PKT = 1 + SPACE / PAIR;
+    static_assert(DESTS_PER_PKT - 1 <= 0xFF, "trailer count must fit a byte");
+
     BaseHeader bh;
-    bh.destNodeID = BROADCAST_ADDR;
+    // one frame on air either way; neighbours that do not route through us ignore it
+    bh.destNodeID = precursors.size() == 1 ? precursors[0] : BROADCAST_ADDR;
     bh.prevHopID = _myNodeID;
     bh.originNodeID = _myNodeID;
-    bh.packetID = esp_random();
-    bh.packetType = PKT_UREQ;
+    bh.packetType = PKT_RERR;
     bh.flags = 0;
     bh.hopCount = 0;
     bh.reserved = 0;
 
-    UREQHeader ureq;
+    uint32_t frames = 0;
+    for (size_t i = 0; i < unreachable.size(); i += DESTS_PER_PKT)
+    {
+        size_t n = std::min(DESTS_PER_PKT, unreachable.size() - i);
+
+        RERRHeader rerr;
+        rerr.reporterNodeID = _myNodeID;
+        rerr.brokenNodeID = brokenNodeID;
+        rerr.originalDestNodeID = unreachable[i].first;
+        rerr.originalPacketID = 0; // no one frame: the break itself
+        rerr.destSeqNum = unreachable[i].second;
+
+        uint8_t list[sizeof(RERRDestListHeader) + (DESTS_PER_PKT - 1) * PAIR];
+        RERRDestListHeader lh{uint8_t(n - 1)};
+        size_t at = serialiseRERRDestListHeader(lh, list, 0);
+        for (size_t k = 1; k < n; ++k)
+        {
+            memcpy(list + at, &unreachable[i + k].first, 4);
+            memcpy(list + at + 4, &unreachable[i + k].second, 4);
+            at += PAIR;
+        }
+
+        bh.packetID = esp_random();
+        transmitPacket(bh, (uint8_t *)&rerr, sizeof(RERRHeader), n > 1 ? list : nullptr, n > 1 ? at : 0);
+        ++frames;
+    }
+
+    Serial.printf("[AODVRouter] RERR for %u destinations behind %u sent to %u precursors\n",
+                  (unsigned)unreachable.size(), brokenNodeID, (unsigned)precursors.size());
+    Lock l(_mutex);
+    _rerrStats.sent += frames;
+    _rerrStats.listed += unreachable.size();
+}
+
+void AODVRouter::sendUREQ(uint32_t userID)
+{
+    {
+        Lock l(_mutex);
+        TickType_t now = xTaskGetTickCount();
+        auto it = _userDiscoveries.find(userID);
+        if (it == _userDiscoveries.end())
+        {
+            it = _userDiscoveries.emplace(userID, RouteDiscovery{NET_DIAMETER, 0, 0, false}).first;
+            ++_discoveryStats.started;
+        }
+        else if (discoveryInFlight(it->second, now))
+        {
+            ++_discoveryStats.coalesced;
+            Serial.printf("[AODVRouter] User discovery for %u already pending\n", userID);
+            return;
+        }
+        else
+        {
+            ++_discoveryStats.retries;
+        }
+        armDiscovery(it->second, userID, now);
+    }
+    transmitUREQ(userID);
+}
+
+void AODVRouter::transmitUREQ(uint32_t userID)
+{
+    BaseHeader bh;
+    bh.destNodeID = BROADCAST_ADDR;
+    bh.prevHopID = _myNodeID;
+    bh.originNodeID = _myNodeID;
+    bh.packetID = esp_random();
+    bh.packetType = PKT_UREQ;
+    bh.flags = 0;
+    bh.hopCount = 0;
+    bh.reserved = 0;
+
+    UREQHeader ureq;
     ureq.userID = userID;
 
     transmitPacket(bh, (uint8_t *)&ureq, sizeof(UREQHeader));
@@ -1688,15 +2636,10 @@ void AODVRouter::sendPubKeyResp(uint32_t destNodeID, uint32_t targetUserID, uint
 void AODVRouter::flushDataQueue(uint32_t destNodeID)
 {
 
-    std::vector<dataBufferEntry> pendingList;
+    std::vector<PendingMessage> pendingList;
     {
         Lock l(_mutex);
-        auto it = _dataBuffer.find(destNodeID);
-        if (it != _dataBuffer.end())
-        {
-            pendingList = std::move(it->second);
-            _dataBuffer.erase(it);
-        }
+        pendingList = _pending.take(PendingKind::Data, destNodeID);
     }
 
     for (auto &pending : pendingList)
@@ -1708,6 +2651,8 @@ void AODVRouter::flushDataQueue(uint32_t destNodeID)
             {
                 pending.packetID = (uint32_t)esp_random();
             }
+            touchRoute(destNodeID);
+            touchRoute(re.nextHop);
             BaseHeader bh;
             bh.destNodeID = re.nextHop;
             bh.prevHopID = _myNodeID;
@@ -1727,12 +2672,26 @@ void AODVRouter::flushDataQueue(uint32_t destNodeID)
         }
         else
         {
-            // Need to deallocate data in pending AND add back to the data buffer
-            insertDataBuffer(destNodeID, pending.data, pending.length, pending.packetID);
+            // Back into the buffer, keeping its original expiry
+            pushPending(pending);
         }
     }
 }
 
+void AODVRouter::flushUserMessageBuffer(uint32_t userID)
+{
+    auto pending = popBufferedUserMessages(userID);
+    for (auto &msg : pending)
+    {
+        sendUserMessage(msg.senderID,
+                        userID,
+                        msg.message,
+                        msg.length,
+                        msg.packetID); // keeps original pktId
+        vPortFree(msg.message);
+    }
+}
+
 void AODVRouter::flushMoveReqBuffer(uint32_t nodeID)
 {
     auto v = popMoveReq(nodeID);
@@ -1830,114 +2789,233 @@ void AODVRouter::transmitPacket(const BaseHeader &header,
                                 const uint8_t *payload, size_t payloadLen)
 
 {
-
-    if (_mqttManager && _mqttManager->connected)
+    /* ---- stamp our own originations with the next sequence number -- */
+    BaseHeader stamped = header;
+    if (stamped.originNodeID == _myNodeID && stamped.originSeq == 0)
     {
-        /* ---- build plaintext copy ----------------------------------- */
-        uint8_t clearBuf[255];
-        size_t clearLen = 0;
-
-        if (sizeof(clearBuf) < sizeof(BaseHeader) + extLen + payloadLen)
-        {
-            Serial.println("[AODV] oversize plaintext pkt");
-            return;
-        }
+        stamped.originSeq = nextOriginSeq();
+    }
 
-        BaseHeader hdrClear = header; // no ENC flag
-        clearLen += serialiseBaseHeader(hdrClear, clearBuf);
+    publishClear(stamped, extHeader, extLen, payload, payloadLen);
 
-        if (extHeader && extLen)
-        {
-            memcpy(clearBuf + clearLen, extHeader, extLen);
-            clearLen += extLen;
-        }
-        if (payload && payloadLen)
-        {
-            memcpy(clearBuf + clearLen, payload, payloadLen);
-            clearLen += payloadLen;
-        }
+    /* ---- build mutable header with ENC flag -------------------- */
+    BaseHeader hdrOut = stamped;
+    hdrOut.flags |= FLAG_ENCRYPTED;
 
-        _mqttManager->publishPacket(hdrClear.packetID, clearBuf, clearLen);
+    size_t plainLen = (extHeader ? extLen : 0) + (payload ? payloadLen : 0);
+    if (sizeof(BaseHeader) + plainLen + TAG_LEN > sizeof(RadioPacket::data))
+    {
+        Serial.println("[AODV] oversize pkt");
+        return;
     }
 
-    /* ---- build mutable header with ENC flag -------------------- */
-    BaseHeader hdrOut = header;
-    hdrOut.flags |= FLAG_ENCRYPTED;
+    /* The frame is built where it will be sent from:
+       [BaseHeader][extHeader || payload, encrypted in place][tag]     */
+    RadioPacket *frame = FramePool::instance().alloc();
+    if (frame == nullptr)
+    {
+        Serial.println("[AODV] frame pool exhausted – drop");
+        return;
+    }
 
-    uint8_t buffer[255];
-    size_t offset = 0;
-    offset += serialiseBaseHeader(hdrOut, buffer + offset);
+    size_t offset = serialiseBaseHeader(hdrOut, frame->data);
+    uint8_t *cipher = frame->data + offset;
+    uint8_t *tag = cipher + plainLen;
 
     /* ----  marshal plaintext (= extHeader || payload) -------------- */
-    uint8_t plain[255];
-    size_t plainLen = 0;
-
+    size_t at = 0;
     if (extHeader && extLen)
     {
-        memcpy(plain + plainLen, extHeader, extLen);
-        plainLen += extLen;
+        memcpy(cipher + at, extHeader, extLen);
+        at += extLen;
     }
     if (payload && payloadLen)
     {
-        memcpy(plain + plainLen, payload, payloadLen);
-        plainLen += payloadLen;
-    }
-
-    if (offset + plainLen + TAG_LEN > sizeof(buffer))
-    {
-        Serial.println("[AODV] oversize pkt");
-        return;
+        memcpy(cipher + at, payload, payloadLen);
     }
 
     /* ----  encrypt -------------------------------------------------- */
     uint8_t nonce[NONCE_LEN];
     buildNonce(hdrOut, nonce);
 
-    uint8_t *cipher = buffer + offset;
-    uint8_t *tag = cipher + plainLen;
+    uint8_t aad[sizeof(BaseHeader)];
+    size_t aadLen = buildAad(hdrOut, aad);
 
     if (!aes_gcm_encrypt(nonce, NONCE_LEN,
-                         buffer, sizeof(BaseHeader),
-                         plain, plainLen,
+                         aad, aadLen,
+                         cipher, plainLen,
                          cipher, tag, TAG_LEN))
     {
         Serial.println("[AODV] encrypt fail");
+        FramePool::instance().release(frame);
         return;
     }
 
-    offset += plainLen + TAG_LEN; /* final packet length */
+    frame->len = offset + plainLen + TAG_LEN; /* final packet length */
+
+    sendFrame(hdrOut, frame);
+}
+
+void AODVRouter::forwardPacket(const BaseHeader &fwd,
+                               const uint8_t *extHeader, size_t extLen,
+                               const uint8_t *payload, size_t payloadLen)
+{
+    if (!_rxSealed.valid || !hopInvariant(fwd.packetType) ||
+        fwd.originNodeID != _rxSealed.originNodeID || fwd.packetID != _rxSealed.packetID)
+    {
+        transmitPacket(fwd, extHeader, extLen, payload, payloadLen);
+        return;
+    }
 
-    Serial.printf("[AODVRouer] Added packet with len %u\n", offset);
+    /* The nonce of a hop-invariant frame does not change along the path,
+       so the plaintext must be exactly what we received: the same nonce
+       over a different plaintext would break GCM.                     */
+    bool same = extLen + payloadLen == _rxSealed.plainLen &&
+                (extLen == 0 || memcmp(_rxSealed.plain, extHeader, extLen) == 0) &&
+                (payloadLen == 0 || memcmp(_rxSealed.plain + extLen, payload, payloadLen) == 0);
+    BaseHeader hdrOut = fwd;
+    hdrOut.flags |= FLAG_ENCRYPTED;
+    if (!same || hdrOut.flags != _rxSealed.flags)
+    {
+        Serial.println("[AODV] relay changed a hop-invariant frame – dropped");
+        return;
+    }
 
-    if (!_radioManager->enqueueTxPacket(buffer, offset))
+    /* send the received frame itself: only the per-hop header is
+       rewritten, in place, the sealed body is not touched            */
+    RadioPacket *frame = FramePool::instance().share(_rxSealed.frame);
+    if (frame == nullptr)
+    {
+        Serial.println("[AODV] frame pool exhausted – drop");
+        return;
+    }
+    _rxSealed.valid = false; // the buffer now belongs to the TX path
+
+    publishClear(fwd, extHeader, extLen, payload, payloadLen);
+
+    serialiseBaseHeader(hdrOut, frame->data);
+    {
+        Lock l(_mutex);
+        ++_rxStats.relayedSealed;
+    }
+    sendFrame(hdrOut, frame);
+}
+
+void AODVRouter::publishClear(const BaseHeader &header,
+                              const uint8_t *extHeader, size_t extLen,
+                              const uint8_t *payload, size_t payloadLen)
+{
+    if (!_mqttManager || !_mqttManager->connected)
+        return;
+
+    /* ---- build plaintext copy ----------------------------------- */
+    uint8_t clearBuf[255];
+    size_t clearLen = 0;
+
+    if (sizeof(clearBuf) < sizeof(BaseHeader) + extLen + payloadLen)
+    {
+        Serial.println("[AODV] oversize plaintext pkt");
+        return;
+    }
+
+    BaseHeader hdrClear = header; // no ENC flag
+    clearLen += serialiseBaseHeader(hdrClear, clearBuf);
+
+    if (extHeader && extLen)
+    {
+        memcpy(clearBuf + clearLen, extHeader, extLen);
+        clearLen += extLen;
+    }
+    if (payload && payloadLen)
+    {
+        memcpy(clearBuf + clearLen, payload, payloadLen);
+        clearLen += payloadLen;
+    }
+
+    _mqttManager->publishPacket(hdrClear.packetID, clearBuf, clearLen);
+}
+
+void AODVRouter::relayFlood(const BaseHeader &fwd,
+                            const uint8_t *extHeader, size_t extLen,
+                            const uint8_t *payload, size_t payloadLen)
+{
+    {
+        Lock l(_mutex);
+        if (fwd.hopCount >= floodHopLimit(fwd.packetType))
+        {
+            Serial.printf("[AODVRouter] Flood type %u reached its hop limit, not relayed\n", fwd.packetType);
+            ++_floodStats.hopLimited;
+            return;
+        }
+        ++_floodStats.relayed;
+    }
+    forwardPacket(fwd, extHeader, extLen, payload, payloadLen);
+}
+
+FloodStats AODVRouter::getFloodStats() const
+{
+    Lock l(_mutex);
+    return _floodStats;
+}
+
+void AODVRouter::sendFrame(const BaseHeader &hdrOut, RadioPacket *frame)
+{
+    Serial.printf("[AODVRouer] Added packet with len %u\n", frame->len);
+
+    // the ACK buffer holds the same frame as the TX queue, not a copy
+    bool keep = hdrOut.destNodeID != BROADCAST_ADDR && hdrOut.flags & REQ_ACK;
+    if (keep)
+        FramePool::instance().retain(frame);
+
+    if (!_radioManager->enqueueTxFrame(frame))
     {
         Serial.println("[AODV] enqueueTxPacket failed");
+        if (keep)
+            FramePool::instance().release(frame);
         return;
     }
 
-    if (hdrOut.destNodeID != BROADCAST_ADDR && hdrOut.flags & REQ_ACK)
+    if (keep)
     {
         Serial.println("STORING ACKNOWLEDGED PACKET");
         RouteEntry re;
         // This should probably be changed to actual destination rather than just next hop
         if (getRoute(hdrOut.destNodeID, re))
         {
-            storeAckPacket(hdrOut.packetID, buffer, offset, re.nextHop);
+            storeAckPacket(hdrOut.packetID, frame, re.nextHop);
+        }
+        else
+        {
+            FramePool::instance().release(frame);
         }
     }
 }
 
 // ROUTING TABLE HELPER FUNCTIONS
 
-void AODVRouter::updateRoute(uint32_t destination, uint32_t nextHop, uint8_t hopCount)
+uint16_t AODVRouter::linkCost(uint32_t neighbour)
 {
     Lock l(_mutex);
-    auto it = _routeTable.find(destination);
-    if (it == _routeTable.end())
+    return _links.etx(neighbour);
+}
+
+void AODVRouter::updateRoute(uint32_t destination, uint32_t nextHop, uint8_t hopCount, uint32_t destSeqNum, TickType_t lifetime,
+                             uint16_t metric)
+{
+    Lock l(_mutex);
+    TickType_t now = xTaskGetTickCount();
+    recordSeqNum(destination, destSeqNum);
+    if (metric == 0)
+        metric = estimateMetric(nextHop, hopCount);
+    RouteEntry *cur = _routeTable.find(destination);
+    if (cur == nullptr)
     {
         // new route
-        RouteEntry re{nextHop, hopCount};
-        _routeTable[destination] = re;
+        RouteEntry re{nextHop, hopCount, metric, now + lifetime, destSeqNum};
+        if (_routeTable.full())
+            evictRoute(now);
+        _routeTable.insert(destination, re);
+        _destHistory[destination].hopCount = hopCount;
         Serial.printf("[AODVRouter] Added route to %u via %u, hopCount=%u\n", destination, nextHop, hopCount);
         if (_mqttManager != nullptr && _mqttManager->connected)
         {
@@ -1947,62 +3025,351 @@ void AODVRouter::updateRoute(uint32_t destination, uint32_t nextHop, uint8_t hop
     }
     else
     {
-        // possibly update if shorter
-        if (hopCount < it->second.hopcount)
+        /*  Freshness first, then cost (RFC 3561 §6.2 with ETX in place of
+            hop count). Routes learned without a sequence number (data,
+            beacons) only win on cost when we hold no sequence number
+            either, or when we hear the destination directly. A cheaper
+            route must beat the current one by LINK_ETX_HYSTERESIS; at
+            equal cost the one with fewer hops wins.                    */
+        bool fresher = destSeqNum != 0 && (cur->destSeqNum == 0 || seqNumNewer(destSeqNum, cur->destSeqNum));
+        bool sameSeq = destSeqNum == cur->destSeqNum;
+        bool direct = (nextHop == destination && hopCount == 1);
+        uint16_t curMetric = cur->metric ? cur->metric : (uint16_t)(cur->hopcount * ETX_UNIT);
+        bool cheaper = (uint32_t)metric + LINK_ETX_HYSTERESIS < curMetric ||
+                       (metric <= curMetric && hopCount < cur->hopcount);
+        cheaper = cheaper && (sameSeq || cur->destSeqNum == 0 || (destSeqNum == 0 && direct));
+
+        if (fresher || cheaper || routeExpired(*cur, now))
         {
-            it->second.nextHop = nextHop;
-            it->second.hopcount = hopCount;
-            Serial.printf("[AODVRouter] Updated route to %u via %u, hopCount=%u\n", destination, nextHop, hopCount);
+            RouteEntry old = *cur;
+            RouteEntry re{nextHop, hopCount, metric, now + lifetime, destSeqNum ? destSeqNum : cur->destSeqNum};
+            _routeTable.insert(destination, re);
+            // displaced by a cheaper path of the same freshness: still a way there
+            if (!fresher && !routeExpired(old, now) && old.nextHop != nextHop)
+                learnBackup(destination, old.nextHop, old.hopcount, old.destSeqNum, old.expiresAt - now, old.metric);
+            _destHistory[destination].hopCount = hopCount;
+            Serial.printf("[AODVRouter] Updated route to %u via %u, hopCount=%u, etx=%u, seq=%u\n", destination, nextHop, hopCount,
+                          metric, re.destSeqNum);
             if (_mqttManager != nullptr && _mqttManager->connected)
             {
                 // send the new routeEntry over mqtt
                 _mqttManager->publishUpdateRoute(destination, nextHop, hopCount);
             }
         }
+        else if (nextHop == cur->nextHop)
+        {
+            // the same neighbour still reaches it – keep it alive, at what it costs now
+            if ((int32_t)(now + lifetime - cur->expiresAt) > 0)
+                cur->expiresAt = now + lifetime;
+            cur->metric = metric;
+        }
+        else if (nextHop != cur->nextHop)
+        {
+            learnBackup(destination, nextHop, hopCount, destSeqNum, lifetime, metric);
+        }
     }
+
+    // a discovery waiting on this destination can end now rather than at its deadline
+    if (_discoveries.count(destination))
+        armTimer(RouterTimer::Discovery, destination, now);
 }
 
-bool AODVRouter::hasRoute(uint32_t destination)
+uint16_t AODVRouter::estimateMetric(uint32_t nextHop, uint8_t hopCount)
+{
+    // nothing measured past the first hop: price the rest as clean hops
+    uint32_t est = linkCost(nextHop) + (uint32_t)(hopCount ? hopCount - 1 : 0) * ETX_UNIT;
+    return est > 0xFFFF ? 0xFFFF : (uint16_t)est;
+}
+
+void AODVRouter::learnBackup(uint32_t destination, uint32_t nextHop, uint8_t hopCount, uint32_t destSeqNum,
+                             TickType_t lifetime, uint16_t metric)
 {
     Lock l(_mutex);
-    return (_routeTable.find(destination) != _routeTable.end());
+    const RouteEntry *cur = _routeTable.find(destination);
+    if (cur == nullptr || nextHop == cur->nextHop || nextHop == _myNodeID || hopCount > cur->hopcount + 1)
+        return;
+    if (destSeqNum != 0 && cur->destSeqNum != 0 && seqNumNewer(cur->destSeqNum, destSeqNum))
+        return;
+    if (metric == 0)
+        metric = estimateMetric(nextHop, hopCount);
+    RouteEntry alt{nextHop, hopCount, metric, xTaskGetTickCount() + lifetime, destSeqNum ? destSeqNum : cur->destSeqNum};
+    if (_routeTable.addBackup(destination, alt))
+    {
+        ++_backupStats.learned;
+        Serial.printf("[AODVRouter] Backup route to %u via %u, hopCount=%u, etx=%u\n", destination, nextHop, hopCount, metric);
+    }
+}
+
+bool AODVRouter::backupUsable(uint32_t destination, const RouteEntry &re, TickType_t now)
+{
+    LinkQuality lq;
+    if (routeExpired(re, now) || !_links.find(re.nextHop, lq))
+        return false;
+    uint32_t known = knownSeqNum(destination);
+    return re.destSeqNum == 0 || known == 0 || !seqNumNewer(known, re.destSeqNum);
+}
+
+bool AODVRouter::failoverRoute(uint32_t destination, uint32_t avoid, uint32_t avoid2)
+{
+    uint32_t nextHop;
+    uint8_t hopCount;
+    {
+        Lock l(_mutex);
+        const RouteEntry *cur = _routeTable.find(destination);
+        if (cur == nullptr || (cur->nextHop != avoid && cur->nextHop != avoid2))
+            return false;
+        TickType_t now = xTaskGetTickCount();
+        const RouteEntry *re = _routeTable.promote(destination, [&](uint32_t dest, const RouteEntry &alt)
+                                                   { return alt.nextHop != avoid && alt.nextHop != avoid2 &&
+                                                            backupUsable(dest, alt, now); });
+        if (re == nullptr)
+        {
+            ++_backupStats.lost;
+            return false;
+        }
+        nextHop = re->nextHop;
+        hopCount = re->hopcount;
+        ++_backupStats.failovers;
+    }
+    Serial.printf("[AODVRouter] Route to %u failed over to %u, hopCount=%u\n", destination, nextHop, hopCount);
+    if (_mqttManager != nullptr && _mqttManager->connected)
+        _mqttManager->publishUpdateRoute(destination, nextHop, hopCount);
+    return true;
+}
+
+uint32_t AODVRouter::knownSeqNum(uint32_t destination) const
+{
+    Lock l(_mutex);
+    auto it = _destHistory.find(destination);
+    return it == _destHistory.end() ? 0 : it->second.seqNum;
+}
+
+void AODVRouter::recordSeqNum(uint32_t destination, uint32_t seq)
+{
+    if (seq == 0)
+        return;
+    Lock l(_mutex);
+    uint32_t &known = _destHistory[destination].seqNum;
+    if (known == 0 || seqNumNewer(seq, known))
+        known = seq;
+}
+
+bool AODVRouter::hasRoute(uint32_t destination)
+{
+    RouteEntry re;
+    return getRoute(destination, re);
 }
 
 bool AODVRouter::getRoute(uint32_t destination, RouteEntry &routeEntry)
 {
     Lock l(_mutex);
-    auto it = _routeTable.find(destination);
-    if (it == _routeTable.end())
+    const RouteEntry *re = _routeTable.find(destination);
+    if (re == nullptr)
+        return false;
+    if (routeExpired(*re, xTaskGetTickCount()))
+    {
+        // stale: callers treat this as "no route" and rediscover
+        Serial.printf("[AODVRouter] Route to %u expired\n", destination);
+        dropRoute(destination);
         return false;
-    routeEntry = it->second;
+    }
+    routeEntry = *re;
     return true;
 }
 
+void AODVRouter::touchRoute(uint32_t destination)
+{
+    Lock l(_mutex);
+    RouteEntry *re = _routeTable.find(destination);
+    if (re == nullptr)
+        return;
+    TickType_t now = xTaskGetTickCount();
+    if (routeExpired(*re, now))
+        return;
+    if ((int32_t)(now + ACTIVE_ROUTE_TIMEOUT_TICKS - re->expiresAt) > 0)
+        re->expiresAt = now + ACTIVE_ROUTE_TIMEOUT_TICKS;
+}
+
+void AODVRouter::refreshRoutesVia(uint32_t nextHop)
+{
+    Lock l(_mutex);
+    TickType_t now = xTaskGetTickCount();
+    _routeTable.forEachVia(nextHop, [&](uint32_t, RouteEntry &re)
+                           {
+        if (!routeExpired(re, now) && (int32_t)(now + ACTIVE_ROUTE_TIMEOUT_TICKS - re.expiresAt) > 0)
+            re.expiresAt = now + ACTIVE_ROUTE_TIMEOUT_TICKS; });
+}
+
+void AODVRouter::addPrecursor(uint32_t destination, uint32_t neighbour)
+{
+    if (neighbour == _myNodeID || neighbour == destination)
+        return;
+    Lock l(_mutex);
+    _routeTable.addPrecursor(destination, neighbour);
+}
+
+void AODVRouter::collectPrecursors(uint32_t destination, uint32_t except, std::vector<uint32_t> &out) const
+{
+    uint8_t n;
+    const uint32_t *p = _routeTable.precursors(destination, n);
+    for (uint8_t i = 0; i < n; ++i)
+    {
+        if (p[i] != except && std::find(out.begin(), out.end(), p[i]) == out.end())
+            out.push_back(p[i]);
+    }
+}
+
+uint16_t AODVRouter::remainingLifetimeS(const RouteEntry &re) const
+{
+    int32_t left = (int32_t)(re.expiresAt - xTaskGetTickCount());
+    if (left <= 0)
+        return 0;
+    uint32_t s = (uint32_t)left / pdMS_TO_TICKS(1000);
+    return s > 0xFFFF ? 0xFFFF : (uint16_t)s;
+}
+
+void AODVRouter::evictRoute(TickType_t now)
+{
+    // table full: drop the route closest to (or furthest past) its expiry
+    uint32_t victim = 0;
+    int32_t soonest = INT32_MAX;
+    _routeTable.forEach([&](uint32_t dest, const RouteEntry &re)
+                        {
+        int32_t left = (int32_t)(re.expiresAt - now);
+        if (left < soonest)
+        {
+            soonest = left;
+            victim = dest;
+        } });
+    Serial.printf("[AODVRouter] Route table full, evicting route to %u\n", victim);
+    dropRoute(victim);
+}
+
+void AODVRouter::purgeExpiredRoutes()
+{
+    std::vector<uint32_t> expired;
+    {
+        Lock l(_mutex);
+        TickType_t now = xTaskGetTickCount();
+        _routeTable.forEach([&](uint32_t dest, const RouteEntry &re)
+                            {
+            if (routeExpired(re, now))
+                expired.push_back(dest); });
+        for (uint32_t dest : expired)
+            dropRoute(dest);
+    }
+
+    if (!expired.empty())
+        Serial.printf("[AODVRouter] Purged %u expired routes\n", (unsigned)expired.size());
+
+    flushDroppedRoutes();
+}
+
+void AODVRouter::dropRoute(uint32_t destination)
+{
+    if (_routeTable.erase(destination))
+        _droppedRoutes.push_back(destination);
+}
+
+void AODVRouter::flushDroppedRoutes()
+{
+    std::vector<uint32_t> dropped;
+    {
+        Lock l(_mutex);
+        dropped.swap(_droppedRoutes);
+    }
+    if (dropped.empty())
+        return;
+
+    {
+        Lock g(_gwMtx);
+        recomputeClosestGateway();
+    }
+
+    if (_mqttManager != nullptr && _mqttManager->connected)
+    {
+        for (uint32_t dest : dropped)
+        {
+            _mqttManager->publishInvalidateRoute(dest);
+        }
+    }
+}
+
 void AODVRouter::invalidateRoute(uint32_t brokenNodeID, uint32_t finalDestNodeID, uint32_t originNodeID)
 {
     std::set<uint32_t> invalidRoute;
     invalidRoute.insert(brokenNodeID);
     invalidRoute.insert(finalDestNodeID);
 
+    // Decided to remove route to destination node, unless a backup avoids the break
+    bool finalKept = finalDestNodeID != brokenNodeID && failoverRoute(finalDestNodeID, originNodeID, brokenNodeID);
+
+    bool lostNeighbour;
+    std::vector<std::pair<uint32_t, RouteEntry>> failedOver;
+    // whoever forwarded through us to what is now cut off, if we found the break ourselves
+    bool ownBreak = originNodeID == _myNodeID;
+    std::vector<uint32_t> precursors;
+    std::vector<std::pair<uint32_t, uint32_t>> unreachable;
     {
         Lock l(_mutex);
+        const RouteEntry *re = _routeTable.find(brokenNodeID);
+        LinkQuality lq;
+        lostNeighbour = (re != nullptr && re->hopcount == 1) || _links.find(brokenNodeID, lq);
         // remove any routes to the broken node
+        collectPrecursors(brokenNodeID, brokenNodeID, precursors);
         _routeTable.erase(brokenNodeID);
-        // Decided to remove route to destination node
-        _routeTable.erase(finalDestNodeID);
-        // Remove any routes that have the brokenNode as the nextHop
-        for (auto it = _routeTable.begin(); it != _routeTable.end();)
+        // no backup may lead back through it
+        _routeTable.dropBackupsVia(brokenNodeID);
+        if (finalKept)
         {
-            if (it->second.nextHop == brokenNodeID)
-            {
-                invalidRoute.insert(it->first);
-                it = _routeTable.erase(it);
-            }
-            else
-            {
-                ++it;
-            }
+            invalidRoute.erase(finalDestNodeID);
+        }
+        else
+        {
+            collectPrecursors(finalDestNodeID, brokenNodeID, precursors);
+            _routeTable.erase(finalDestNodeID);
         }
+        // Routes that have the brokenNode as the nextHop (next-hop index, no full scan) move
+        // to a backup at once; the ones without are removed
+        TickType_t now = xTaskGetTickCount();
+        _routeTable.failoverVia(
+            brokenNodeID, [&](uint32_t dest, const RouteEntry &alt)
+            { return backupUsable(dest, alt, now); },
+            [&](uint32_t dest, const RouteEntry &alt)
+            { failedOver.emplace_back(dest, alt); },
+            [&](uint32_t dest)
+            { invalidRoute.insert(dest);
+              collectPrecursors(dest, brokenNodeID, precursors);
+              ++_backupStats.lost; });
+        _backupStats.failovers += failedOver.size();
+
+        // bump the known sequence numbers so the next RREQ only accepts
+        // answers fresher than the routes that just broke
+        for (uint32_t dest : invalidRoute)
+        {
+            auto sn = _destHistory.find(dest);
+            if (sn != _destHistory.end())
+                sn->second.seqNum = seqNumNext(sn->second.seqNum);
+            unreachable.emplace_back(dest, sn != _destHistory.end() ? sn->second.seqNum : 0);
+        }
+        if (ownBreak && precursors.empty())
+            ++_rerrStats.unheard;
+    }
+
+    if (ownBreak)
+        sendPrecursorRERR(brokenNodeID, unreachable, precursors);
+
+    if (lostNeighbour)
+    {
+        {
+            Lock l(_mutex);
+            _neighbourhood.forget(brokenNodeID);
+            _links.forget(brokenNodeID);
+            _routeTable.dropPrecursor(brokenNodeID);
+        }
+        std::vector<uint32_t> oneHop;
+        selectMprs(oneHop);
+        resetBeacon();
     }
 
     // TODO: IMPORTANT need to actually remove route to finalDestination
@@ -2016,6 +3383,10 @@ void AODVRouter::invalidateRoute(uint32_t brokenNodeID, uint32_t finalDestNodeID
         {
             _mqttManager->publishInvalidateRoute(dest);
         }
+        for (const auto &f : failedOver)
+        {
+            _mqttManager->publishUpdateRoute(f.first, f.second.nextHop, f.second.hopcount);
+        }
     }
 
     // TODO: Insimulation also remove destination if it goes through the sender (omitted in this case)
@@ -2024,17 +3395,54 @@ void AODVRouter::invalidateRoute(uint32_t brokenNodeID, uint32_t finalDestNodeID
 bool AODVRouter::isDuplicatePacketID(uint32_t packetID)
 {
     Lock l(_mutex);
-    if (receivedPacketIDs.find(packetID) != receivedPacketIDs.end())
+    return _seenPackets.contains(packetID, xTaskGetTickCount());
+}
+
+void AODVRouter::storePacketID(uint32_t packetID)
+{
+    Lock l(_mutex);
+    _seenPackets.insert(packetID, xTaskGetTickCount());
+}
+
+DuplicateCacheStats AODVRouter::getDuplicateCacheStats() const
+{
+    Lock l(_mutex);
+    return _seenPackets.stats();
+}
+
+bool AODVRouter::isDuplicatePacket(const BaseHeader &bh)
+{
+    if (bh.originSeq == 0)
+        return isDuplicatePacketID(bh.packetID);
+
+    Lock l(_mutex);
+    return _originWindows.isDuplicate(bh.originNodeID, bh.originSeq, xTaskGetTickCount());
+}
+
+void AODVRouter::storePacket(const BaseHeader &bh)
+{
+    if (bh.originSeq == 0)
     {
-        return true;
+        storePacketID(bh.packetID);
+        return;
     }
-    return false;
+
+    Lock l(_mutex);
+    _originWindows.mark(bh.originNodeID, bh.originSeq, xTaskGetTickCount());
 }
 
-void AODVRouter::storePacketID(uint32_t packetID)
+uint16_t AODVRouter::nextOriginSeq()
+{
+    Lock l(_mutex);
+    if (++_originSeq == 0) // 0 marks an unsequenced packet
+        ++_originSeq;
+    return _originSeq;
+}
+
+SeqWindowStats AODVRouter::getSeqWindowStats() const
 {
     Lock l(_mutex);
-    receivedPacketIDs.insert(packetID);
+    return _originWindows.stats();
 }
 
 bool AODVRouter::isNodeIDKnown(uint32_t packetID)
@@ -2053,25 +3461,25 @@ void AODVRouter::saveNodeID(uint32_t packetID)
     discoveredNodes.insert(packetID);
 }
 
-void AODVRouter::storeAckPacket(uint32_t packetID, const uint8_t *packet, size_t length, uint32_t expectedNextHop)
+void AODVRouter::storeAckPacket(uint32_t packetID, RadioPacket *frame, uint32_t expectedNextHop)
 {
     Lock l(_mutex);
-    // Allocate memory for a copy of the packet.
-    uint8_t *packetCopy = (uint8_t *)pvPortMalloc(length);
-    if (packetCopy == nullptr)
+    auto it = ackBuffer.find(packetID);
+    if (it != ackBuffer.end())
     {
-        Serial.println("[AODVRouter] Memory allocation failed for ACK packet copy");
-        return;
+        _timers.cancel(it->second.timer);
+        FramePool::instance().release(it->second.frame);
     }
-    memcpy(packetCopy, packet, length);
 
-    // Store the packet copy in the ackBuffer along with its metadata.
+    // Store the frame in the ackBuffer along with its metadata.
+    TickType_t now = xTaskGetTickCount();
     ackBuffer[packetID] = {
-        packetCopy,
-        length,
+        frame,
         expectedNextHop,
-        xTaskGetTickCount(),
-        0};
+        now,
+        now,
+        0,
+        armTimer(RouterTimer::AckTimeout, packetID, now + ACK_TIMEOUT_TICKS)};
 }
 
 bool AODVRouter::findAckPacket(uint32_t packetID)
@@ -2085,9 +3493,75 @@ bool AODVRouter::findAckPacket(uint32_t packetID)
 }
 
 void AODVRouter::insertDataBuffer(uint32_t destNodeID, uint8_t *data, size_t len, uint32_t packetID)
+{
+    pushPending({PendingKind::Data, destNodeID, packetID, 0, 0, data, len, 0});
+}
+
+void AODVRouter::pushPending(const PendingMessage &msg)
+{
+    std::vector<PendingDropped> dropped;
+    {
+        Lock l(_mutex);
+        _pending.push(msg, xTaskGetTickCount(), dropped);
+        armPendingExpiry();
+    }
+    notifyDropped(dropped);
+}
+
+void AODVRouter::expirePendingMessages()
+{
+    std::vector<PendingDropped> dropped;
+    {
+        Lock l(_mutex);
+        _pending.expire(xTaskGetTickCount(), dropped);
+        armPendingExpiry();
+    }
+    if (!dropped.empty())
+        Serial.printf("[AODVRouter] Dropped %u buffered messages past their TTL\n", (unsigned)dropped.size());
+    notifyDropped(dropped);
+}
+
+void AODVRouter::armPendingExpiry()
+{
+    TickType_t at;
+    if (!_pending.nextExpiry(at))
+        return; // a stale timer finding nothing due is harmless
+    if (_pendingTimer != 0 && (int32_t)(at - _pendingTimerAt) >= 0)
+        return;
+    _timers.cancel(_pendingTimer);
+    _pendingTimer = armTimer(RouterTimer::PendingExpiry, 0, at);
+    _pendingTimerAt = at;
+}
+
+void AODVRouter::notifyDropped(const std::vector<PendingDropped> &dropped)
+{
+    static const char *const reasons[] = {"expired", "destination cap", "byte budget"};
+    for (const auto &d : dropped)
+    {
+        const PendingMessage &m = d.msg;
+        Serial.printf("[AODVRouter] Dropped buffered message %u for %u (%s)\n",
+                      m.packetID, m.key, reasons[(uint8_t)d.reason]);
+        switch (m.kind)
+        {
+        case PendingKind::Data:
+            _clientNotifier->notify(Outgoing{BleType::BLE_ACK_FAILURE, 0, 0, nullptr, 0, m.packetID});
+            break;
+        case PendingKind::UserMsg:
+        case PendingKind::UserRoute:
+            _clientNotifier->notify(Outgoing{BleType::BLE_ACK_FAILURE, m.fromUserID, 0, nullptr, 0, m.packetID});
+            break;
+        case PendingKind::MoveReq:
+            break; // the user stays registered here; nothing to report
+        }
+        if (m.data)
+            vPortFree(m.data);
+    }
+}
+
+PendingStoreStats AODVRouter::getPendingStats() const
 {
     Lock l(_mutex);
-    _dataBuffer[destNodeID].push_back({packetID, data, len});
+    return _pending.stats();
 }
 
 bool AODVRouter::ackBufferHasPacketID(uint32_t packetID)
@@ -2134,11 +3608,12 @@ void AODVRouter::removeFromACKBuffer(uint32_t packetID)
             return;
         }
         ent = it->second; // take a copy
+        _timers.cancel(ent.timer);
         ackBuffer.erase(it);
     } // ---- mutex released
 
     BaseHeader bh;
-    deserialiseBaseHeader(ent.packet, bh);
+    deserialiseBaseHeader(ent.frame->data, bh);
     if (bh.originNodeID == _myNodeID) // we started it
     {
         Serial.println("Received ack I am origin");
@@ -2146,7 +3621,7 @@ void AODVRouter::removeFromACKBuffer(uint32_t packetID)
         {
             Serial.println("Received ack user msg");
             UserMsgHeader uh;
-            deserialiseUserMsgHeader(ent.packet + sizeof(BaseHeader),
+            deserialiseUserMsgHeader(ent.frame->data + sizeof(BaseHeader),
                                      uh, 0);
             Serial.printf("Received ack user msg from ID: %u", uh.fromUserID);
 
@@ -2162,7 +3637,61 @@ void AODVRouter::removeFromACKBuffer(uint32_t packetID)
                 Outgoing{BleType::BLE_ACK, 0, 0, nullptr, 0, packetID});
         }
     }
-    vPortFree(ent.packet);
+    FramePool::instance().release(ent.frame);
+}
+
+bool AODVRouter::acceptBeforeDecrypt(const BaseHeader &bh, bool &backupOnly)
+{
+    backupOnly = false;
+    if (tryImplicitAck(bh.packetID))
+    {
+        Lock l(_mutex);
+        ++_rxStats.implicitAck;
+        return false;
+    }
+
+    if (isDuplicatePacket(bh))
+    {
+        Serial.println("[AODVRouter] Received packet which has already been processed");
+        Lock l(_mutex);
+        ++_rxStats.duplicate;
+        // a beacon we declined to relay, now from a neighbour that picked us
+        if (bh.packetType == PKT_BROADCAST_INFO && _neighbourhood.rescue(bh.prevHopID, bh.originNodeID, bh.packetID))
+            return true;
+        // a later copy of a flood (RREQ, beacon) from a neighbour we hear, that reached us
+        // another way than our route to its origin: decrypted only to learn a backup route,
+        // since the header alone is not authenticated
+        LinkQuality lq;
+        const RouteEntry *cur = _routeTable.find(bh.originNodeID);
+        backupOnly = bh.destNodeID == BROADCAST_ADDR && (bh.flags & FLAG_ENCRYPTED) &&
+                     cur != nullptr && cur->nextHop != bh.prevHopID && _links.find(bh.prevHopID, lq);
+        return backupOnly;
+    }
+
+    if (bh.prevHopID == _myNodeID)
+    {
+        Serial.println("[AODVRouter] Reveived packet with prevHopID == myNodeID. Not expected behaviour! Unless I sent a broadcast");
+        Lock l(_mutex);
+        ++_rxStats.ownEcho;
+        return false;
+    }
+
+    if (bh.destNodeID != BROADCAST_ADDR && bh.destNodeID != _myNodeID)
+    {
+        Serial.printf("[AODVRouter] Not a message for me bh.destnodeid: %u\n", bh.destNodeID);
+        // not recorded: the header is unauthenticated, and a forged copy must not mark the real frame as seen
+        Lock l(_mutex);
+        ++_rxStats.notForMe;
+        return false;
+    }
+
+    return true;
+}
+
+RxFilterStats AODVRouter::getRxFilterStats() const
+{
+    Lock l(_mutex);
+    return _rxStats;
 }
 
 bool AODVRouter::tryImplicitAck(uint32_t packetID)
@@ -2171,7 +3700,8 @@ bool AODVRouter::tryImplicitAck(uint32_t packetID)
     auto it = ackBuffer.find(packetID);
     if (it == ackBuffer.end())
         return false;
-    vPortFree(it->second.packet);
+    _timers.cancel(it->second.timer);
+    FramePool::instance().release(it->second.frame);
     ackBuffer.erase(it);
     Serial.printf("[AODVRouter] Implicit ACK for %u\n", packetID);
     return true;
@@ -16,20 +16,69 @@
 #include <userSessionManager.h>
 #include "IClientNotifier.h"
 #include "crypto/crypto.h"
+#include "duplicateCache.h"
+#include "seqWindow.h"
+#include "routeTable.h"
+#include "loraAirtime.h"
+#include "csmaBackoff.h"
+#include "pendingStore.h"
+#include "timerWheel.h"
+#include "trickleTimer.h"
+#include "floodControl.h"
+#include "neighbourhood.h"
+#include "linkEstimator.h"
 
 static constexpr size_t NONCE_LEN = 12;
 static constexpr size_t TAG_LEN = 8;
 
+/* Packet types relays pass on with the payload untouched. Their sealed
+   part (ciphertext + tag) is bound only to the immutable header fields,
+   so a relay rewrites destNodeID/prevHopID/hopCount and forwards the
+   ciphertext as received instead of decrypting and re-encrypting it.
+   Types a relay rebuilds (RREQ, RREP, RERR, ...) stay bound to the
+   whole header and the hop count, since a changed plaintext must never
+   reuse a nonce.                                                     */
+static inline bool hopInvariant(uint8_t packetType)
+{
+    switch (packetType)
+    {
+    case PKT_DATA:
+    case PKT_BROADCAST:
+    case PKT_BROADCAST_INFO:
+    case PKT_USER_MSG:
+    case PKT_PUBKEY_REQ:
+    case PKT_PUBKEY_RESP:
+    case PKT_MOVE_USER_REQ:
+        return true;
+    default:
+        return false;
+    }
+}
+
 /* 12-byte nonce layout:
-   [0..3] originNodeID  | [4..7] packetID | [8] hopCount | [9] pktType | [10..11] 0 */
+   [0..3] originNodeID  | [4..7] packetID | [8] hopCount (0 if hop-invariant) | [9] pktType | [10..11] originSeq */
 static inline void buildNonce(const BaseHeader &bh, uint8_t nonce[NONCE_LEN])
 {
     memcpy(nonce, &bh.originNodeID, 4);
     memcpy(nonce + 4, &bh.packetID, 4);
-    nonce[8] = bh.hopCount;
+    nonce[8] = hopInvariant(bh.packetType) ? 0 : bh.hopCount;
     nonce[9] = bh.packetType;
-    nonce[10] = 0;
-    nonce[11] = 0;
+    memcpy(nonce + 10, &bh.originSeq, 2);
+}
+
+/* Associated data for the AEAD: the whole serialised header, or for a
+   hop-invariant type only what no relay changes –
+   originNodeID | packetID | packetType | flags | originSeq (12 bytes). */
+static inline size_t buildAad(const BaseHeader &bh, uint8_t aad[sizeof(BaseHeader)])
+{
+    if (!hopInvariant(bh.packetType))
+        return serialiseBaseHeader(bh, aad);
+    memcpy(aad, &bh.originNodeID, 4);
+    memcpy(aad + 4, &bh.packetID, 4);
+    aad[8] = bh.packetType;
+    aad[9] = bh.flags;
+    memcpy(aad + 10, &bh.originSeq, 2);
+    return 12;
 }
 
 class GatewayManager;
@@ -37,18 +86,19 @@ class GatewayManager;
 #ifdef UNIT_TEST
 #include <gtest/gtest_prod.h>
 #endif
-struct RouteEntry
+/// RFC 1982 comparison of 32-bit sequence numbers: true if a is newer than b
+static inline bool seqNumNewer(uint32_t a, uint32_t b)
 {
-    uint32_t nextHop;
-    uint8_t hopcount;
-};
+    return (int32_t)(a - b) > 0;
+}
 
-struct dataBufferEntry
+/// the sequence number after seq, skipping 0 (unknown); 0 stays unknown
+static inline uint32_t seqNumNext(uint32_t seq)
 {
-    uint32_t packetID;
-    uint8_t *data;
-    size_t length;
-};
+    if (seq == 0)
+        return 0;
+    return seq + 1 == 0 ? 1 : seq + 1;
+}
 
 struct userMessageBufferEntry
 {
@@ -69,11 +119,12 @@ struct PendingUserRouteEntry
 
 struct ackBufferEntry
 {
-    uint8_t *packet; // store pointer to entire data
-    size_t length;
+    RadioPacket *frame;       // the frame as sent; FramePool reference held by the buffer
     uint32_t expectedNextHop; // the next hop node you expect to forward the packet
     TickType_t timestamp;     // time when the packet was sent
+    TickType_t firstSent;     // time of the first transmission, against the next hop's liveness
     uint8_t attempts;         // number of retransmissions
+    uint32_t timer;           // _timers handle of the retransmit deadline
 };
 
 // per‑user cache entry
@@ -93,10 +144,115 @@ struct NeighInfo
 };
 
 static const TickType_t ACK_TIMEOUT_TICKS = pdMS_TO_TICKS(3000);
-static const TickType_t ACK_CLEANUP_PERIOD_TICKS = pdMS_TO_TICKS(60000); // 1 minute
 static const uint8_t MAX_RETRANS = 3;
-static const uint32_t BROADCAST_NOTIFY_BIT = (1u << 0);
-static const uint32_t CLEANUP_NOTIFY_BIT = (1u << 1);
+static const TickType_t ACTIVE_ROUTE_TIMEOUT_TICKS = pdMS_TO_TICKS(900000); // 15 minutes, refreshed on use
+static const TickType_t BEACON_MAX_SILENCE_TICKS = ACTIVE_ROUTE_TIMEOUT_TICKS / 2; // Trickle may not suppress us longer
+static const TickType_t ROUTE_PURGE_PERIOD_TICKS = pdMS_TO_TICKS(60000);    // expired-route sweep
+static const TickType_t NEIGHBOUR_CHECK_PERIOD_TICKS = pdMS_TO_TICKS(15000); // neighbour liveness sweep
+static const uint8_t NEIGHBOUR_MISSED_BEACONS = 3;     // beacon periods (BEACON_MAX_SILENCE_TICKS) a neighbour may stay silent
+static const uint8_t NEIGHBOUR_SILENT_ACK_TIMEOUTS = 2; // ACK timeouts with the next hop silent before it counts as gone
+static const uint32_t TIMER_NOTIFY_BIT = (1u << 0);                          // an earlier deadline was armed
+
+/* Timers armed at once on the router's wheel: one per unacknowledged
+   frame and per discovery attempt, plus a few periodic ones. */
+#ifndef ROUTER_TIMER_CAPACITY
+#define ROUTER_TIMER_CAPACITY 128
+#endif
+
+// what a _timers entry stands for; the key is given per kind
+enum class RouterTimer : uint8_t
+{
+    AckTimeout,     ///< key: packetID in ackBuffer
+    Discovery,      ///< key: destination or user; re-checks every discovery
+    PendingExpiry,  ///< earliest expiry in _pending
+    Broadcast,      ///< next BROADCAST_INFO Trickle event
+    RoutePurge,     ///< periodic purgeExpiredRoutes
+    NeighbourCheck  ///< periodic checkNeighbours
+};
+
+// Expanding-ring route discovery (RFC 3561 §6.4). A destination we held a
+// route to is first searched for within its last hop count + TTL_INCREMENT,
+// widening by TTL_INCREMENT up to TTL_THRESHOLD. Anything else, and a ring
+// that found nothing, gets one network-wide RREQ; it is not retried, since on
+// LoRa a repeated flood costs more deliveries than it recovers; more messages
+// for the destination do not start another until the last one's ring traversal
+// time is up. An RREP can take minutes to come back through a busy mesh, so the
+// messages waiting on it are held for DISCOVERY_HOLD_TICKS before they are
+// failed back to the phone.
+static const uint8_t RREQ_TTL_INCREMENT = 2;
+static const uint8_t RREQ_TTL_THRESHOLD = 6;
+static const uint8_t NET_DIAMETER = 30;
+static const uint8_t RREQ_TIMEOUT_BUFFER = 2;                              // extra hops of slack per ring
+static const TickType_t DISCOVERY_HOLD_TICKS = pdMS_TO_TICKS(1800000);     // 30 minutes
+
+// One hop of an RREQ flood: wait out a neighbour's copy already on air, the
+// longest default CSMA back-off, then our own copy (~0.8 s at SF9/125 kHz).
+static const size_t RREQ_FRAME_LEN = sizeof(BaseHeader) + sizeof(RREQHeader) + TAG_LEN;
+static const TickType_t NODE_TRAVERSAL_TICKS =
+    pdMS_TO_TICKS(2 * loraAirtimeMs(RREQ_FRAME_LEN) + CsmaOptions().legacyMaxMs);
+
+// Local repair (RFC 3561 §6.12): a relay that loses its route to a destination
+// no more than LOCAL_REPAIR_MAX_TTL hops away searches for it itself, with one
+// RREQ ring of the last known distance + LOCAL_REPAIR_ADD_TTL, holding the
+// frames in transit. Only if that fails does a RERR go back to the origin.
+static const uint8_t LOCAL_REPAIR_ADD_TTL = 2;
+static const uint8_t LOCAL_REPAIR_MAX_TTL = NET_DIAMETER * 3 / 10;
+static const uint8_t LOCAL_REPAIR_MAX_FRAMES = 8; // held at once, all destinations; FramePool frames
+
+struct DestHistory
+{
+    uint32_t seqNum;  // freshest destination sequence number seen, 0 = unknown
+    uint8_t hopCount; // length of the last route we held, 0 = never had one
+};
+
+struct RouteDiscovery
+{
+    uint8_t ttl;         // hop limit of the last RREQ sent
+    TickType_t deadline; // tick at which the current attempt times out
+    uint32_t timer;      // _timers handle of the deadline
+    bool localRepair;    // a relay's repair of a broken route: one ring, never widened
+};
+
+struct DiscoveryStats
+{
+    uint32_t started;       ///< RREQ/UREQ discoveries begun
+    uint32_t coalesced;     ///< misses that joined a discovery already in flight
+    uint32_t retries;       ///< rings widened, and floods repeated for a miss after the last came back empty
+    uint32_t failed;        ///< discoveries abandoned, buffered messages failed
+    uint32_t repairs;       ///< local repairs begun by a relay at a broken route
+    uint32_t repairsFailed; ///< of those, ended with a RERR back to the origins
+};
+
+struct RouteBackupStats
+{
+    uint32_t learned;   ///< alternative next hops recorded (or refreshed)
+    uint32_t failovers; ///< broken routes that switched to an alternative
+    uint32_t lost;      ///< broken routes with no usable alternative, dropped
+};
+
+struct RouteErrorStats
+{
+    uint32_t sent;        ///< RERRs sent to precursors, one per frame
+    uint32_t listed;      ///< unreachable destinations listed in them
+    uint32_t unheard;     ///< breaks found here or reported to us with no precursor to tell
+    uint32_t received;    ///< RERRs heard from a neighbour's own break report
+    uint32_t invalidated; ///< routes dropped on those, for going through their sender
+};
+
+/// Why received frames were dropped; all but authFailed are decided on the clear header before any crypto
+struct RxFilterStats
+{
+    uint32_t received;      ///< frames handed to handlePacket
+    uint32_t malformed;     ///< shorter than a BaseHeader (+ tag when encrypted)
+    uint32_t implicitAck;   ///< our own frame forwarded by the next hop
+    uint32_t duplicate;     ///< already processed
+    uint32_t ownEcho;       ///< prevHopID is us
+    uint32_t notForMe;      ///< unicast addressed to another node
+    uint32_t authFailed;    ///< AES-GCM tag mismatch
+    uint32_t decrypted;     ///< frames that needed (and passed) decryption
+    uint32_t accepted;      ///< frames dispatched to a handler
+    uint32_t relayedSealed; ///< forwarded with the received ciphertext, no crypto
+};
 
 // add the required flags for hop limits
 static const uint8_t routeReplyThreshold = 2;
@@ -114,6 +270,9 @@ public:
      */
     AODVRouter(IRadioManager *RadioManager, MQTTManager *MQTTManager, uint32_t myNodeID, UserSessionManager *usm, IClientNotifier *icm);
 
+    /// hands the frames still waiting on an ACK back to the FramePool
+    ~AODVRouter();
+
     /**
      * @brief Initialise and create the router task
      *
@@ -155,6 +314,94 @@ public:
     bool hasPubKey(uint32_t userID) const;
     bool getPubKey(uint32_t userID, const std::array<uint8_t, 32> *&outPtr) const;
 
+    /**
+     * @brief Hit/miss/eviction counters of the seen-packet cache.
+     */
+    DuplicateCacheStats getDuplicateCacheStats() const;
+
+    /**
+     * @brief Counters of the per-origin sequence-number windows.
+     */
+    SeqWindowStats getSeqWindowStats() const;
+
+    /**
+     * @brief Route/user discovery counters (started, coalesced, retried, failed).
+     */
+    DiscoveryStats getDiscoveryStats() const;
+
+    /**
+     * @brief Occupancy and drop counters of the buffers waiting on a discovery.
+     */
+    PendingStoreStats getPendingStats() const;
+
+    /**
+     * @brief Per-reason counters of the RX drop filter in handlePacket.
+     */
+    RxFilterStats getRxFilterStats() const;
+
+    /**
+     * @brief A local user joined or left: announce it soon. Restarts the
+     * BROADCAST_INFO Trickle interval at Imin.
+     */
+    void userSessionsChanged();
+
+    /**
+     * @brief Trickle parameters for BROADCAST_INFO; call before begin().
+     */
+    void setTrickleConfig(const TrickleConfig &cfg);
+
+    /**
+     * @brief BROADCAST_INFO Trickle counters (sent, suppressed, resets).
+     */
+    TrickleStats getBeaconStats() const;
+
+    /**
+     * @brief Run every router timer that is due by now. timerWorkerTask
+     * calls this; host simulations call it at nextTimerDeadline().
+     */
+    void runTimers();
+
+    /**
+     * @brief The next tick runTimers() has work at; false if no timer is armed.
+     */
+    bool nextTimerDeadline(TickType_t &at) const;
+
+    /**
+     * @brief Counters of the router's timer wheel.
+     */
+    TimerWheelStats getTimerStats() const;
+
+    /**
+     * @brief Flood relay counters: relayed and stopped at their hop limit.
+     */
+    FloodStats getFloodStats() const;
+
+    /**
+     * @brief Multipoint relay counters and the current MPR / 2-hop set sizes.
+     */
+    NeighbourhoodStats getNeighbourhoodStats() const;
+
+    /**
+     * @brief Smoothed RSSI/SNR, ETX and liveness of the link from neighbour.
+     * @return false if neighbour is not in the neighbour table
+     */
+    bool getLinkQuality(uint32_t neighbour, LinkQuality &out) const;
+
+    /**
+     * @brief Neighbour table counters: frames measured, neighbours tracked and timed out.
+     */
+    LinkEstimatorStats getLinkStats() const;
+
+    /**
+     * @brief Alternative next hops learned, and how often a broken route fell back on one.
+     */
+    RouteBackupStats getRouteBackupStats() const;
+
+    /**
+     * @brief RERRs to precursors sent and heard, and the routes they cut.
+     */
+    RouteErrorStats getRouteErrorStats() const;
+
 private:
     std::unordered_map<uint32_t, std::array<uint8_t, 32>> _userKeys;
     /*
@@ -171,7 +418,7 @@ private:
     UserSessionManager *_usm;
 
     TaskHandle_t _routerTaskHandler;
-    TaskHandle_t _timerWorkerHandle;
+    TaskHandle_t _timerWorkerHandle = nullptr;
 
     MQTTManager *_mqttManager;
 
@@ -189,26 +436,87 @@ private:
     // Data structures
 
     // TODO: MUTEX!!!!! - multiple tasks access this and could modify it!!
-    // routeTable[dest] = RouteEntry
-    std::map<uint32_t, RouteEntry> _routeTable;
+    // dest -> RouteEntry, fixed capacity, indexed by next hop (see routeTable.h)
+    RouteTable<ROUTE_TABLE_CAPACITY> _routeTable;
+
+    // Data, user messages and move requests awaiting RREP/UREP, bounded and aged (see pendingStore.h)
+    PendingStore _pending;
+
+    // Recently seen message ids, bounded and aged (see duplicateCache.h)
+    DuplicateCache<DUP_CACHE_CAPACITY> _seenPackets;
+
+    // Per-origin sliding windows over BaseHeader.originSeq (see seqWindow.h)
+    SeqWindowTable<SEQ_WINDOW_MAX_ORIGINS> _originWindows;
+
+    // Last sequence number stamped on a packet we originated
+    uint16_t _originSeq;
+
+    // Our own AODV destination sequence number
+    uint32_t _ownSeqNum = 1;
+
+    // Last known sequence number and distance per destination, kept after the route itself is gone
+    std::unordered_map<uint32_t, DestHistory> _destHistory;
+
+    // Routes dropped for age or room under _mutex, not yet published (see flushDroppedRoutes)
+    std::vector<uint32_t> _droppedRoutes;
+
+    // Every router deadline – ACK retransmits, discovery timeouts, pending
+    // expiry, the periodic broadcast and route purge (see timerWheel.h)
+    TimerWheel<ROUTER_TIMER_CAPACITY> _timers;
+
+    // the single PendingExpiry timer and when it is due, 0 = none armed
+    uint32_t _pendingTimer = 0;
+    TickType_t _pendingTimerAt = 0;
+
+    FloodStats _floodStats{};
+
+    // BROADCAST_INFO schedule: our beacon backs off while neighbours keep
+    // saying the same thing and comes back fast when something changes
+    TrickleTimer _trickle;
+    uint32_t _beaconTimer = 0;      // _timers handle of the next Trickle event
+    TickType_t _lastBeaconAt = 0;   // when we last originated a BROADCAST_INFO
+    bool _lastBeaconGateway = false; // I_AM_GATEWAY as last announced
+    bool _beaconDirty = false;       // local users changed since the last beacon
+
+    // 2-hop neighbourhood from neighbours' beacons and the MPRs picked from
+    // it; BROADCAST_INFO is only relayed for neighbours that picked us
+    Neighbourhood _neighbourhood;
 
-    // Map for entries awaiting RREP
-    std::map<uint32_t, std::vector<dataBufferEntry>> _dataBuffer;
+    // per-neighbour RSSI/SNR averages and the ETX routes are priced with
+    LinkEstimator<LINK_ESTIMATOR_CAPACITY> _links;
 
-    // Map for entries await UREP
-    std::map<uint32_t, std::vector<userMessageBufferEntry>> _userMsgBuffer;
+    // Route discoveries in progress: destNodeID -> ring state. At most one
+    // per destination; misses while its RREQ is in flight only add to the
+    // buffers it will flush.
+    std::map<uint32_t, RouteDiscovery> _discoveries;
 
-    // Map for entries await RREP
-    std::map<uint32_t, std::vector<PendingUserRouteEntry>> _userRouteBuffer;
+    // User discoveries (UREQ) in progress: userID -> hold state
+    std::map<uint32_t, RouteDiscovery> _userDiscoveries;
 
-    // Set to store seen message ids
-    std::unordered_set<uint32_t> receivedPacketIDs;
+    DiscoveryStats _discoveryStats{};
 
-    // Handle periodic broadcasts timer
-    TimerHandle_t _broadcastTimer;
+    // Relayed frames held during a local repair: finalDest -> (packetID, frame)
+    std::multimap<uint32_t, std::pair<uint32_t, RadioPacket *>> _repairFrames;
 
-    // handle ackBuffer cleanup
-    TimerHandle_t _ackBufferCleanupTimer;
+    RxFilterStats _rxStats{};
+
+    RouteBackupStats _backupStats{};
+
+    RouteErrorStats _rerrStats{};
+
+    /* The hop-invariant frame handlePacket is dispatching, still sealed as
+       received, and its plaintext, so forwardPacket can relay the frame
+       itself without re-encrypting. Only touched on the RX path. */
+    struct SealedFrame
+    {
+        bool valid;
+        uint32_t originNodeID;
+        uint32_t packetID;
+        uint8_t flags;      // wire flags, FLAG_ENCRYPTED included
+        RadioPacket *frame; // borrowed from handlePacket's caller
+        const uint8_t *plain;
+        size_t plainLen;
+    } _rxSealed{};
 
     // nodes on the network
     std::unordered_set<uint32_t> discoveredNodes;
@@ -225,8 +533,6 @@ private:
     // Gateways
     std::unordered_set<uint32_t> _gateways;
 
-    std::map<uint32_t, std::vector<MoveUserReqHeader>> _moveReqBuffer;
-
     // Timers
 
     // Functions:
@@ -238,27 +544,72 @@ private:
      */
     static void routerTask(void *pvParameters);
 
+    /**
+     * @brief Sleeps until the next _timers deadline (or until an earlier one
+     * is armed) and runs whatever is due.
+     */
     static void timerWorkerTask(void *pvParameters);
 
+    void sendBroadcastInfo();
+
+    /// Trickle event: decide whether this interval's BROADCAST_INFO goes out
+    void onBeaconTimer();
+
+    /// local state changed: bring the next BROADCAST_INFO forward to within Imin
+    void resetBeacon();
+
+    /// recompute our MPRs over the current 1-hop neighbours (into oneHop); true if the set changed
+    bool selectMprs(std::vector<uint32_t> &oneHop);
+
+    /// arm a router timer and wake the worker if it is now the earliest; returns the _timers handle
+    uint32_t armTimer(RouterTimer kind, uint32_t key, TickType_t at);
+
+    /// retransmit the frame behind packetID, or give up on it after MAX_RETRANS
+    void onAckTimeout(uint32_t packetID);
+
+    /// RERR and BLE_ACK_FAILURE for a frame nobody acknowledged; releases its frame
+    void ackRetriesExhausted(uint32_t packetID, const ackBufferEntry &ent);
+
+    /// time out neighbours silent for NEIGHBOUR_MISSED_BEACONS beacon periods
+    void checkNeighbours();
+
     /**
-     * @brief Timer callback to send broadcast info
-     *
-     * @param xTimer
+     * @brief neighbour is gone: drop every route through it at once and send
+     *        the frames still waiting on its ACK another way.
      */
-    static void broadcastTimerCallback(TimerHandle_t xTimer);
+    void neighbourLost(uint32_t neighbour);
 
-    void sendBroadcastInfo();
+    /**
+     * @brief Send an unacknowledged frame along a route that avoids its old next hop.
+     * Our own traffic goes back through sendData/sendUserMessage, which
+     * find another route or queue it behind a discovery. A relayed frame is
+     * readdressed as it is: its next hop is outside the AAD. A route still
+     * through the old next hop first fails over to a backup. Falls back to
+     * ackRetriesExhausted when no other route is left. Releases or hands on
+     * the frame.
+     */
+    void rerouteFrame(uint32_t packetID, const ackBufferEntry &ent);
 
-    void cleanupAckBuffer();
+    /// header and plaintext of a frame we sealed; false if it does not authenticate
+    bool openFrame(const RadioPacket *frame, BaseHeader &bh, uint8_t *plain, size_t &plainLen);
 
-    static void ackCleanupCallback(TimerHandle_t xTimer);
+    /// keep the PendingExpiry timer on the earliest expiry in _pending; caller holds _mutex
+    void armPendingExpiry();
+
+    /**
+     * @brief Advance every route discovery whose attempt timed out: widen the
+     * ring, go network-wide, or give up and fail the messages waiting on the
+     * route back to the phone.
+     */
+    void checkRouteDiscoveries();
 
     // TOP LEVEL RX PACKET HANDLERS
 
     /**
      * @brief Top level packet handler
      *
-     * @param rxPacket
+     * @param rxPacket decrypted in place; the caller keeps its reference and
+     *        the router retains the frame itself if it relays it
      */
     void handlePacket(RadioPacket *rxPacket);
 
@@ -337,20 +688,78 @@ private:
     // SEND PACKET HELPER FUNCTIONS
 
     /**
-     * @brief
+     * @brief Start route discovery for destNodeID. A no-op while its last
+     * RREQ is still in flight – ring widening is driven by checkRouteDiscoveries()
      *
      * @param destNodeID
      */
     void sendRREQ(uint32_t destNodeID);
 
+    /// build and send one RREQ for destNodeID limited to ttl hops
+    void transmitRREQ(uint32_t destNodeID, uint8_t ttl);
+
+    /// out and back across a ring of ttl hops, plus slack
+    static TickType_t ringTraversalTicks(uint8_t ttl);
+
+    /// how long to wait for an RREP to an attempt with this ring state
+    static TickType_t discoveryTimeout(const RouteDiscovery &d);
+
+    /// (re)start the deadline of discovery d for key on the wheel; caller holds _mutex
+    void armDiscovery(RouteDiscovery &d, uint32_t key, TickType_t now);
+
+    /// forget the discovery for key and disarm its deadline; caller holds _mutex
+    void endDiscovery(std::map<uint32_t, RouteDiscovery> &discoveries, uint32_t key);
+
+    /// true while the last RREQ/UREQ of d has not had time to come back
+    static bool discoveryInFlight(const RouteDiscovery &d, TickType_t now);
+
+    /// widen the ring after a timeout; false once the network-wide attempt is over
+    static bool advanceDiscovery(RouteDiscovery &d);
+
+    /// build and send one UREQ for userID
+    void transmitUREQ(uint32_t userID);
+
+    /// send the messages buffered for userID now that its node is known
+    void flushUserMessageBuffer(uint32_t userID);
+
+    /// user discovery for userID abandoned: drop its buffer, report BLE_ACK_FAILURE
+    void failUserDiscovery(uint32_t userID);
+
+    /// discovery for destNodeID abandoned: drop its buffers, report BLE_ACK_FAILURE
+    void failRouteDiscovery(uint32_t destNodeID);
+
+    /**
+     * @brief A relayed frame for finalDest has no route on: hold it and run a
+     *        local repair, or join the discovery already looking for finalDest.
+     * The frame (and our reference) is kept, readdressed and sent once a route
+     * turns up. False, with the frame still the caller's, if finalDest is too
+     * far or its distance unknown, or too many frames are held already.
+     */
+    bool repairRoute(uint32_t finalDest, uint32_t packetID, RadioPacket *frame);
+
+    /// repairRoute with the sealed frame being relayed, its header rewritten to fwd
+    bool holdForRepair(const BaseHeader &fwd, uint32_t finalDest);
+
+    /// remove and return the frames held for destNodeID
+    std::vector<std::pair<uint32_t, RadioPacket *>> takeRepairFrames(uint32_t destNodeID);
+
+    /// send the frames held for destNodeID along the route just found
+    void flushRepairFrames(uint32_t destNodeID);
+
+    /// no route to destNodeID after all: RERR to the origin of every frame held for it
+    void failRepair(uint32_t destNodeID);
+
     /**
      * @brief
      *
      * @param destNodeID
      * @param nextHop
      * @param hopCount
+     * @param metric ETX from us to destNodeID, 0 if we are it
      */
-    void sendRREP(uint32_t originNodeID, uint32_t destNodeID, uint32_t nextHop, uint8_t hopCount);
+    void sendRREP(uint32_t originNodeID, uint32_t destNodeID, uint32_t nextHop, uint8_t hopCount,
+                  uint32_t destSeqNum, uint16_t lifetimeS = ACTIVE_ROUTE_TIMEOUT_TICKS / pdMS_TO_TICKS(1000),
+                  uint16_t metric = 0);
 
     /**
      * @brief
@@ -362,6 +771,19 @@ private:
      */
     void sendRERR(uint32_t brokenNodeID, uint32_t originNodeID, uint32_t originalDest, uint32_t originalPacketID);
 
+    /**
+     * @brief Tell the precursors of a break which destinations it cut off
+     *        (RFC 3561 §6.11): one RERR listing every (dest, seq), unicast
+     *        to a lone precursor and broadcast to several, split over
+     *        frames only if the list does not fit one.
+     */
+    void sendPrecursorRERR(uint32_t brokenNodeID, const std::vector<std::pair<uint32_t, uint32_t>> &unreachable,
+                           const std::vector<uint32_t> &precursors);
+
+    /// a neighbour's own break report: drop the listed routes through it and pass the news on to our precursors
+    void handlePrecursorRERR(const BaseHeader &base, const RERRHeader &rerr, const uint8_t *payload, size_t payloadLen);
+
+    /// start user discovery for userID; a no-op while its last UREQ is in flight
     void sendUREQ(uint32_t userID);
 
     void sendUREP(uint32_t originNodeID, uint32_t destNodeID, uint32_t userID, uint32_t nextHop, uint16_t lifetime, uint8_t hopCount);
@@ -384,12 +806,117 @@ private:
     void transmitPacket(const BaseHeader &header, const uint8_t *extHeader, size_t extLen,
                         const uint8_t *payload = nullptr, size_t payloadLen = 0);
 
+    /**
+     * @brief Relay the frame being handled. For a hop-invariant type the
+     * received ciphertext and tag go out untouched under the rewritten
+     * per-hop header; anything else is re-encrypted by transmitPacket.
+     * extHeader || payload must be the plaintext as received.
+     */
+    void forwardPacket(const BaseHeader &fwd, const uint8_t *extHeader, size_t extLen,
+                       const uint8_t *payload = nullptr, size_t payloadLen = 0);
+
+    /**
+     * @brief Rebroadcast a flood (RREQ, UREQ, PUBKEY_REQ, broadcast DATA)
+     * unless it has reached its type's hop limit, see floodControl.h.
+     */
+    void relayFlood(const BaseHeader &fwd, const uint8_t *extHeader, size_t extLen,
+                    const uint8_t *payload = nullptr, size_t payloadLen = 0);
+
+    /// publish the clear frame to MQTT when the gateway is connected
+    void publishClear(const BaseHeader &header, const uint8_t *extHeader, size_t extLen,
+                      const uint8_t *payload, size_t payloadLen);
+
+    /// hand a finished FramePool frame (and our reference) to the radio, keeping it for retransmission if it wants an ACK
+    void sendFrame(const BaseHeader &hdrOut, RadioPacket *frame);
+
     //  ROUTING TABLE HELPER FUNCTIONS
-    void updateRoute(uint32_t destination, uint32_t nextHop, uint8_t hopCount);
+    /// metric: ETX of the path; 0 prices it as the link to nextHop plus clean hops beyond
+    void updateRoute(uint32_t destination, uint32_t nextHop, uint8_t hopCount,
+                     uint32_t destSeqNum = 0, TickType_t lifetime = ACTIVE_ROUTE_TIMEOUT_TICKS,
+                     uint16_t metric = 0);
+
+    /// ETX of one transmission to neighbour, ETX_UNIT if it was never measured
+    uint16_t linkCost(uint32_t neighbour);
+
+    /// path ETX of hopCount hops through nextHop: its link, then clean hops
+    uint16_t estimateMetric(uint32_t nextHop, uint8_t hopCount);
+
+    /**
+     * @brief Keep another way to destination, through a next hop other than
+     *        its route's, as a backup. Ignored if older than the route, or
+     *        more than one hop longer: a neighbour no further from
+     *        destination than we are does not route through us (AOMDV's
+     *        advertised hop count). Caller holds _mutex.
+     */
+    void learnBackup(uint32_t destination, uint32_t nextHop, uint8_t hopCount, uint32_t destSeqNum,
+                     TickType_t lifetime, uint16_t metric = 0);
+
+    /// a backup may take over: unexpired, its next hop still heard from, not older than what we know
+    bool backupUsable(uint32_t destination, const RouteEntry &re, TickType_t now);
+
+    /**
+     * @brief The route to destination goes through avoid (or avoid2): move it
+     *        onto its best usable backup through neither.
+     * @return false if it does not, or there is no such backup; the route
+     *         is then left as it was
+     */
+    bool failoverRoute(uint32_t destination, uint32_t avoid, uint32_t avoid2 = 0);
     bool hasRoute(uint32_t destination);
     bool getRoute(uint32_t destination, RouteEntry &RouteEntry);
     void invalidateRoute(uint32_t brokenNodeID, uint32_t finalDestNodeID, uint32_t senderNodeID);
 
+    /**
+     * @brief Extend the lifetime of an active route because traffic is using it.
+     */
+    void touchRoute(uint32_t destination);
+
+    /// neighbour sends traffic for destination through us: it hears of the route breaking
+    void addPrecursor(uint32_t destination, uint32_t neighbour);
+
+    /// add the precursors of destination's route to out, once each, but not except; caller holds _mutex
+    void collectPrecursors(uint32_t destination, uint32_t except, std::vector<uint32_t> &out) const;
+
+    /**
+     * @brief A frame from this neighbour shows it is still in range: keep every route through it alive.
+     */
+    void refreshRoutesVia(uint32_t nextHop);
+
+    /**
+     * @brief Background sweep: drop every route whose lifetime has run out.
+     */
+    void purgeExpiredRoutes();
+
+    /**
+     * @brief Queue a message behind a discovery; whatever the bounds push out is reported and freed.
+     */
+    void pushPending(const PendingMessage &msg);
+
+    /**
+     * @brief Background sweep: give up on buffered messages older than PENDING_TTL_MS.
+     */
+    void expirePendingMessages();
+
+    /// BLE_ACK_FAILURE for every dropped message that came from a client, then free its payload
+    void notifyDropped(const std::vector<PendingDropped> &dropped);
+
+    /// freshest sequence number we know for destination (survives route removal), 0 = unknown
+    uint32_t knownSeqNum(uint32_t destination) const;
+
+    /// remember seq for destination if it is newer than what we hold
+    void recordSeqNum(uint32_t destination, uint32_t seq);
+
+    /// make room in a full route table (caller holds _mutex)
+    void evictRoute(TickType_t now);
+
+    /// drop the route to destination for age or room (caller holds _mutex); flushDroppedRoutes tells the rest
+    void dropRoute(uint32_t destination);
+
+    /// publish the routes dropped since the last call to MQTT and recompute the closest gateway; call without _mutex held
+    void flushDroppedRoutes();
+
+    /// seconds left on a route, as carried in RREPHeader.lifetime
+    uint16_t remainingLifetimeS(const RouteEntry &re) const;
+
     // DATA QUEUE HELPER FUNCTIONS
     void flushDataQueue(uint32_t destNodeID);
 
@@ -401,13 +928,21 @@ private:
 
     void storePacketID(uint32_t packetID);
 
+    // Sequenced packets go through the origin window, unsequenced ones through the packetID cache
+    bool isDuplicatePacket(const BaseHeader &bh);
+
+    void storePacket(const BaseHeader &bh);
+
+    uint16_t nextOriginSeq();
+
     // known nodes
     bool isNodeIDKnown(uint32_t packetID);
 
     void saveNodeID(uint32_t packetID);
 
     // ACK BUFFER HELPER FUNCTIONS
-    void storeAckPacket(uint32_t packetID, const uint8_t *packet, size_t length, uint32_t expectedNextHop);
+    // takes over one FramePool reference on frame
+    void storeAckPacket(uint32_t packetID, RadioPacket *frame, uint32_t expectedNextHop);
 
     bool findAckPacket(uint32_t packetID);
 
@@ -419,6 +954,14 @@ private:
 
     bool tryImplicitAck(uint32_t packetID);
 
+    /**
+     * @brief Drop what the clear BaseHeader already rules out (implicit ACKs,
+     * duplicates, own echoes, unicasts for other nodes) before paying for decryption.
+     * @param backupOnly set for a duplicate worth authenticating only to learn a backup route from
+     * @return true if the frame should be decrypted (and, unless backupOnly, dispatched)
+     */
+    bool acceptBeforeDecrypt(const BaseHeader &bh, bool &backupOnly);
+
     void removeItemRoutingTable(uint32_t ID);
 
     void flushUserRouteBuffer(uint32_t nodeID);
@@ -443,28 +986,27 @@ private:
 
     inline void addUserMessage(uint32_t userID, const userMessageBufferEntry &entry)
     {
-        Lock lock(_mutex);
-        _userMsgBuffer[userID].push_back(entry);
+        pushPending({PendingKind::UserMsg, userID, entry.packetID, entry.senderID, userID,
+                     entry.message, entry.length, 0});
     }
 
     inline bool hasBufferedUserMessages(uint32_t userID) const
     {
         Lock lock(_mutex);
-        auto it = _userMsgBuffer.find(userID);
-        return (it != _userMsgBuffer.end() && !it->second.empty());
+        return _pending.count(PendingKind::UserMsg, userID) != 0;
     }
 
     inline std::vector<userMessageBufferEntry> popBufferedUserMessages(uint32_t userID)
     {
-        Lock lock(_mutex);
-        auto it = _userMsgBuffer.find(userID);
-        if (it == _userMsgBuffer.end())
+        std::vector<PendingMessage> taken;
         {
-            return {};
+            Lock lock(_mutex);
+            taken = _pending.take(PendingKind::UserMsg, userID);
         }
-        // move out the vector to avoid copy
-        std::vector<userMessageBufferEntry> msgs = std::move(it->second);
-        _userMsgBuffer.erase(it);
+        std::vector<userMessageBufferEntry> msgs;
+        msgs.reserve(taken.size());
+        for (auto &m : taken)
+            msgs.push_back({m.packetID, m.fromUserID, m.data, m.length});
         return msgs;
     }
 
@@ -473,6 +1015,9 @@ private:
         Lock lock(_mutex);
         _gut[userID] = entry;
         Serial.printf("Added user: %u", userID);
+        // a UREQ waiting on this user can end now rather than at its deadline
+        if (_userDiscoveries.count(userID))
+            armTimer(RouterTimer::Discovery, userID, xTaskGetTickCount());
     }
 
     inline bool getGutEntry(uint32_t userID, GutEntry &out) const
@@ -501,48 +1046,51 @@ private:
 
     inline void addPendingUserRouteMessage(uint32_t nodeID, const PendingUserRouteEntry &entry)
     {
-        Lock lock(_mutex);
-        _userRouteBuffer[nodeID].push_back(entry);
+        pushPending({PendingKind::UserRoute, nodeID, entry.packetID, entry.senderID, entry.destUserID,
+                     entry.message, entry.length, 0});
     }
 
     inline bool hasPendingUserRouteMessages(uint32_t nodeID) const
     {
         Lock lock(_mutex);
-        auto it = _userRouteBuffer.find(nodeID);
-        return it != _userRouteBuffer.end() && !it->second.empty();
+        return _pending.count(PendingKind::UserRoute, nodeID) != 0;
     }
 
     inline std::vector<PendingUserRouteEntry> popPendingUserRouteMessages(uint32_t nodeID)
     {
-        Lock lock(_mutex);
-        auto it = _userRouteBuffer.find(nodeID);
-        if (it == _userRouteBuffer.end())
+        std::vector<PendingMessage> taken;
         {
-            return {};
+            Lock lock(_mutex);
+            taken = _pending.take(PendingKind::UserRoute, nodeID);
         }
-        auto msgs = std::move(it->second);
-        _userRouteBuffer.erase(it);
+        std::vector<PendingUserRouteEntry> msgs;
+        msgs.reserve(taken.size());
+        for (auto &m : taken)
+            msgs.push_back({m.packetID, m.fromUserID, m.toUserID, m.data, m.length});
         return msgs;
     }
 
     inline void addMoveReq(uint32_t nodeID,
                            const MoveUserReqHeader &h)
     {
-        Lock lock(_mutex);
-        _moveReqBuffer[nodeID].push_back(h);
+        pushPending({PendingKind::MoveReq, nodeID, 0, h.userID, h.destNodeID, nullptr, 0, 0});
     }
     inline std::vector<MoveUserReqHeader> popMoveReq(uint32_t nodeID)
     {
-        Lock lock(_mutex);
-        auto it = _moveReqBuffer.find(nodeID);
-        if (it == _moveReqBuffer.end())
-            return {};
-        auto v = std::move(it->second);
-        _moveReqBuffer.erase(it);
+        std::vector<PendingMessage> taken;
+        {
+            Lock lock(_mutex);
+            taken = _pending.take(PendingKind::MoveReq, nodeID);
+        }
+        std::vector<MoveUserReqHeader> v;
+        v.reserve(taken.size());
+        for (auto &m : taken)
+            v.push_back({m.fromUserID, m.toUserID});
         return v;
     }
 
 #ifdef UNIT_TEST
+    friend class MeshSimulator; // host-side simulator drives the RX path and timers directly
     FRIEND_TEST(AODVRouterTest, BasicSendDataTest);
     FRIEND_TEST(AODVRouterTest, BasicReceiveRREP);
     FRIEND_TEST(AODVRouterTest, ForwardRREP);
@@ -563,6 +1111,28 @@ private:
     FRIEND_TEST(AODVRouterTest, ReceiveBroadcastInfo);
     FRIEND_TEST(AODVRouterTest, ReceiveBroadcastInfoExceedMaxHops);
     FRIEND_TEST(AODVRouterTest, ImplicitACKBufferTest);
+    FRIEND_TEST(AODVRouterTest, DuplicateCacheAgesOutAndEvicts);
+    FRIEND_TEST(AODVRouterTest, OriginSequenceWindow);
+    FRIEND_TEST(AODVRouterTest, RouteLifetimeExpiry);
+    FRIEND_TEST(AODVRouterTest, FresherSequenceNumberWins);
+    FRIEND_TEST(AODVRouterTest, RouteTableNextHopIndex);
+    FRIEND_TEST(AODVRouterTest, ExpandingRingDiscovery);
+    FRIEND_TEST(AODVRouterTest, CoalesceDiscoveries);
+    FRIEND_TEST(AODVRouterTest, PendingStoreBoundsAndExpiry);
+    FRIEND_TEST(AODVRouterTest, DropBeforeDecrypt);
+    FRIEND_TEST(AODVRouterTest, SoftAesRoundTrip);
+    FRIEND_TEST(AODVRouterTest, SoftAesBackupOnlyFromGenuineCopies);
+    FRIEND_TEST(AODVRouterTest, RelayForwardsCiphertextUntouched);
+    FRIEND_TEST(AODVRouterTest, ForwardSharesOneFrame);
+    FRIEND_TEST(AODVRouterTest, AckTimeoutsRunOffTheTimerWheel);
+    FRIEND_TEST(AODVRouterTest, TrickleBroadcastInfo);
+    FRIEND_TEST(AODVRouterTest, FloodHopLimitPerType);
+    FRIEND_TEST(AODVRouterTest, MprRelaySelection);
+    FRIEND_TEST(AODVRouterTest, EtxRouteSelection);
+    FRIEND_TEST(AODVRouterTest, NeighbourTimeoutReroutes);
+    FRIEND_TEST(AODVRouterTest, BackupRouteFailover);
+    FRIEND_TEST(AODVRouterTest, LocalRepairBeforeRERR);
+    FRIEND_TEST(AODVRouterTest, PrecursorRERR);
 #endif
 };
 
@@ -369,7 +369,8 @@ void BluetoothManager::processIncomingMessage(uint16_t connHandle, const std::st
 
         // This is legacy -- shouldn't be used by the phone maintained for old versions
         Serial.printf("Received user_ID_UPDATE for %u with connHandle %u\n", sender, connHandle);
-        _userMgr->addOrRefresh(sender, connHandle);
+        if (_userMgr->addOrRefresh(sender, connHandle) && _netHandler)
+            _netHandler->userSessionsChanged();
 
         if (_gatewayOnline)
         {
@@ -533,7 +534,8 @@ void BluetoothManager::processIncomingMessage(uint16_t connHandle, const std::st
         _netHandler->announcePubKey(sender, reinterpret_cast<const uint8_t *>(body.data()));
         /* store local copy too: */
         // _netHandler->cacheMyKey(sender, reinterpret_cast<const uint8_t *>(body.data()));
-        _userMgr->addOrRefresh(sender, connHandle);
+        if (_userMgr->addOrRefresh(sender, connHandle) && _netHandler)
+            _netHandler->userSessionsChanged();
 
         // if (_gatewayOnline)
         // {
@@ -1,76 +1,138 @@
 #include "crypto.h"
+#include <FreeRTOS.h>
+#include <semphr.h>
 
-#ifdef UNIT_TEST
-/*  Tiny-AES-GCM (public domain) – only the bits we need
-    so the unit tests build without ESP32 libraries.                 */
-// #include "aes_gcm.h"
+/*  Backend: CRYPTO_SOFT_AES selects the portable softAesGcm (host sim
+    and bench builds); otherwise unit tests get a memcpy stub with a zero
+    tag so they can read frames straight off the mock radio, and the
+    firmware uses mbedTLS.                                             */
+#if defined(CRYPTO_SOFT_AES)
+#include "softAesGcm.h"
+#elif defined(UNIT_TEST)
 #include <string.h>
 #else
 #include "mbedtls/gcm.h"
 #endif
 
+#ifdef UNIT_TEST
+#include <chrono>
+static uint64_t nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#else
+#include "esp_timer.h"
+static uint64_t nowUs() { return esp_timer_get_time(); }
+#endif
+
 // Probably shouldn't be on github -- change completely and store locally
 const uint8_t NWK_KEY[16] =
     {
         0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
         0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF};
 
-static bool gcm(bool encrypt,
-                const uint8_t *nonce, size_t nonce_len,
-                const uint8_t *aad, size_t aad_len,
-                const uint8_t *input, size_t len,
-                uint8_t *output,
-                const uint8_t *tag_in, uint8_t *tag_out, size_t tag_len)
+/*  The GCM context with the expanded key schedule, shared by the router
+    task (decrypt) and every transmitPacket caller (encrypt). A GCM
+    context carries per-operation state, so each use holds _mtx.      */
+class GcmContext
 {
-#ifdef UNIT_TEST
-    (void)encrypt;
-    (void)nonce;
-    (void)nonce_len;
-    (void)aad;
-    (void)aad_len;
-    (void)input;
-    (void)len;
-    (void)output;
-    (void)tag_in;
-    (void)tag_out;
-    (void)tag_len;
-    /* just do a dumb mem-copy for tests */
-    if (encrypt)
-        memcpy(output, input, len);
-    else
-        memcpy(output, input, len);
-    if (tag_out)
-        memset(tag_out, 0, tag_len);
-    return true;
+public:
+    GcmContext() : _mtx(xSemaphoreCreateMutex())
+    {
+#if !defined(CRYPTO_SOFT_AES) && !defined(UNIT_TEST)
+        mbedtls_gcm_init(&_ctx);
+#endif
+    }
+
+    void lock() { xSemaphoreTake(_mtx, portMAX_DELAY); }
+    void unlock() { xSemaphoreGive(_mtx); }
+
+    /// caller holds the lock
+    bool setKey(const uint8_t key[16])
+    {
+#if defined(CRYPTO_SOFT_AES)
+        _keyed = _ctx.setKey(key, 128);
+#elif defined(UNIT_TEST)
+        (void)key;
+        _keyed = true;
 #else
-    mbedtls_gcm_context ctx;
-    mbedtls_gcm_init(&ctx);
-    int rc = mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES,
-                                NWK_KEY, 128);
-    if (rc != 0)
+        _keyed = mbedtls_gcm_setkey(&_ctx, MBEDTLS_CIPHER_ID_AES, key, 128) == 0;
+#endif
+        return _keyed;
+    }
+
+    GcmStats stats{}; // guarded by the lock
+
+    /// caller holds the lock
+    bool crypt(bool encrypt, GcmFrame &f)
     {
-        mbedtls_gcm_free(&ctx);
-        return false;
+        if (!_keyed && !setKey(NWK_KEY))
+            return false;
+#if defined(CRYPTO_SOFT_AES)
+        if (encrypt)
+            return _ctx.encrypt(f.nonce, f.nonce_len, f.aad, f.aad_len, f.in, f.len, f.out, f.tag, f.tag_len);
+        return _ctx.decrypt(f.nonce, f.nonce_len, f.aad, f.aad_len, f.in, f.len, f.tag, f.tag_len, f.out);
+#elif defined(UNIT_TEST)
+        /* just do a dumb mem-copy for tests */
+        memmove(f.out, f.in, f.len); // in and out may be the same buffer
+        if (encrypt)
+            memset(f.tag, 0, f.tag_len);
+        return true;
+#else
+        int rc;
+        if (encrypt)
+            rc = mbedtls_gcm_crypt_and_tag(&_ctx, MBEDTLS_GCM_ENCRYPT,
+                                           f.len,
+                                           f.nonce, f.nonce_len,
+                                           f.aad, f.aad_len,
+                                           f.in, f.out,
+                                           f.tag_len, f.tag);
+        else
+            rc = mbedtls_gcm_auth_decrypt(&_ctx,
+                                          f.len,
+                                          f.nonce, f.nonce_len,
+                                          f.aad, f.aad_len,
+                                          f.tag, f.tag_len,
+                                          f.in, f.out);
+        return rc == 0;
+#endif
     }
 
-    if (encrypt)
-        rc = mbedtls_gcm_crypt_and_tag(&ctx, MBEDTLS_GCM_ENCRYPT,
-                                       len,
-                                       nonce, nonce_len,
-                                       aad, aad_len,
-                                       input, output,
-                                       tag_len, tag_out);
-    else
-        rc = mbedtls_gcm_auth_decrypt(&ctx,
-                                      len,
-                                      nonce, nonce_len,
-                                      aad, aad_len,
-                                      tag_in, tag_len,
-                                      input, output);
-
-    mbedtls_gcm_free(&ctx);
-    return rc == 0;
+private:
+    SemaphoreHandle_t _mtx;
+    bool _keyed = false;
+#if defined(CRYPTO_SOFT_AES)
+    SoftAesGcm _ctx;
+#elif !defined(UNIT_TEST)
+    mbedtls_gcm_context _ctx;
 #endif
+};
+
+static GcmContext gcmContext;
+
+static size_t gcmBatch(bool encrypt, GcmFrame *frames, size_t n)
+{
+    size_t ok = 0;
+    gcmContext.lock();
+    GcmStats &st = gcmContext.stats;
+    uint64_t start = nowUs();
+    for (size_t i = 0; i < n; ++i)
+    {
+        frames[i].ok = gcmContext.crypt(encrypt, frames[i]);
+        ok += frames[i].ok;
+        st.bytes += frames[i].len;
+        if (encrypt)
+            st.encrypted += frames[i].ok;
+        else if (frames[i].ok)
+            ++st.decrypted;
+        else
+            ++st.authFailed;
+    }
+    st.busyUs += nowUs() - start;
+    gcmContext.unlock();
+    return ok;
 }
 
 bool aes_gcm_encrypt(const uint8_t *nonce, size_t nonce_len,
@@ -78,8 +140,8 @@ bool aes_gcm_encrypt(const uint8_t *nonce, size_t nonce_len,
                      const uint8_t *plain, size_t len,
                      uint8_t *cipher, uint8_t *tag, size_t tag_len)
 {
-    return gcm(true, nonce, nonce_len, aad, aad_len,
-               plain, len, cipher, nullptr, tag, tag_len);
+    GcmFrame f{nonce, nonce_len, aad, aad_len, plain, len, cipher, tag, tag_len, false};
+    return gcmBatch(true, &f, 1) == 1;
 }
 
 bool aes_gcm_decrypt(const uint8_t *nonce, size_t nonce_len,
@@ -88,6 +150,43 @@ bool aes_gcm_decrypt(const uint8_t *nonce, size_t nonce_len,
                      const uint8_t *tag, size_t tag_len,
                      uint8_t *plain)
 {
-    return gcm(false, nonce, nonce_len, aad, aad_len,
-               cipher, len, plain, tag, nullptr, tag_len);
+    GcmFrame f{nonce, nonce_len, aad, aad_len, cipher, len, plain, const_cast<uint8_t *>(tag), tag_len, false};
+    return gcmBatch(false, &f, 1) == 1;
+}
+
+size_t aes_gcm_encrypt_batch(GcmFrame *frames, size_t n)
+{
+    return gcmBatch(true, frames, n);
+}
+
+size_t aes_gcm_decrypt_batch(GcmFrame *frames, size_t n)
+{
+    return gcmBatch(false, frames, n);
+}
+
+bool aes_gcm_set_key(const uint8_t key[16])
+{
+    gcmContext.lock();
+    bool ok = gcmContext.setKey(key);
+    gcmContext.unlock();
+    return ok;
+}
+
+GcmStats aes_gcm_stats(void)
+{
+    gcmContext.lock();
+    GcmStats st = gcmContext.stats;
+    gcmContext.unlock();
+    return st;
+}
+
+const char *aes_gcm_backend(void)
+{
+#if defined(CRYPTO_SOFT_AES)
+    return "soft";
+#elif defined(UNIT_TEST)
+    return "stub";
+#else
+    return "mbedtls";
+#endif
 }
@@ -20,3 +20,43 @@ bool aes_gcm_decrypt(const uint8_t *nonce, size_t nonce_len,
                      const uint8_t *cipher, size_t len,
                      const uint8_t *tag,    size_t tag_len,
                      uint8_t *plain);
+
+/*  One frame of a batch call. `tag` is written on encrypt and checked
+    on decrypt; `ok` reports the outcome for this frame.              */
+struct GcmFrame
+{
+    const uint8_t *nonce;
+    size_t nonce_len;
+    const uint8_t *aad;
+    size_t aad_len;
+    const uint8_t *in;
+    size_t len;
+    uint8_t *out;
+    uint8_t *tag;
+    size_t tag_len;
+    bool ok;
+};
+
+/*  Process n frames under one lock of the shared context.
+    Returns how many succeeded.                                       */
+size_t aes_gcm_encrypt_batch(GcmFrame *frames, size_t n);
+size_t aes_gcm_decrypt_batch(GcmFrame *frames, size_t n);
+
+/*  The key schedule is expanded once (from NWK_KEY, on first use) and
+    kept; call this to replace the key at run time.                   */
+bool aes_gcm_set_key(const uint8_t key[16]);
+
+/*  Work done through this interface since boot.                     */
+struct GcmStats
+{
+    uint32_t encrypted;  // frames sealed
+    uint32_t decrypted;  // frames opened and verified
+    uint32_t authFailed; // frames whose tag did not verify
+    uint64_t bytes;      // payload bytes through either direction
+    uint64_t busyUs;     // wall time spent inside the cipher
+};
+
+GcmStats aes_gcm_stats(void);
+
+/*  Name of the compiled-in implementation, for logs and benchmarks.  */
+const char *aes_gcm_backend(void);
@@ -0,0 +1,319 @@
+#include "softAesGcm.h"
+#include <string.h>
+
+namespace
+{
+
+constexpr uint8_t SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16};
+
+constexpr uint8_t xtime(uint8_t x)
+{
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+/* Te[0][x] = (2s, s, s, 3s) for s = SBOX[x], big-endian column; Te[1..3] are its byte rotations */
+struct TTables
+{
+    uint32_t te[4][256];
+};
+
+constexpr TTables makeTables()
+{
+    TTables t{};
+    for (int i = 0; i < 256; ++i)
+    {
+        uint32_t s = SBOX[i];
+        uint32_t s2 = xtime((uint8_t)s);
+        uint32_t s3 = s2 ^ s;
+        uint32_t w = (s2 << 24) | (s << 16) | (s << 8) | s3;
+        for (int r = 0; r < 4; ++r)
+        {
+            t.te[r][i] = w;
+            w = (w >> 8) | (w << 24);
+        }
+    }
+    return t;
+}
+
+constexpr TTables T = makeTables();
+
+/* reduction of the 4 bits shifted out of GHASH's Z, in the high 16 bits of zh */
+constexpr uint16_t LAST4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0};
+
+inline uint32_t load32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+inline void store32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+inline uint64_t load64(const uint8_t *p)
+{
+    return ((uint64_t)load32(p) << 32) | load32(p + 4);
+}
+
+inline void store64(uint8_t *p, uint64_t v)
+{
+    store32(p, (uint32_t)(v >> 32));
+    store32(p + 4, (uint32_t)v);
+}
+
+inline uint32_t subWord(uint32_t w)
+{
+    return ((uint32_t)SBOX[w >> 24] << 24) | ((uint32_t)SBOX[(w >> 16) & 0xff] << 16) |
+           ((uint32_t)SBOX[(w >> 8) & 0xff] << 8) | SBOX[w & 0xff];
+}
+
+} // namespace
+
+bool SoftAesGcm::setKey(const uint8_t *key, size_t keyBits)
+{
+    if (keyBits != 128 && keyBits != 192 && keyBits != 256)
+        return false;
+
+    const size_t nk = keyBits / 32;
+    _rounds = (uint8_t)(nk + 6);
+    const size_t words = 4 * (_rounds + 1);
+    for (size_t i = 0; i < nk; ++i)
+        _rk[i] = load32(key + 4 * i);
+
+    uint8_t rcon = 1;
+    for (size_t i = nk; i < words; ++i)
+    {
+        uint32_t t = _rk[i - 1];
+        if (i % nk == 0)
+        {
+            t = subWord((t << 8) | (t >> 24)) ^ ((uint32_t)rcon << 24);
+            rcon = xtime(rcon);
+        }
+        else if (nk > 6 && i % nk == 4)
+        {
+            t = subWord(t);
+        }
+        _rk[i] = _rk[i - nk] ^ t;
+    }
+
+    /* GHASH table: H = E_K(0); _hl/_hh[i] = i·H for the 4-bit multiplier i */
+    uint8_t h[16] = {0};
+    encryptBlock(h, h);
+    uint64_t vh = load64(h);
+    uint64_t vl = load64(h + 8);
+    _hl[8] = vl;
+    _hh[8] = vh;
+    _hl[0] = 0;
+    _hh[0] = 0;
+    for (int i = 4; i > 0; i >>= 1)
+    {
+        uint32_t carry = (uint32_t)(vl & 1) * 0xe1000000u;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ ((uint64_t)carry << 32);
+        _hl[i] = vl;
+        _hh[i] = vh;
+    }
+    for (int i = 2; i <= 8; i *= 2)
+    {
+        for (int j = 1; j < i; ++j)
+        {
+            _hh[i + j] = _hh[i] ^ _hh[j];
+            _hl[i + j] = _hl[i] ^ _hl[j];
+        }
+    }
+    return true;
+}
+
+void SoftAesGcm::encryptBlock(const uint8_t in[16], uint8_t out[16]) const
+{
+    const uint32_t *rk = _rk;
+    uint32_t s0 = load32(in) ^ rk[0];
+    uint32_t s1 = load32(in + 4) ^ rk[1];
+    uint32_t s2 = load32(in + 8) ^ rk[2];
+    uint32_t s3 = load32(in + 12) ^ rk[3];
+
+    for (uint8_t r = 1; r < _rounds; ++r)
+    {
+        rk += 4;
+        uint32_t t0 = T.te[0][s0 >> 24] ^ T.te[1][(s1 >> 16) & 0xff] ^ T.te[2][(s2 >> 8) & 0xff] ^ T.te[3][s3 & 0xff] ^ rk[0];
+        uint32_t t1 = T.te[0][s1 >> 24] ^ T.te[1][(s2 >> 16) & 0xff] ^ T.te[2][(s3 >> 8) & 0xff] ^ T.te[3][s0 & 0xff] ^ rk[1];
+        uint32_t t2 = T.te[0][s2 >> 24] ^ T.te[1][(s3 >> 16) & 0xff] ^ T.te[2][(s0 >> 8) & 0xff] ^ T.te[3][s1 & 0xff] ^ rk[2];
+        uint32_t t3 = T.te[0][s3 >> 24] ^ T.te[1][(s0 >> 16) & 0xff] ^ T.te[2][(s1 >> 8) & 0xff] ^ T.te[3][s2 & 0xff] ^ rk[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    // last round: SubBytes + ShiftRows, no MixColumns
+    rk += 4;
+    auto last = [](uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+    {
+        return ((uint32_t)SBOX[a >> 24] << 24) | ((uint32_t)SBOX[(b >> 16) & 0xff] << 16) |
+               ((uint32_t)SBOX[(c >> 8) & 0xff] << 8) | SBOX[d & 0xff];
+    };
+    store32(out, last(s0, s1, s2, s3) ^ rk[0]);
+    store32(out + 4, last(s1, s2, s3, s0) ^ rk[1]);
+    store32(out + 8, last(s2, s3, s0, s1) ^ rk[2]);
+    store32(out + 12, last(s3, s0, s1, s2) ^ rk[3]);
+}
+
+void SoftAesGcm::ghashMult(uint8_t x[16]) const
+{
+    uint8_t lo = x[15] & 0xf;
+    uint64_t zh = _hh[lo];
+    uint64_t zl = _hl[lo];
+
+    for (int i = 15; i >= 0; --i)
+    {
+        lo = x[i] & 0xf;
+        uint8_t hi = (x[i] >> 4) & 0xf;
+
+        if (i != 15)
+        {
+            uint8_t rem = (uint8_t)(zl & 0xf);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ ((uint64_t)LAST4[rem] << 48);
+            zh ^= _hh[lo];
+            zl ^= _hl[lo];
+        }
+
+        uint8_t rem = (uint8_t)(zl & 0xf);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ ((uint64_t)LAST4[rem] << 48);
+        zh ^= _hh[hi];
+        zl ^= _hl[hi];
+    }
+
+    store64(x, zh);
+    store64(x + 8, zl);
+}
+
+void SoftAesGcm::ghashUpdate(uint8_t y[16], const uint8_t *data, size_t len) const
+{
+    while (len > 0)
+    {
+        size_t n = len < 16 ? len : 16;
+        for (size_t i = 0; i < n; ++i)
+            y[i] ^= data[i];
+        ghashMult(y);
+        data += n;
+        len -= n;
+    }
+}
+
+void SoftAesGcm::preCounter(const uint8_t *nonce, size_t nonce_len, uint8_t j0[16]) const
+{
+    if (nonce_len == 12)
+    {
+        memcpy(j0, nonce, 12);
+        store32(j0 + 12, 1);
+        return;
+    }
+    memset(j0, 0, 16);
+    ghashUpdate(j0, nonce, nonce_len);
+    uint8_t lens[16] = {0};
+    store64(lens + 8, (uint64_t)nonce_len * 8);
+    ghashUpdate(j0, lens, 16);
+}
+
+void SoftAesGcm::ctr(const uint8_t j0[16], const uint8_t *in, size_t len, uint8_t *out) const
+{
+    uint8_t counter[16];
+    uint8_t ks[16];
+    memcpy(counter, j0, 16);
+    uint32_t c = load32(j0 + 12);
+    while (len > 0)
+    {
+        store32(counter + 12, ++c); // inc32
+        encryptBlock(counter, ks);
+        size_t n = len < 16 ? len : 16;
+        for (size_t i = 0; i < n; ++i)
+            out[i] = in[i] ^ ks[i];
+        in += n;
+        out += n;
+        len -= n;
+    }
+}
+
+void SoftAesGcm::computeTag(const uint8_t j0[16], const uint8_t *aad, size_t aad_len,
+                            const uint8_t *cipher, size_t len, uint8_t full[16]) const
+{
+    uint8_t s[16] = {0};
+    ghashUpdate(s, aad, aad_len);
+    ghashUpdate(s, cipher, len);
+    uint8_t lens[16];
+    store64(lens, (uint64_t)aad_len * 8);
+    store64(lens + 8, (uint64_t)len * 8);
+    ghashUpdate(s, lens, 16);
+
+    encryptBlock(j0, full);
+    for (int i = 0; i < 16; ++i)
+        full[i] ^= s[i];
+}
+
+bool SoftAesGcm::encrypt(const uint8_t *nonce, size_t nonce_len,
+                         const uint8_t *aad, size_t aad_len,
+                         const uint8_t *plain, size_t len,
+                         uint8_t *cipher, uint8_t *tag, size_t tag_len) const
+{
+    if (_rounds == 0 || nonce_len == 0 || tag_len < 4 || tag_len > 16)
+        return false;
+
+    uint8_t j0[16];
+    preCounter(nonce, nonce_len, j0);
+    ctr(j0, plain, len, cipher);
+
+    uint8_t full[16];
+    computeTag(j0, aad, aad_len, cipher, len, full);
+    memcpy(tag, full, tag_len);
+    return true;
+}
+
+bool SoftAesGcm::decrypt(const uint8_t *nonce, size_t nonce_len,
+                         const uint8_t *aad, size_t aad_len,
+                         const uint8_t *cipher, size_t len,
+                         const uint8_t *tag, size_t tag_len,
+                         uint8_t *plain) const
+{
+    if (_rounds == 0 || nonce_len == 0 || tag_len < 4 || tag_len > 16)
+        return false;
+
+    uint8_t j0[16];
+    preCounter(nonce, nonce_len, j0);
+
+    uint8_t full[16];
+    computeTag(j0, aad, aad_len, cipher, len, full);
+    uint8_t diff = 0;
+    for (size_t i = 0; i < tag_len; ++i)
+        diff |= full[i] ^ tag[i]; // no early exit: do not leak how many bytes matched
+    if (diff != 0)
+    {
+        memset(plain, 0, len);
+        return false;
+    }
+
+    ctr(j0, cipher, len, plain);
+    return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*  Portable AES-GCM (NIST SP 800-38D) in plain C++, no platform code.
+    Built for the host (env:sim, env:bench) so encryption costs and
+    round-trips are real off-target; define CRYPTO_SOFT_AES to make it
+    the crypto.h backend on any build. AES uses 32-bit T-tables, GHASH
+    Shoup's 4-bit tables – the same trade-offs as mbedTLS' C fallback.
+    Not constant-time against cache-timing attacks.                    */
+class SoftAesGcm
+{
+public:
+    /*  keyBits: 128, 192 or 256. Expands the round keys and the GHASH
+        table once; everything after that is per-packet work only.      */
+    bool setKey(const uint8_t *key, size_t keyBits);
+
+    /*  tag_len 4..16; nonce of any non-zero length (12 is the fast path). */
+    bool encrypt(const uint8_t *nonce, size_t nonce_len,
+                 const uint8_t *aad, size_t aad_len,
+                 const uint8_t *plain, size_t len,
+                 uint8_t *cipher, uint8_t *tag, size_t tag_len) const;
+
+    /*  Returns false and zeroes plain if the tag does not verify.     */
+    bool decrypt(const uint8_t *nonce, size_t nonce_len,
+                 const uint8_t *aad, size_t aad_len,
+                 const uint8_t *cipher, size_t len,
+                 const uint8_t *tag, size_t tag_len,
+                 uint8_t *plain) const;
+
+private:
+    void encryptBlock(const uint8_t in[16], uint8_t out[16]) const;
+    void ghashMult(uint8_t x[16]) const;
+    void ghashUpdate(uint8_t y[16], const uint8_t *data, size_t len) const;
+    void preCounter(const uint8_t *nonce, size_t nonce_len, uint8_t j0[16]) const;
+    void ctr(const uint8_t j0[16], const uint8_t *in, size_t len, uint8_t *out) const;
+    void computeTag(const uint8_t j0[16], const uint8_t *aad, size_t aad_len,
+                    const uint8_t *cipher, size_t len, uint8_t full[16]) const;
+
+    uint32_t _rk[60]; // round keys, 4 * (rounds + 1) words
+    uint8_t _rounds = 0;
+    uint64_t _hl[16]; // GHASH: multiples of H, low halves
+    uint64_t _hh[16]; //                        high halves
+};
@@ -0,0 +1,104 @@
+#ifndef CSMA_BACKOFF_H
+#define CSMA_BACKOFF_H
+
+#include <algorithm>
+#include <Arduino.h>
+#include <FreeRTOS.h>
+
+/**
+ * @brief Listen-before-talk tuning used by RadioManager::txTask.
+ *
+ * Kept outside RadioManager so the host simulator can drive the very same
+ * back-off code against a virtual radio.
+ */
+struct CsmaOptions
+{
+    enum class BackoffScheme
+    {
+        Legacy,
+        Binary,
+        BE
+    };
+
+    BackoffScheme scheme = BackoffScheme::Legacy; // choose at run-time
+    bool pcsmaEnabled = false;                    ///< coin-flip gating
+    float pTransmit = 1.00f;                      ///< 0…1   (only if pcsmaEnabled)
+
+    /* --- LEGACY  (uniform 5–50 ms, unchanged) ------------------- */
+    uint32_t legacyMinMs = 5;
+    uint32_t legacyMaxMs = 50;
+
+    /* --- BINARY  (doubling window) ------------------------------ */
+    uint32_t binInitMs = 10;
+    uint32_t binMaxMs = 2000;
+
+    /* --- BE  (BEB/802.15.4-style) ------------------------------- */
+    uint32_t beUnitMs = 10; ///< length of one “slot”
+    uint8_t beMaxExp = 5;   ///< clamp exponent
+
+    /* --- PCSMA defer slot --------------------------------------- */
+    uint32_t deferSlotMs = 300;
+
+    uint16_t ifsMs      = 100;
+};
+
+/**
+ * @brief Back-off state for one frame waiting to go on air.
+ *
+ * Create one per frame; every busy CCA calls busyWait(), which widens the
+ * window for the Binary and BE schemes.
+ */
+class CsmaBackoff
+{
+public:
+    explicit CsmaBackoff(const CsmaOptions &opts)
+        : _opts(opts), _backoffBin(pdMS_TO_TICKS(opts.binInitMs)), _beExp(2)
+    {
+    }
+
+    /// channel was busy: how long to wait before the next CCA
+    TickType_t busyWait()
+    {
+        TickType_t waitTicks = 0;
+
+        switch (_opts.scheme)
+        {
+        case CsmaOptions::BackoffScheme::Binary:
+        {
+            uint32_t rnd = esp_random() % (_backoffBin / portTICK_PERIOD_MS + 1);
+            waitTicks = pdMS_TO_TICKS(rnd);
+            _backoffBin = std::min(_backoffBin * 2, pdMS_TO_TICKS(_opts.binMaxMs));
+            break;
+        }
+        case CsmaOptions::BackoffScheme::BE:
+        {
+            if (_beExp > _opts.beMaxExp)
+                _beExp = _opts.beMaxExp;
+            uint32_t slot = esp_random() % (1u << _beExp);
+            waitTicks = pdMS_TO_TICKS(slot * _opts.beUnitMs);
+            ++_beExp;
+            break;
+        }
+        default: /* legacy uniform 5–50 ms */
+            waitTicks = pdMS_TO_TICKS(_opts.legacyMinMs + esp_random() % (_opts.legacyMaxMs - _opts.legacyMinMs + 1));
+        }
+
+        return waitTicks;
+    }
+
+    /// channel looks idle: true if the PCSMA coin-flip says defer one slot
+    bool deferTransmit() const
+    {
+        if (!_opts.pcsmaEnabled)
+            return false;
+        float r = esp_random() / static_cast<float>(UINT32_MAX);
+        return r > _opts.pTransmit;
+    }
+
+private:
+    const CsmaOptions &_opts;
+    TickType_t _backoffBin;
+    uint8_t _beExp;
+};
+
+#endif // CSMA_BACKOFF_H
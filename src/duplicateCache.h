@@ -0,0 +1,182 @@
+#ifndef DUPLICATE_CACHE_H
+#define DUPLICATE_CACHE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <FreeRTOS.h>
+
+/* Memory ceiling for the seen-packet cache, fixed at build time:
+   ~ DUP_CACHE_CAPACITY * (8 + 4) bytes. Override with -D in platformio.ini. */
+#ifndef DUP_CACHE_CAPACITY
+#define DUP_CACHE_CAPACITY 256
+#endif
+
+/* How long a packet ID counts as "seen". Must outlast the slowest flood. */
+#ifndef DUP_CACHE_WINDOW_MS
+#define DUP_CACHE_WINDOW_MS 120000
+#endif
+
+struct DuplicateCacheStats
+{
+    uint32_t hits;      ///< lookups that found a live entry (duplicates dropped)
+    uint32_t misses;    ///< lookups that found nothing or an aged-out entry
+    uint32_t evictions; ///< live entries overwritten because the ring was full
+    uint32_t expired;   ///< entries found older than the window on lookup
+    uint16_t size;      ///< entries currently held
+};
+
+/**
+ * @brief Fixed-capacity, time-aged set of recently seen packet IDs.
+ *
+ * Entries live in a ring buffer in arrival order; an open-addressing hash
+ * (linear probing, twice the ring size) maps an ID to its ring slot. When
+ * the ring is full the oldest entry is overwritten, and an entry older
+ * than the window no longer counts as a duplicate. Nothing is allocated
+ * after construction. Not thread-safe – AODVRouter guards it with _mutex.
+ */
+template <uint16_t CAPACITY>
+class DuplicateCache
+{
+    static_assert(CAPACITY > 0 && CAPACITY < 0x4000, "ring index must fit the uint16_t table");
+
+public:
+    explicit DuplicateCache(TickType_t window = pdMS_TO_TICKS(DUP_CACHE_WINDOW_MS))
+        : _window(window)
+    {
+        clear();
+    }
+
+    void setWindow(TickType_t window) { _window = window; }
+    TickType_t window() const { return _window; }
+
+    /// true if id was stored within the window before now
+    bool contains(uint32_t id, TickType_t now)
+    {
+        uint16_t pos;
+        uint16_t slot = find(id, pos);
+        if (slot == EMPTY)
+        {
+            ++_stats.misses;
+            return false;
+        }
+        if ((TickType_t)(now - _ring[slot].ts) > _window)
+        {
+            ++_stats.expired;
+            ++_stats.misses;
+            release(slot, pos);
+            return false;
+        }
+        ++_stats.hits;
+        return true;
+    }
+
+    /// remember id as seen at now; refreshes the timestamp of a known id
+    void insert(uint32_t id, TickType_t now)
+    {
+        uint16_t pos;
+        uint16_t slot = find(id, pos);
+        if (slot != EMPTY)
+        {
+            _ring[slot].ts = now;
+            return;
+        }
+
+        Entry &victim = _ring[_head];
+        if (victim.used)
+        {
+            uint16_t victimPos;
+            find(victim.id, victimPos);
+            release(_head, victimPos);
+            ++_stats.evictions;
+            find(id, pos); // the shift may have opened an earlier free index
+        }
+
+        _ring[_head] = {id, now, true};
+        _table[pos] = _head;
+        ++_stats.size;
+        _head = (uint16_t)((_head + 1) % CAPACITY);
+    }
+
+    void clear()
+    {
+        memset(_ring, 0, sizeof(_ring));
+        for (uint16_t i = 0; i < TABLE_SIZE; ++i)
+            _table[i] = EMPTY;
+        _head = 0;
+        _stats = {};
+    }
+
+    const DuplicateCacheStats &stats() const { return _stats; }
+
+private:
+    static constexpr uint16_t EMPTY = 0xFFFF;
+
+    static constexpr uint16_t tableSize()
+    {
+        uint16_t n = 1;
+        while (n < 2 * CAPACITY)
+            n <<= 1;
+        return n;
+    }
+    static constexpr uint16_t TABLE_SIZE = tableSize();
+
+    struct Entry
+    {
+        uint32_t id;
+        TickType_t ts;
+        bool used;
+    };
+
+    static uint16_t home(uint32_t id)
+    {
+        // Fibonacci hashing: packet IDs are random, but spread them anyway
+        return (uint16_t)((id * 2654435769u) >> 16) & (TABLE_SIZE - 1);
+    }
+
+    /* Returns the ring slot holding id, or EMPTY. pos is the table index of
+       the match, or the free table index where id would be inserted.      */
+    uint16_t find(uint32_t id, uint16_t &pos) const
+    {
+        pos = home(id);
+        while (_table[pos] != EMPTY)
+        {
+            if (_ring[_table[pos]].id == id)
+                return _table[pos];
+            pos = (pos + 1) & (TABLE_SIZE - 1);
+        }
+        return EMPTY;
+    }
+
+    /* Drop ring slot `slot` (found at table index `pos`) and close the gap
+       with backward-shift deletion so later probes still find their keys. */
+    void release(uint16_t slot, uint16_t pos)
+    {
+        _ring[slot].used = false;
+        --_stats.size;
+
+        uint16_t gap = pos;
+        uint16_t next = (gap + 1) & (TABLE_SIZE - 1);
+        while (_table[next] != EMPTY)
+        {
+            uint16_t want = home(_ring[_table[next]].id);
+            // move next into the gap unless its home lies cyclically in (gap, next]
+            bool stays = (gap <= next) ? (gap < want && want <= next)
+                                       : (gap < want || want <= next);
+            if (!stays)
+            {
+                _table[gap] = _table[next];
+                gap = next;
+            }
+            next = (next + 1) & (TABLE_SIZE - 1);
+        }
+        _table[gap] = EMPTY;
+    }
+
+    Entry _ring[CAPACITY];
+    uint16_t _table[TABLE_SIZE];
+    uint16_t _head;
+    TickType_t _window;
+    DuplicateCacheStats _stats;
+};
+
+#endif // DUPLICATE_CACHE_H
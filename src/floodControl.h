@@ -0,0 +1,49 @@
+#ifndef FLOOD_CONTROL_H
+#define FLOOD_CONTROL_H
+
+#include <stdint.h>
+#include "packet.h"
+
+/* Hops a flood may travel, per packet type. RREQs are limited further
+   by their own expanding-ring ttl.                                    */
+#ifndef FLOOD_HOPS_RREQ
+#define FLOOD_HOPS_RREQ 30
+#endif
+
+#ifndef FLOOD_HOPS_UREQ
+#define FLOOD_HOPS_UREQ 10
+#endif
+
+#ifndef FLOOD_HOPS_PUBKEY_REQ
+#define FLOOD_HOPS_PUBKEY_REQ 5
+#endif
+
+#ifndef FLOOD_HOPS_DATA
+#define FLOOD_HOPS_DATA 10
+#endif
+
+struct FloodStats
+{
+    uint32_t relayed;    ///< floods rebroadcast
+    uint32_t hopLimited; ///< floods not relayed for reaching their type's hop limit
+};
+
+/// how far a flood of packetType may travel
+inline uint8_t floodHopLimit(uint8_t packetType)
+{
+    switch (packetType)
+    {
+    case PKT_RREQ:
+        return FLOOD_HOPS_RREQ;
+    case PKT_UREQ:
+        return FLOOD_HOPS_UREQ;
+    case PKT_PUBKEY_REQ:
+        return FLOOD_HOPS_PUBKEY_REQ;
+    case PKT_DATA:
+        return FLOOD_HOPS_DATA;
+    default:
+        return 0xFF;
+    }
+}
+
+#endif // FLOOD_CONTROL_H
@@ -0,0 +1,213 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <FreeRTOS.h>
+
+struct RadioPacket
+{
+    uint8_t data[255];
+    size_t len;
+    int16_t rssi = 0; ///< dBm the frame was received at; 0 if it was not read off the air
+    int8_t snr = 0;   ///< dB, alongside rssi
+};
+
+/* Frames in flight at once across the RX queue, the router, the TX queue
+   and the ACK buffer: ~264 bytes each, all reserved at build time.
+   Override with -D in platformio.ini.                                    */
+#ifndef FRAME_POOL_FRAMES
+#define FRAME_POOL_FRAMES 32
+#endif
+
+struct FramePoolStats
+{
+    uint32_t allocs;    ///< frames handed out by alloc()
+    uint32_t frees;     ///< frames returned to the pool (last reference released)
+    uint32_t retains;   ///< extra references taken on a frame
+    uint32_t copies;    ///< share() had to copy a frame the pool does not own
+    uint32_t exhausted; ///< alloc() found the pool empty
+    uint16_t inUse;     ///< frames out of the pool now
+    uint16_t peak;      ///< high-water mark of inUse
+};
+
+/**
+ * @brief Fixed pool of reference-counted RadioPackets shared by the radio,
+ *        the router and the ACK buffer.
+ *
+ * A frame read off the air is handed from the RX queue to the router, and
+ * from there to the TX queue and the ACK buffer, as a pointer: every holder
+ * takes a reference with retain() and gives it back with release(), and the
+ * frame returns to the pool when the last one is gone. Frames are built in
+ * place – BaseHeader first, then the sealed body, then the tag – so the
+ * header and tag need no buffer of their own. Nothing is allocated after
+ * construction.
+ *
+ * RadioPackets that do not come from the pool (a stack frame in a test, say)
+ * can still be passed to share(), which copies them into a pool frame; the
+ * copies counter shows whether that ever happens on a real device.
+ *
+ * The free list is a lock-free stack (Treiber) whose head packs a frame
+ * index with a 16-bit change counter, so a pop cannot be fooled by the
+ * same frame being freed and reallocated underneath it (ABA). alloc(),
+ * retain() and release() are O(1), take no lock and never block, and are
+ * safe from tasks on either core and from an ISR.
+ */
+class FramePool
+{
+public:
+    /// the pool every component of this node draws from
+    static FramePool &instance()
+    {
+        static FramePool pool;
+        return pool;
+    }
+
+    /// a frame with one reference, len 0 and no link metadata, or nullptr if all are in use
+    RadioPacket *alloc()
+    {
+        uint32_t head = _head.load(std::memory_order_acquire);
+        uint16_t i;
+        do
+        {
+            i = (uint16_t)head;
+            if (i == NIL)
+            {
+                _exhausted.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            // a stale _next[i] is harmless: the tag makes the exchange fail
+        } while (!_head.compare_exchange_weak(head, pack(_next[i].load(std::memory_order_relaxed), head),
+                                              std::memory_order_acquire, std::memory_order_acquire));
+
+        _allocs.fetch_add(1, std::memory_order_relaxed);
+        uint16_t inUse = _inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint16_t peak = _peak.load(std::memory_order_relaxed);
+        while (inUse > peak && !_peak.compare_exchange_weak(peak, inUse, std::memory_order_relaxed))
+        {
+        }
+
+        _refs[i].store(1, std::memory_order_relaxed);
+        _frames[i].len = 0;
+        _frames[i].rssi = 0;
+        _frames[i].snr = 0;
+        return &_frames[i];
+    }
+
+    /// take one more reference on a pool frame
+    void retain(RadioPacket *p)
+    {
+        _refs[index(p)].fetch_add(1, std::memory_order_relaxed);
+        _retains.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// drop one reference; the frame goes back to the pool with the last
+    void release(RadioPacket *p)
+    {
+        if (p == nullptr)
+            return;
+        uint16_t i = index(p);
+        if (_refs[i].fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+
+        _frees.fetch_add(1, std::memory_order_relaxed);
+        _inUse.fetch_sub(1, std::memory_order_relaxed);
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        do
+        {
+            _next[i].store((uint16_t)head, std::memory_order_relaxed);
+        } while (!_head.compare_exchange_weak(head, pack(i, head),
+                                              std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /// p with one more reference if the pool owns it, else a pool copy of it (nullptr if exhausted)
+    RadioPacket *share(RadioPacket *p)
+    {
+        if (owns(p))
+        {
+            retain(p);
+            return p;
+        }
+        RadioPacket *copy = alloc();
+        if (copy == nullptr)
+            return nullptr;
+        memcpy(copy->data, p->data, p->len);
+        copy->len = p->len;
+        _copies.fetch_add(1, std::memory_order_relaxed);
+        return copy;
+    }
+
+    bool owns(const RadioPacket *p) const
+    {
+        return p >= &_frames[0] && p < &_frames[FRAME_POOL_FRAMES];
+    }
+
+    /// slot number of a pool frame, 0 .. capacity() - 1
+    uint16_t index(const RadioPacket *p) const
+    {
+        configASSERT(owns(p));
+        return (uint16_t)(p - _frames);
+    }
+
+    /// references currently held on a pool frame
+    uint8_t refs(const RadioPacket *p) const { return _refs[index(p)].load(std::memory_order_relaxed); }
+
+    /// snapshot of the counters; fields are read one by one, so only roughly consistent under load
+    FramePoolStats stats() const
+    {
+        FramePoolStats s;
+        s.allocs = _allocs.load(std::memory_order_relaxed);
+        s.frees = _frees.load(std::memory_order_relaxed);
+        s.retains = _retains.load(std::memory_order_relaxed);
+        s.copies = _copies.load(std::memory_order_relaxed);
+        s.exhausted = _exhausted.load(std::memory_order_relaxed);
+        s.inUse = _inUse.load(std::memory_order_relaxed);
+        s.peak = _peak.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    static constexpr size_t capacity() { return FRAME_POOL_FRAMES; }
+
+private:
+    static_assert(FRAME_POOL_FRAMES > 0 && FRAME_POOL_FRAMES < 0xFFFF, "frame index must fit uint16_t");
+#if __cplusplus >= 201703L
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "free list needs a native 32-bit CAS");
+#endif
+    static constexpr uint16_t NIL = 0xFFFF;
+
+    FramePool()
+    {
+        for (uint16_t i = 0; i < FRAME_POOL_FRAMES; ++i)
+        {
+            _next[i].store((i + 1 < FRAME_POOL_FRAMES) ? (uint16_t)(i + 1) : NIL, std::memory_order_relaxed);
+            _refs[i].store(0, std::memory_order_relaxed);
+        }
+        _head.store(0, std::memory_order_release);
+    }
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    /// head word for frame index i, with the change counter of old bumped
+    static uint32_t pack(uint16_t i, uint32_t old)
+    {
+        return ((old & 0xFFFF0000u) + 0x10000u) | i;
+    }
+
+    RadioPacket _frames[FRAME_POOL_FRAMES];
+    std::atomic<uint8_t> _refs[FRAME_POOL_FRAMES];
+    std::atomic<uint16_t> _next[FRAME_POOL_FRAMES]; // free-list links
+    std::atomic<uint32_t> _head;                    // change counter << 16 | top free index
+
+    std::atomic<uint32_t> _allocs{0};
+    std::atomic<uint32_t> _frees{0};
+    std::atomic<uint32_t> _retains{0};
+    std::atomic<uint32_t> _copies{0};
+    std::atomic<uint32_t> _exhausted{0};
+    std::atomic<uint16_t> _inUse{0};
+    std::atomic<uint16_t> _peak{0};
+};
+
+#endif // FRAME_POOL_H
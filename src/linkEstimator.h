@@ -0,0 +1,264 @@
+#ifndef LINK_ESTIMATOR_H
+#define LINK_ESTIMATOR_H
+
+#include <stdint.h>
+#include <vector>
+#include <FreeRTOS.h>
+
+/* Route metric unit: one transmission over a lossless link. Path metrics
+   are sums of per-link ETX in these units, so a route of n clean hops
+   costs n * ETX_UNIT – the same order as plain hop count.            */
+static constexpr uint16_t ETX_UNIT = 16;
+
+/* Demodulation floor of the radio's spreading factor (SX126x datasheet).
+   RadioManager::begin runs SF9; change together with it.              */
+#ifndef LINK_SNR_FLOOR_DB
+#define LINK_SNR_FLOOR_DB -12.5f
+#endif
+
+/* SNR above the floor at which a link counts as lossless. Below it the
+   delivery ratio is taken to fall linearly to zero at the floor; fading
+   makes a link that is only just decodable on average lose most frames. */
+#ifndef LINK_SNR_MARGIN_DB
+#define LINK_SNR_MARGIN_DB 8
+#endif
+
+/* EWMA weight of a new sample, 1 / 2^LINK_EWMA_SHIFT. */
+#ifndef LINK_EWMA_SHIFT
+#define LINK_EWMA_SHIFT 3
+#endif
+
+/* Ceiling on the ETX of one link, in transmissions. */
+#ifndef LINK_ETX_MAX
+#define LINK_ETX_MAX 8
+#endif
+
+/* A route must be this much cheaper (a quarter of a clean hop) to displace
+   one of the same freshness, so two near-equal paths do not flap.      */
+#ifndef LINK_ETX_HYSTERESIS
+#define LINK_ETX_HYSTERESIS (ETX_UNIT / 4)
+#endif
+
+/* Neighbours tracked at once; the one heard longest ago makes room. */
+#ifndef LINK_ESTIMATOR_CAPACITY
+#define LINK_ESTIMATOR_CAPACITY 32
+#endif
+
+struct LinkQuality
+{
+    int16_t rssiQ4;      ///< smoothed RSSI, 1/16 dBm
+    int16_t snrQ4;       ///< smoothed SNR, 1/16 dB
+    uint16_t etx;        ///< ETX_UNITs, from snrQ4
+    uint16_t samples;    ///< frames measured, saturating
+    uint16_t frames;     ///< frames heard, measured or not, saturating
+    uint8_t missed;      ///< beacon periods gone by without a frame, as of the last expire()
+    TickType_t lastHeard;
+};
+
+struct LinkEstimatorStats
+{
+    uint32_t samples;   ///< frames measured
+    uint32_t unknown;   ///< ETX asked of a neighbour never measured
+    uint32_t evictions; ///< neighbours dropped to make room
+    uint32_t timeouts;  ///< neighbours reported gone by expire()
+    uint16_t tracked;   ///< neighbours held now
+};
+
+/**
+ * @brief Per-neighbour link quality from the RSSI/SNR of received frames,
+ *        turned into an ETX-style cost (De Couto et al., "A high-throughput
+ *        path metric for multi-hop wireless routing").
+ *
+ * Every authenticated frame updates an EWMA of its sender's SNR and RSSI.
+ * The same table is the router's neighbour table: every frame, measured or
+ * not, refreshes its sender's last-heard time, and expire() reports the
+ * neighbours that stayed silent for too many beacon periods.
+ * LoRa gives no per-link delivery counts for free, so the delivery ratio p is
+ * modelled from the SNR margin over the demodulation floor. The link is
+ * assumed symmetric, so ETX = 1 / p², capped at LINK_ETX_MAX. A neighbour never
+ * measured costs one ETX_UNIT, which keeps routing by hop count wherever
+ * radios report nothing.
+ *
+ * Fixed capacity, nothing is allocated after construction; lookups are
+ * linear over a table the size of a neighbourhood. Not thread-safe –
+ * AODVRouter guards it with _mutex.
+ */
+template <uint16_t CAPACITY>
+class LinkEstimator
+{
+public:
+    LinkEstimator() { clear(); }
+
+    /// a frame from neighbour (RSSI in dBm, SNR in dB) was heard; rssi 0 = alive but not measured
+    void sample(uint32_t neighbour, int16_t rssi, int8_t snr, TickType_t now)
+    {
+        Slot *e = lookup(neighbour);
+        if (e == nullptr)
+        {
+            e = claim(neighbour);
+            e->q = LinkQuality{0, 0, ETX_UNIT, 0, 0, 0, now};
+        }
+        if (e->q.frames < 0xFFFF)
+            ++e->q.frames;
+        e->q.missed = 0;
+        e->q.lastHeard = now;
+        if (rssi == 0)
+            return;
+
+        ++_stats.samples;
+        int16_t rssiQ4 = (int16_t)(rssi * 16);
+        int16_t snrQ4 = (int16_t)(snr * 16);
+        if (e->q.samples == 0)
+        {
+            e->q.rssiQ4 = rssiQ4;
+            e->q.snrQ4 = snrQ4;
+        }
+        else
+        {
+            e->q.rssiQ4 += (int16_t)((rssiQ4 - e->q.rssiQ4) >> LINK_EWMA_SHIFT);
+            e->q.snrQ4 += (int16_t)((snrQ4 - e->q.snrQ4) >> LINK_EWMA_SHIFT);
+        }
+        if (e->q.samples < 0xFFFF)
+            ++e->q.samples;
+        e->q.etx = etxFromSnr(e->q.snrQ4);
+    }
+
+    /// cost of one transmission to neighbour, ETX_UNIT if never measured
+    uint16_t etx(uint32_t neighbour)
+    {
+        const Slot *e = lookup(neighbour);
+        if (e == nullptr || e->q.samples == 0)
+        {
+            ++_stats.unknown;
+            return ETX_UNIT;
+        }
+        return e->q.etx;
+    }
+
+    bool find(uint32_t neighbour, LinkQuality &out) const
+    {
+        const Slot *e = const_cast<LinkEstimator *>(this)->lookup(neighbour);
+        if (e == nullptr)
+            return false;
+        out = e->q;
+        return true;
+    }
+
+    bool forget(uint32_t neighbour)
+    {
+        Slot *e = lookup(neighbour);
+        if (e == nullptr)
+            return false;
+        e->used = false;
+        --_stats.tracked;
+        return true;
+    }
+
+    /**
+     * @brief Count the beacon periods each neighbour has been silent for.
+     * Appends to gone every neighbour silent for maxMissed periods or more;
+     * they stay tracked until forget(), so a late frame still finds them.
+     */
+    void expire(TickType_t now, TickType_t period, uint8_t maxMissed, std::vector<uint32_t> &gone)
+    {
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            Slot &s = _slots[i];
+            if (!s.used)
+                continue;
+            uint32_t missed = (uint32_t)(now - s.q.lastHeard) / period;
+            s.q.missed = (uint8_t)(missed < 0xFF ? missed : 0xFF);
+            if (s.q.missed >= maxMissed)
+            {
+                gone.push_back(s.neighbour);
+                ++_stats.timeouts;
+            }
+        }
+    }
+
+    void clear()
+    {
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+            _slots[i].used = false;
+        _stats.tracked = 0;
+    }
+
+    /// ETX in ETX_UNITs of a link with this smoothed SNR (1/16 dB)
+    static uint16_t etxFromSnr(int16_t snrQ4)
+    {
+        const int32_t floorQ4 = (int32_t)(LINK_SNR_FLOOR_DB * 16);
+        const int32_t fullQ4 = LINK_SNR_MARGIN_DB * 16;
+        const uint32_t cap = (uint32_t)LINK_ETX_MAX * ETX_UNIT;
+        int32_t margin = snrQ4 - floorQ4;
+        if (margin >= fullQ4)
+            return ETX_UNIT;
+        if (margin <= 0)
+            return (uint16_t)cap;
+        // p = margin / full, ETX = 1 / p²
+        uint32_t etx = (uint32_t)ETX_UNIT * fullQ4 * fullQ4 / ((uint32_t)margin * margin);
+        return (uint16_t)(etx < cap ? etx : cap);
+    }
+
+    /// f(neighbour, quality) for every neighbour tracked
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            if (_slots[i].used)
+                f(_slots[i].neighbour, _slots[i].q);
+        }
+    }
+
+    size_t size() const { return _stats.tracked; }
+    static constexpr size_t capacity() { return CAPACITY; }
+
+    const LinkEstimatorStats &stats() const { return _stats; }
+
+private:
+    struct Slot
+    {
+        uint32_t neighbour;
+        LinkQuality q;
+        bool used;
+    };
+
+    Slot *lookup(uint32_t neighbour)
+    {
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            if (_slots[i].used && _slots[i].neighbour == neighbour)
+                return &_slots[i];
+        }
+        return nullptr;
+    }
+
+    /// a free slot for neighbour, evicting the one heard longest ago if need be
+    Slot *claim(uint32_t neighbour)
+    {
+        Slot *victim = nullptr;
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            Slot &s = _slots[i];
+            if (!s.used)
+            {
+                victim = &s;
+                break;
+            }
+            if (victim == nullptr || (int32_t)(s.q.lastHeard - victim->q.lastHeard) < 0)
+                victim = &s;
+        }
+        if (victim->used)
+            ++_stats.evictions;
+        else
+            ++_stats.tracked;
+        victim->used = true;
+        victim->neighbour = neighbour;
+        return victim;
+    }
+
+    Slot _slots[CAPACITY];
+    LinkEstimatorStats _stats{};
+};
+
+#endif // LINK_ESTIMATOR_H
@@ -0,0 +1,48 @@
+#ifndef LORA_AIRTIME_H
+#define LORA_AIRTIME_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* Modem settings RadioManager::begin() puts the SX1262 in. Protocol
+   timers that depend on how long a frame is on air derive from these. */
+static constexpr float LORA_FREQ_MHZ = 868.0F;
+static constexpr float LORA_BW_KHZ = 125.0F;
+static constexpr uint8_t LORA_SF = 9;
+static constexpr uint8_t LORA_CR = 7; ///< coding rate 4/LORA_CR
+static constexpr uint16_t LORA_PREAMBLE = 8;
+
+/// one symbol, in microseconds
+constexpr uint32_t loraSymbolTimeUs(uint8_t sf = LORA_SF, float bwKHz = LORA_BW_KHZ)
+{
+    return (uint32_t)((1000.0F * (1u << sf)) / bwKHz);
+}
+
+/// ceil(num / den) for the payload symbol count, 0 when num is not positive
+constexpr uint32_t loraCeilDiv(int32_t num, int32_t den)
+{
+    return num <= 0 ? 0 : (uint32_t)((num + den - 1) / den);
+}
+
+/**
+ * @brief Time on air of a len-byte frame, in microseconds.
+ *
+ * SX126x datasheet §6.1.4: explicit header, CRC on, low data rate
+ * optimisation once a symbol exceeds 16 ms.
+ */
+constexpr uint32_t loraAirtimeUs(size_t len, uint8_t sf = LORA_SF, float bwKHz = LORA_BW_KHZ,
+                                 uint8_t cr = LORA_CR, uint16_t preamble = LORA_PREAMBLE)
+{
+    return (4u * preamble + 17u) * loraSymbolTimeUs(sf, bwKHz) / 4u +
+           (8u + cr * loraCeilDiv(8 * (int32_t)len - 4 * sf + 44,
+                                  4 * (sf - (loraSymbolTimeUs(sf, bwKHz) > 16000 ? 2 : 0)))) *
+               loraSymbolTimeUs(sf, bwKHz);
+}
+
+/// time on air of a len-byte frame, rounded up to whole milliseconds
+constexpr uint32_t loraAirtimeMs(size_t len)
+{
+    return (loraAirtimeUs(len) + 999u) / 1000u;
+}
+
+#endif // LORA_AIRTIME_H
@@ -0,0 +1,258 @@
+#ifndef NEIGHBOURHOOD_H
+#define NEIGHBOURHOOD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+/* Neighbours advertised in one BROADCAST_INFO trailer (4 bytes each).
+   A node with more lists its MPRs and then as many others as fit; the
+   rest of its 2-hop neighbourhood is unknown to the receivers.        */
+#ifndef MPR_MAX_ADVERTISED
+#define MPR_MAX_ADVERTISED 24
+#endif
+
+/* Relayed BROADCAST_INFO frames remembered after being declined, so a
+   later copy from a neighbour that did pick us as its MPR is still sent. */
+#ifndef MPR_DECLINED_MEMORY
+#define MPR_DECLINED_MEMORY 16
+#endif
+
+/* A beacon carries our neighbour list only when it changed, and otherwise
+   every this many beacons. Neighbours keep the last list they heard, so
+   the trailer's bytes, which every relay repeats, are rarely spent.    */
+#ifndef MPR_LIST_REFRESH
+#define MPR_LIST_REFRESH 4
+#endif
+
+struct NeighbourhoodStats
+{
+    uint32_t hellos;     ///< neighbour lists read off beacons
+    uint32_t advertised; ///< our beacons that carried our neighbour list
+    uint32_t selections; ///< MPR set recomputations that changed it
+    uint32_t relayed;    ///< floods forwarded as an MPR of the previous hop (or for a legacy one)
+    uint32_t declined;   ///< floods not forwarded: the previous hop did not pick us
+    uint32_t rescued;    ///< declined floods sent after all on a copy from a selector
+    uint16_t mprs;       ///< size of our MPR set now
+    uint16_t twoHop;     ///< strict 2-hop neighbours known now
+};
+
+/**
+ * @brief Two-hop neighbourhood and multipoint relay selection (OLSR,
+ *        RFC 3626 §8).
+ *
+ * Every beacon carries its origin's 1-hop neighbours, and the ones it picked
+ * as multipoint relays (MPRs). From those lists a node knows who
+ * each neighbour reaches. It picks a small set of neighbours (its MPRs)
+ * that together reach every strict 2-hop neighbour. A flood then only
+ * needs to be forwarded by the MPRs of whoever sent it, so the number of
+ * relays grows with the diameter of the mesh rather than its size.
+ *
+ * The 1-hop set itself is the router's (routes of one hop); this class only
+ * keeps what each neighbour told us. A neighbour that never sent a list
+ * is assumed to run without MPRs, and everything it sends is relayed as
+ * before. Not thread-safe – AODVRouter guards it with _mutex.
+ */
+class Neighbourhood
+{
+public:
+    /// neighbour's own beacon listed these neighbours, the first numMprs its MPRs; true if its 2-hop reach changed
+    bool heard(uint32_t neighbour, const uint32_t *ids, uint8_t count, uint8_t numMprs, uint32_t me)
+    {
+        ++_stats.hellos;
+        Entry &e = _entries[neighbour];
+        e.selectsUs = false;
+        std::vector<uint32_t> reach;
+        reach.reserve(count);
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            if (ids[i] == me)
+            {
+                e.selectsUs |= i < numMprs;
+                continue;
+            }
+            reach.push_back(ids[i]);
+        }
+        std::sort(reach.begin(), reach.end());
+        bool changed = !e.advertised || reach != e.reach;
+        e.reach.swap(reach);
+        e.advertised = true;
+        return changed;
+    }
+
+    /// neighbour is gone; true if we held anything for it
+    bool forget(uint32_t neighbour) { return _entries.erase(neighbour) != 0; }
+
+    /**
+     * @brief Recompute the MPR set over the 1-hop neighbours in oneHop,
+     *        dropping what is held for anyone no longer among them.
+     * Greedy heuristic of RFC 3626 §8.3.1: first every neighbour that is
+     * the only way to some 2-hop node, then whichever covers the most
+     * 2-hop nodes still uncovered, until all are. True if the set changed.
+     */
+    bool select(const std::vector<uint32_t> &oneHop, uint32_t me)
+    {
+        for (auto it = _entries.begin(); it != _entries.end();)
+        {
+            if (std::find(oneHop.begin(), oneHop.end(), it->first) == oneHop.end())
+                it = _entries.erase(it);
+            else
+                ++it;
+        }
+
+        // strict 2-hop set: reachable through a neighbour, not me, not a neighbour
+        std::unordered_map<uint32_t, uint16_t> twoHop; // node -> neighbours reaching it
+        for (const auto &kv : _entries)
+        {
+            for (uint32_t n2 : kv.second.reach)
+            {
+                if (n2 != me && std::find(oneHop.begin(), oneHop.end(), n2) == oneHop.end())
+                    ++twoHop[n2];
+            }
+        }
+
+        std::vector<uint32_t> mprs;
+        std::unordered_map<uint32_t, bool> covered;
+        auto take = [&](uint32_t n)
+        {
+            mprs.push_back(n);
+            for (uint32_t n2 : _entries[n].reach)
+            {
+                if (twoHop.count(n2))
+                    covered[n2] = true;
+            }
+        };
+
+        for (const auto &kv : _entries)
+        {
+            for (uint32_t n2 : kv.second.reach)
+            {
+                auto t = twoHop.find(n2);
+                if (t != twoHop.end() && t->second == 1 && !covered.count(n2))
+                {
+                    take(kv.first);
+                    break;
+                }
+            }
+        }
+
+        while (covered.size() < twoHop.size())
+        {
+            uint32_t best = 0;
+            size_t bestGain = 0, bestDegree = 0;
+            for (const auto &kv : _entries)
+            {
+                if (std::find(mprs.begin(), mprs.end(), kv.first) != mprs.end())
+                    continue;
+                size_t gain = 0;
+                for (uint32_t n2 : kv.second.reach)
+                    gain += twoHop.count(n2) && !covered.count(n2);
+                // ties go to the neighbour reaching more nodes, then the lower ID, so the choice is stable
+                if (gain > bestGain ||
+                    (gain == bestGain && gain > 0 &&
+                     (kv.second.reach.size() > bestDegree || (kv.second.reach.size() == bestDegree && kv.first < best))))
+                {
+                    best = kv.first;
+                    bestGain = gain;
+                    bestDegree = kv.second.reach.size();
+                }
+            }
+            if (bestGain == 0)
+                break;
+            take(best);
+        }
+
+        std::sort(mprs.begin(), mprs.end());
+        _stats.twoHop = (uint16_t)twoHop.size();
+        _stats.mprs = (uint16_t)mprs.size();
+        if (mprs == _mprs)
+            return false;
+        _mprs.swap(mprs);
+        ++_stats.selections;
+        return true;
+    }
+
+    /// forward a flood received from prevHop? Yes if it picked us, or never told us whom it picks
+    bool shouldRelay(uint32_t prevHop) const
+    {
+        auto it = _entries.find(prevHop);
+        return it == _entries.end() || !it->second.advertised || it->second.selectsUs;
+    }
+
+    /// a flood was not forwarded; remember it in case a selector sends it too
+    void declined(uint32_t origin, uint32_t packetID)
+    {
+        ++_stats.declined;
+        _declined[_declinedNext] = {origin, packetID, true};
+        _declinedNext = (_declinedNext + 1) % MPR_DECLINED_MEMORY;
+    }
+
+    /// a duplicate came in from prevHop; true (once) if it is one we declined and prevHop picked us
+    bool rescue(uint32_t prevHop, uint32_t origin, uint32_t packetID)
+    {
+        if (!shouldRelay(prevHop))
+            return false;
+        for (Declined &d : _declined)
+        {
+            if (d.used && d.origin == origin && d.packetID == packetID)
+            {
+                d.used = false;
+                ++_stats.rescued;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// about to beacon with this neighbour list (MPRs first); true if it should be attached
+    bool advertise(const std::vector<uint32_t> &list, uint8_t numMprs)
+    {
+        if (list == _lastList && numMprs == _lastMprs && ++_sinceList < MPR_LIST_REFRESH)
+            return false;
+        _lastList = list;
+        _lastMprs = numMprs;
+        _sinceList = 0;
+        ++_stats.advertised;
+        return true;
+    }
+
+    void relayed() { ++_stats.relayed; }
+
+    /// our MPRs, ascending
+    const std::vector<uint32_t> &mprs() const { return _mprs; }
+
+    bool isMpr(uint32_t neighbour) const
+    {
+        return std::binary_search(_mprs.begin(), _mprs.end(), neighbour);
+    }
+
+    const NeighbourhoodStats &stats() const { return _stats; }
+
+private:
+    struct Entry
+    {
+        std::vector<uint32_t> reach; ///< its neighbours other than us, ascending
+        bool advertised = false;     ///< it sent us a neighbour list
+        bool selectsUs = false;      ///< we are one of its MPRs
+    };
+
+    struct Declined
+    {
+        uint32_t origin;
+        uint32_t packetID;
+        bool used;
+    };
+
+    std::unordered_map<uint32_t, Entry> _entries;
+    std::vector<uint32_t> _mprs;
+    Declined _declined[MPR_DECLINED_MEMORY] = {};
+    uint8_t _declinedNext = 0;
+    std::vector<uint32_t> _lastList; ///< the neighbour list we last advertised
+    uint8_t _lastMprs = 0;
+    uint8_t _sinceList = 0; ///< beacons sent without it since
+    NeighbourhoodStats _stats{};
+};
+
+#endif // NEIGHBOURHOOD_H
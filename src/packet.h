@@ -44,9 +44,9 @@ enum flags : uint8_t
 static constexpr uint8_t FLAG_ENCRYPTED = 0x80;
 static const uint32_t BROADCAST_ADDR = 0xFFFFFFFF;
 
-// Base header (20 bytes)
+// Base header (22 bytes)
 /**
- * @brief The base header (20 bytes).
+ * @brief The base header (22 bytes).
  *
  * destNodeID      (4 bytes) - Next hop of the message or BroadcastAddr for broadcast msgs. See aodvRouter implementation for more details.
  * prevHopID       (4 bytes) - The previous hop of the packet.
@@ -60,28 +60,50 @@ static const uint32_t BROADCAST_ADDR = 0xFFFFFFFF;
  * flags           (1 byte)  - Bitmask for optional flags (see flags enum).
  * hopCount        (1 byte)  - Number of hops (incremented +1 per hop).
  * reserved        (1 byte)  - Reserved for future expansion.
+ * originSeq       (2 bytes) - Per-origin sequence number, stamped only when the sender is originNodeID
+ *                             (0 = unsequenced, falls back to the packetID cache). See seqWindow.h.
  */
+#pragma pack(push, 1)
 struct BaseHeader
 {
-    uint32_t destNodeID;   // 4 bytes
-    uint32_t prevHopID;    // 4 bytes
-    uint32_t originNodeID; // 4 bytes
-    uint32_t packetID;     // 4 bytes
-    uint8_t packetType;    // 1 byte: see PacketType
-    uint8_t flags;         // 1 byte: see flags enum
-    uint8_t hopCount;      // 1 byte: TTL/hop count
-    uint8_t reserved;      // 1 byte: reserved
+    uint32_t destNodeID;    // 4 bytes
+    uint32_t prevHopID;     // 4 bytes
+    uint32_t originNodeID;  // 4 bytes
+    uint32_t packetID;      // 4 bytes
+    uint8_t packetType;     // 1 byte: see PacketType
+    uint8_t flags;          // 1 byte: see flags enum
+    uint8_t hopCount;       // 1 byte: TTL/hop count
+    uint8_t reserved;       // 1 byte: reserved
+    uint16_t originSeq = 0; // 2 bytes: see above
 };
+#pragma pack(pop)
+
+static constexpr size_t BASE_HDR_FLAGS_OFFSET = 17; // flags byte within the serialised BaseHeader
 
-// Extended header for RREQ (8 bytes)
+/*
+ * Destination sequence numbers (AODV, RFC 3561): every node owns a counter that
+ * only it advances (before each RREQ it originates, and up to the requested
+ * value when it answers as destination). Routes are ranked by that number
+ * first and hop count second, so fresh information beats short stale paths.
+ * 0 means "unknown". Not to be confused with BaseHeader.originSeq, which only
+ * feeds duplicate detection.
+ */
+
+// Extended header for RREQ (15 bytes) -> has to be packed
+#pragma pack(push, 1)
 struct RREQHeader
 {
-    uint32_t RREQDestNodeID; // 4 bytes: Node ID we want to find route to
+    uint32_t RREQDestNodeID;   // 4 bytes: Node ID we want to find route to
+    uint32_t originSeqNum = 0; // 4 bytes: requester's own sequence number (for the reverse route)
+    uint32_t destSeqNum = 0;   // 4 bytes: freshest seq known for the destination, 0 = unknown
+    uint8_t ttl = 0;           // 1 byte:  expanding-ring hop limit, not forwarded beyond it (0 = network-wide)
+    uint16_t metric = 0;       // 2 bytes: ETX of the path from the requester so far, ETX_UNIT per clean hop
     // uint8_t currentHops;     // 1 byte:  Current number of hops
     // uint8_t rreqReserved;    // 1 byte:  reserved
 };
+#pragma pack(pop)
 
-// Extended header for RREP (11 bytes) -> has to be packed
+// Extended header for RREP (13 bytes) -> has to be packed
 #pragma pack(push, 1)
 struct RREPHeader
 {
@@ -89,6 +111,8 @@ struct RREPHeader
     uint32_t RREPDestNodeID; // 4 bytes: destination of route
     uint16_t lifetime;       // 2 bytes: route lifetime
     uint8_t numHops;         // 1 byte:  Number of hops using this route
+    uint32_t destSeqNum = 0; // 4 bytes: destination sequence number of the advertised route
+    uint16_t metric = 0;     // 2 bytes: ETX from the sender to RREPDestNodeID, ETX_UNIT per clean hop
 };
 #pragma pack(pop)
 
@@ -99,9 +123,22 @@ struct RERRHeader
     uint32_t brokenNodeID;       // 4 bytes: Broken nodeID
     uint32_t originalDestNodeID; // 4 bytes: Original intended destination
     uint32_t originalPacketID;   // 4 bytes: Original packetID that will have been overwritten
+    uint32_t destSeqNum = 0;     // 4 bytes: originalDestNodeID's seq, bumped by the reporter
     // uint32_t originNodeID;       // 4 bytes: The original sender
 };
 
+/* Trailer on a RERR to precursors, which every node sends afresh as its
+   own (originNodeID == prevHopID, originalPacketID 0): the destinations
+   the break made unreachable besides originalDestNodeID, each followed
+   by its bumped seq. A receiver only drops the ones it routes via the
+   sender.                                                            */
+#pragma pack(push, 1)
+struct RERRDestListHeader
+{
+    uint8_t numDests; // 1 B: (destNodeID, destSeqNum) pairs that follow
+};
+#pragma pack(pop)
+
 // Extended header for ACk (4 bytes)
 struct ACKHeader
 {
@@ -122,6 +159,15 @@ struct DiffBroadcastInfoHeader
     uint16_t numAdded;   // 2 B
     uint16_t numRemoved; // 2 B
 };
+
+/* Trailer on a node's own BROADCAST_INFO, after the user IDs: its 1-hop
+   neighbours, the ones it picked as multipoint relays first. Relays pass
+   it on untouched; it is only read off a beacon heard from its origin.  */
+struct NeighbourListHeader
+{
+    uint8_t numNeighbours; // 1 B: node IDs that follow
+    uint8_t numMprs;       // 1 B: how many of those, from the front, are our MPRs
+};
 #pragma pack(pop)
 
 struct UREQHeader
@@ -195,6 +241,8 @@ inline size_t serialiseBaseHeader(const BaseHeader &header, uint8_t *buffer)
     buffer[offset++] = header.flags;
     buffer[offset++] = header.hopCount;
     buffer[offset++] = header.reserved;
+    memcpy(buffer + offset, &header.originSeq, 2);
+    offset += 2;
     return offset;
 }
 
@@ -213,6 +261,8 @@ inline size_t deserialiseBaseHeader(const uint8_t *buffer, BaseHeader &header)
     header.flags = buffer[offset++];
     header.hopCount = buffer[offset++];
     header.reserved = buffer[offset++];
+    memcpy(&header.originSeq, buffer + offset, 2);
+    offset += 2;
     return offset;
 }
 
@@ -225,6 +275,13 @@ inline size_t serialiseRREQHeader(const RREQHeader &header, uint8_t *buffer, siz
 
     memcpy(buffer + offset, &header.RREQDestNodeID, 4);
     offset += 4;
+    memcpy(buffer + offset, &header.originSeqNum, 4);
+    offset += 4;
+    memcpy(buffer + offset, &header.destSeqNum, 4);
+    offset += 4;
+    buffer[offset++] = header.ttl;
+    memcpy(buffer + offset, &header.metric, 2);
+    offset += 2;
     // buffer[offset++] = header.currentHops;
     // buffer[offset++] = header.rreqReserved;
     return offset;
@@ -235,6 +292,13 @@ inline size_t deserialiseRREQHeader(const uint8_t *buffer, RREQHeader &header, s
 
     memcpy(&header.RREQDestNodeID, buffer + offset, 4);
     offset += 4;
+    memcpy(&header.originSeqNum, buffer + offset, 4);
+    offset += 4;
+    memcpy(&header.destSeqNum, buffer + offset, 4);
+    offset += 4;
+    header.ttl = buffer[offset++];
+    memcpy(&header.metric, buffer + offset, 2);
+    offset += 2;
     // header.currentHops = buffer[offset++];
     // header.rreqReserved = buffer[offset++];
     return offset;
@@ -251,6 +315,10 @@ inline size_t serialiseRREPHeader(const RREPHeader &header, uint8_t *buffer, siz
     memcpy(buffer + offset, &header.lifetime, 2);
     offset += 2;
     buffer[offset++] = header.numHops;
+    memcpy(buffer + offset, &header.destSeqNum, 4);
+    offset += 4;
+    memcpy(buffer + offset, &header.metric, 2);
+    offset += 2;
     return offset;
 }
 
@@ -261,6 +329,10 @@ inline size_t deserialiseRREPHeader(const uint8_t *buffer, RREPHeader &header, s
     memcpy(&header.lifetime, buffer + offset, 2);
     offset += 2;
     header.numHops = buffer[offset++];
+    memcpy(&header.destSeqNum, buffer + offset, 4);
+    offset += 4;
+    memcpy(&header.metric, buffer + offset, 2);
+    offset += 2;
     return offset;
 }
 
@@ -278,6 +350,8 @@ inline size_t serialiseRERRHeader(const RERRHeader &header, uint8_t *buffer, siz
     offset += 4;
     memcpy(buffer + offset, &header.originalPacketID, 4);
     offset += 4;
+    memcpy(buffer + offset, &header.destSeqNum, 4);
+    offset += 4;
     return offset;
 }
 
@@ -291,6 +365,20 @@ inline size_t deserialiseRERRHeader(const uint8_t *buffer, RERRHeader &header, s
     offset += 4;
     memcpy(&header.originalPacketID, buffer + offset, 4);
     offset += 4;
+    memcpy(&header.destSeqNum, buffer + offset, 4);
+    offset += 4;
+    return offset;
+}
+
+inline size_t serialiseRERRDestListHeader(const RERRDestListHeader &header, uint8_t *buffer, size_t offset)
+{
+    buffer[offset++] = header.numDests;
+    return offset;
+}
+
+inline size_t deserialiseRERRDestListHeader(const uint8_t *buffer, RERRDestListHeader &header, size_t offset)
+{
+    header.numDests = buffer[offset++];
     return offset;
 }
 
@@ -357,6 +445,20 @@ inline size_t deserialiseBroadcastInfoHeader(const uint8_t *buffer, DiffBroadcas
     return offset;
 }
 
+inline size_t serialiseNeighbourListHeader(const NeighbourListHeader &header, uint8_t *buffer, size_t offset)
+{
+    buffer[offset++] = header.numNeighbours;
+    buffer[offset++] = header.numMprs;
+    return offset;
+}
+
+inline size_t deserialiseNeighbourListHeader(const uint8_t *buffer, NeighbourListHeader &header, size_t offset)
+{
+    header.numNeighbours = buffer[offset++];
+    header.numMprs = buffer[offset++];
+    return offset;
+}
+
 // ──────────────────────────────────────────────────────────────────────────────
 // UREQ (User Route Request)
 // ──────────────────────────────────────────────────────────────────────────────
@@ -0,0 +1,231 @@
+#ifndef PENDING_STORE_H
+#define PENDING_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <list>
+#include <vector>
+#include <FreeRTOS.h>
+
+/* Messages waiting on a route or user discovery may hold at most this many
+   entries per destination and this many bytes (payload + bookkeeping) in
+   total. Override with -D in platformio.ini.                               */
+#ifndef PENDING_MAX_PER_DEST
+#define PENDING_MAX_PER_DEST 8
+#endif
+
+#ifndef PENDING_BYTE_BUDGET
+#define PENDING_BYTE_BUDGET 8192
+#endif
+
+/* A message nobody could route within this long is given up on. Matches
+   DISCOVERY_HOLD_TICKS: a late RREP is worth waiting for, but a discovery
+   kept alive by later misses must not hold its oldest messages forever.  */
+#ifndef PENDING_TTL_MS
+#define PENDING_TTL_MS 1800000
+#endif
+
+enum class PendingKind : uint8_t
+{
+    Data,      ///< sendData waiting on a route to key (node)
+    UserMsg,   ///< user message waiting on a UREQ for key (user)
+    UserRoute, ///< user message waiting on a route to key (node)
+    MoveReq    ///< MOVE_USER_REQ waiting on a route to key (node)
+};
+
+enum class PendingDrop : uint8_t
+{
+    Expired, ///< TTL ran out
+    DestCap, ///< PENDING_MAX_PER_DEST reached, oldest for that key dropped
+    Budget   ///< PENDING_BYTE_BUDGET reached, globally oldest dropped
+};
+
+struct PendingMessage
+{
+    PendingKind kind;
+    uint32_t key;        // destination node or user, see PendingKind
+    uint32_t packetID;   // original packet id, reported back on drop
+    uint32_t fromUserID; // sending user, 0 for node-originated data
+    uint32_t toUserID;   // recipient user; MoveReq: the node the user left
+    uint8_t *data;       // pvPortMalloc'd payload, owned by the store
+    size_t length;
+    TickType_t expiresAt; // 0 on push = now + TTL
+};
+
+struct PendingDropped
+{
+    PendingMessage msg;
+    PendingDrop reason;
+};
+
+struct PendingStoreStats
+{
+    uint32_t entries;       ///< messages held now
+    uint32_t bytes;         ///< bytes accounted now (payload + per-entry overhead)
+    uint32_t peakBytes;     ///< high-water mark of bytes
+    uint32_t queued;        ///< messages accepted
+    uint32_t released;      ///< messages handed back by take()
+    uint32_t expired;       ///< dropped on TTL
+    uint32_t droppedCap;    ///< dropped for the per-destination cap
+    uint32_t droppedBudget; ///< dropped for the byte budget
+};
+
+/**
+ * @brief One bounded store for every message parked behind a discovery.
+ *
+ * Entries are kept in arrival order, so the oldest is always at the front:
+ * that is what the per-destination cap and the byte budget drop first.
+ * Each entry also carries its own expiry tick. Dropped
+ * messages are handed back to the caller (who frees the payload and tells
+ * the phone) rather than freed here, so no notification ever runs under
+ * the router's lock. The store is small by construction (a few hundred
+ * entries at most) and lookups are linear. Not thread-safe – AODVRouter
+ * guards it with _mutex.
+ */
+class PendingStore
+{
+public:
+    explicit PendingStore(size_t perDestMax = PENDING_MAX_PER_DEST,
+                          size_t byteBudget = PENDING_BYTE_BUDGET,
+                          TickType_t ttl = pdMS_TO_TICKS(PENDING_TTL_MS))
+        : _perDestMax(perDestMax), _byteBudget(byteBudget), _ttl(ttl)
+    {
+    }
+
+    /// bookkeeping charged per entry on top of its payload
+    static size_t cost(const PendingMessage &m) { return sizeof(PendingMessage) + m.length; }
+
+    /// queue m (the store takes ownership of m.data); anything pushed out – m included – lands in dropped
+    void push(PendingMessage m, TickType_t now, std::vector<PendingDropped> &dropped)
+    {
+        if (m.expiresAt == 0)
+            m.expiresAt = now + _ttl;
+
+        if (cost(m) > _byteBudget)
+        {
+            ++_stats.droppedBudget;
+            dropped.push_back({m, PendingDrop::Budget});
+            return;
+        }
+
+        if (count(m.kind, m.key) >= _perDestMax)
+        {
+            for (auto it = _entries.begin(); it != _entries.end(); ++it)
+            {
+                if (it->kind == m.kind && it->key == m.key)
+                {
+                    ++_stats.droppedCap;
+                    dropped.push_back({*it, PendingDrop::DestCap});
+                    erase(it);
+                    break;
+                }
+            }
+        }
+
+        while (!_entries.empty() && _stats.bytes + cost(m) > _byteBudget)
+        {
+            ++_stats.droppedBudget;
+            dropped.push_back({_entries.front(), PendingDrop::Budget});
+            erase(_entries.begin());
+        }
+
+        _entries.push_back(m);
+        _stats.bytes += cost(m);
+        ++_stats.entries;
+        ++_stats.queued;
+        if (_stats.bytes > _stats.peakBytes)
+            _stats.peakBytes = _stats.bytes;
+    }
+
+    /// remove and return every message for (kind, key), oldest first; the caller owns their data
+    std::vector<PendingMessage> take(PendingKind kind, uint32_t key)
+    {
+        std::vector<PendingMessage> out;
+        for (auto it = _entries.begin(); it != _entries.end();)
+        {
+            if (it->kind == kind && it->key == key)
+            {
+                out.push_back(*it);
+                it = erase(it);
+                ++_stats.released;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        return out;
+    }
+
+    /// copies of the messages for (kind, key); the store keeps ownership
+    std::vector<PendingMessage> peek(PendingKind kind, uint32_t key) const
+    {
+        std::vector<PendingMessage> out;
+        for (const auto &m : _entries)
+        {
+            if (m.kind == kind && m.key == key)
+                out.push_back(m);
+        }
+        return out;
+    }
+
+    size_t count(PendingKind kind, uint32_t key) const
+    {
+        size_t n = 0;
+        for (const auto &m : _entries)
+            n += (m.kind == kind && m.key == key);
+        return n;
+    }
+
+    /// move every message past its TTL into dropped
+    void expire(TickType_t now, std::vector<PendingDropped> &dropped)
+    {
+        for (auto it = _entries.begin(); it != _entries.end();)
+        {
+            if ((int32_t)(now - it->expiresAt) >= 0)
+            {
+                ++_stats.expired;
+                dropped.push_back({*it, PendingDrop::Expired});
+                it = erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    /// earliest expiry among the held messages; false if there are none
+    bool nextExpiry(TickType_t &at) const
+    {
+        if (_entries.empty())
+            return false;
+        at = _entries.front().expiresAt;
+        for (const auto &m : _entries)
+        {
+            if ((int32_t)(m.expiresAt - at) < 0)
+                at = m.expiresAt;
+        }
+        return true;
+    }
+
+    bool empty() const { return _entries.empty(); }
+
+    const PendingStoreStats &stats() const { return _stats; }
+
+private:
+    std::list<PendingMessage>::iterator erase(std::list<PendingMessage>::iterator it)
+    {
+        _stats.bytes -= cost(*it);
+        --_stats.entries;
+        return _entries.erase(it);
+    }
+
+    std::list<PendingMessage> _entries; // arrival order
+    size_t _perDestMax;
+    size_t _byteBudget;
+    TickType_t _ttl;
+    PendingStoreStats _stats{};
+};
+
+#endif // PENDING_STORE_H
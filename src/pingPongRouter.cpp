@@ -2,6 +2,7 @@
 #include <FreeRTOS.h>
 #include <task.h>
 #include <string.h>
+#include "framePool.h"
 
 PingPongRouter::PingPongRouter(IRadioManager *radioManager)
     : _radioManager(radioManager), _routerTaskHandle(nullptr)
@@ -51,8 +52,8 @@ void PingPongRouter::routerTask(void *pvParameters)
                 Serial.write(packet->data, packet->len);
                 Serial.println();
             }
-            // Free the received packet after processing.
-            vPortFree(packet);
+            // Return the received frame to the pool after processing.
+            FramePool::instance().release(packet);
         }
     }
 }
@@ -1,4 +1,5 @@
 #include "RadioManager.h"
+#include <math.h>
 #include <FreeRTOS.h>
 #include <semphr.h>
 #include <task.h>
@@ -96,26 +97,29 @@ bool RadioManager::begin()
 
 bool RadioManager::enqueueTxPacket(const uint8_t *data, size_t len)
 {
-    RadioPacket *packet = (RadioPacket *)pvPortMalloc(sizeof(RadioPacket));
-    if (packet == nullptr)
+    if (len > sizeof(RadioPacket::data))
     {
-        Serial.println("[RadioManager] Could not allocate memory for packet!");
+        Serial.println("[RadioManager] Packet too large!");
         return false;
     }
-    if (len > sizeof(packet->data))
+    RadioPacket *packet = FramePool::instance().alloc();
+    if (packet == nullptr)
     {
-        Serial.println("[RadioManager] Packet too large!");
-        vPortFree(packet);
+        Serial.println("[RadioManager] Frame pool exhausted!");
         return false;
     }
 
     memcpy(packet->data, data, len);
     packet->len = len;
+    return enqueueTxFrame(packet);
+}
 
-    if (xQueueSend(_txQueue, &packet, 0) != pdPASS)
+bool RadioManager::enqueueTxFrame(RadioPacket *frame)
+{
+    if (xQueueSend(_txQueue, &frame, 0) != pdPASS)
     {
         Serial.println("[RadioManager] Could not send packet to TX queue!");
-        vPortFree(packet);
+        FramePool::instance().release(frame);
         return false;
     }
 
@@ -133,16 +137,15 @@ bool RadioManager::dequeueRxPacket(RadioPacket **packet)
 
 bool RadioManager::enqueueRxPacket(const uint8_t *data, size_t len)
 {
-    RadioPacket *packet = (RadioPacket *)pvPortMalloc(sizeof(RadioPacket));
-    if (packet == nullptr)
+    if (len > sizeof(RadioPacket::data))
     {
-        Serial.println("[RadioManager] Could not allocate memory for packet!");
+        Serial.println("[RadioManager] Packet too large!");
         return false;
     }
-    if (len > sizeof(packet->data))
+    RadioPacket *packet = FramePool::instance().alloc();
+    if (packet == nullptr)
     {
-        Serial.println("[RadioManager] Packet too large!");
-        vPortFree(packet);
+        Serial.println("[RadioManager] Frame pool exhausted!");
         return false;
     }
 
@@ -151,7 +154,7 @@ bool RadioManager::enqueueRxPacket(const uint8_t *data, size_t len)
     if (xQueueSend(_rxQueue, &packet, 0) != pdPASS)
     {
         Serial.println("[RadioManager] Could not send packet to TX queue!");
-        vPortFree(packet);
+        FramePool::instance().release(packet);
         return false;
     }
     return true;
@@ -228,49 +231,48 @@ void RadioManager::radioTask(void *pvParameters)
 
 void RadioManager::handleReceiveInterrupt()
 {
-    // readData from the radio
-    RadioPacket *packet = (RadioPacket *)pvPortMalloc(sizeof(RadioPacket));
+    // read straight into a pool frame – the router gets this very buffer
+    RadioPacket *packet = FramePool::instance().alloc();
     if (packet == nullptr)
     {
-        Serial.print("[RadioManager] Memory Allocation failed in RX");
+        Serial.print("[RadioManager] Frame pool exhausted in RX");
         _radio->startReceive();
         return;
     }
 
     size_t packetLength = _radio->getPacketLength();
-    uint8_t buffer[255];
+    if (packetLength > sizeof(packet->data))
+    {
+        packetLength = sizeof(packet->data);
+    }
 
-    int result = _radio->readData(buffer, packetLength);
+    int result = _radio->readData(packet->data, packetLength);
     if (result == 0) // radiolib not imported equivalent to RADIOLIB_ERR_NONE
     {
-        size_t len = packetLength;
-        if (len == 0)
+        if (packetLength == 0)
         {
             Serial.print("Ignore empty");
-            vPortFree(packet);
+            FramePool::instance().release(packet);
             // Likely a false interrupt; just restart receive mode.
             _radio->startReceive();
             return;
         }
-        if (len > sizeof(packet->data))
-        {
-            len = sizeof(packet->data);
-        }
-
-        memcpy(packet->data, buffer, len);
-        packet->len = len;
+        packet->len = packetLength;
+        // link quality of this very frame, for the router's neighbour estimates
+        packet->rssi = (int16_t)lroundf(_radio->getRSSI());
+        packet->snr = (int8_t)lroundf(_radio->getSNR());
 
         if (xQueueSend(_rxQueue, &packet, 0) != pdPASS)
         {
             Serial.print("[RadioManager] RX queue full, dropping packet");
-            vPortFree(packet);
+            FramePool::instance().release(packet);
         }
     }
     else
     {
         Serial.print("[RadioManager] readData error: ");
         Serial.println(result);
-        vPortFree(packet);
+        FramePool::instance().release(packet);
     }
 
     // Always restart receive
@@ -538,8 +540,7 @@ void RadioManager::txTask(void *pvParameteres)
         if (mgr->_isTransmitting)
             xSemaphoreTake(mgr->_txDoneSemaphore, portMAX_DELAY);
 
-        TickType_t backoffBin = pdMS_TO_TICKS(mgr->csma.binInitMs);
-        uint8_t beExp = 2;
+        CsmaBackoff backoff(mgr->csma);
         bool sent = false;
 
         while (!sent)
@@ -547,43 +548,15 @@ void RadioManager::txTask(void *pvParameteres)
             /*  busy? → choose a back-off ---------------------- */
             if (!mgr->_radio->isChannelFree())
             {
-                TickType_t waitTicks = 0;
-
-                switch (mgr->csma.scheme)
-                {
-                case CsmaOptions::BackoffScheme::Binary:
-                {
-                    uint32_t rnd = esp_random() % (backoffBin / portTICK_PERIOD_MS + 1);
-                    waitTicks = pdMS_TO_TICKS(rnd);
-                    backoffBin = std::min(backoffBin * 2, pdMS_TO_TICKS(mgr->csma.binMaxMs));
-                    break;
-                }
-                case CsmaOptions::BackoffScheme::BE:
-                {
-                    if (beExp > mgr->csma.beMaxExp)
-                        beExp = mgr->csma.beMaxExp;
-                    uint32_t slot = esp_random() % (1u << beExp);
-                    waitTicks = pdMS_TO_TICKS(slot * mgr->csma.beUnitMs);
-                    ++beExp;
-                    break;
-                }
-                default: /* legacy uniform 5–50 ms */
-                    waitTicks = pdMS_TO_TICKS(mgr->csma.legacyMinMs + esp_random() % (mgr->csma.legacyMaxMs - mgr->csma.legacyMinMs + 1));
-                }
-
-                vTaskDelay(waitTicks);
+                vTaskDelay(backoff.busyWait());
                 continue; // retry CCA afterwards
             }
 
             /*  channel looks idle – optional PCSMA coin-flip -- */
-            if (mgr->csma.pcsmaEnabled)
+            if (backoff.deferTransmit())
             {
-                float r = esp_random() / static_cast<float>(UINT32_MAX);
-                if (r > mgr->csma.pTransmit)
-                {
-                    vTaskDelay(pdMS_TO_TICKS(mgr->csma.deferSlotMs));
-                    continue; // defer one slot, retry
-                }
+                vTaskDelay(pdMS_TO_TICKS(mgr->csma.deferSlotMs));
+                continue; // defer one slot, retry
             }
 
             /*  guard time RX→TX  ---------- */
@@ -607,7 +580,7 @@ void RadioManager::txTask(void *pvParameteres)
             }
             sent = true; // leave CSMA loop regardless of rc
         }
-        
-        vPortFree(pkt);
+
+        FramePool::instance().release(pkt);
     }
 }
\ No newline at end of file
@@ -0,0 +1,529 @@
+#ifndef ROUTE_TABLE_H
+#define ROUTE_TABLE_H
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+
+/* Routes held at once, fixed at build time. Each costs one slot (~28
+   bytes, plus 16 per backup and 4 per precursor below) and two 8-byte buckets in each index.
+   Override with -D.                                                    */
+#ifndef ROUTE_TABLE_CAPACITY
+#define ROUTE_TABLE_CAPACITY 128
+#endif
+
+/* Alternative next hops kept per destination, best first. When the
+   primary breaks the best one still usable takes over without a new
+   discovery. 0 keeps a single route per destination.                  */
+#ifndef ROUTE_BACKUPS
+#define ROUTE_BACKUPS 2
+#endif
+
+/* Upstream neighbours remembered per route as forwarding through us
+   (RFC 3561 precursors, 4 bytes each). When the route breaks they are
+   the ones told; the one heard from longest ago makes room.          */
+#ifndef ROUTE_PRECURSORS
+#define ROUTE_PRECURSORS 4
+#endif
+
+struct RouteEntry
+{
+    uint32_t nextHop;
+    uint8_t hopcount;
+    uint16_t metric;      // ETX of the path, ETX_UNIT per clean hop (linkEstimator.h); 0 = not known
+    TickType_t expiresAt; // tick after which the route is stale and must be rediscovered
+    uint32_t destSeqNum;  // destination sequence number, 0 = unknown
+};
+
+/**
+ * @brief Fixed-capacity destination -> RouteEntry table with a next-hop index.
+ *
+ * Routes sit in a flat slot array. Two open-addressing indexes (linear
+ * probing, twice the capacity, key stored in the bucket so a probe never
+ * leaves the index) map a destination to its slot and a next hop to the
+ * head of an intrusive list of the slots routed through it. Dropping every
+ * route through a broken neighbour therefore walks only those routes.
+ * Nothing is allocated after construction. Not thread-safe – AODVRouter
+ * guards it with _mutex.
+ *
+ * Each route also carries up to ROUTE_BACKUPS alternatives through other
+ * next hops (AOMDV, Marina & Das). They are not indexed: only the primary
+ * is used for forwarding, and promote()/failoverVia() swap the best
+ * alternative in when it breaks. Whether one is still usable is the
+ * caller's call.
+ *
+ * A route also lists its precursors: the neighbours that sent us traffic
+ * for dest. They survive a change of next hop, and go with the route.
+ *
+ * Pointers returned by find() stay valid until the next insert/erase; the
+ * next hop must only be changed through insert() or promote() so the index
+ * stays right.
+ */
+template <uint16_t CAPACITY>
+class RouteTable
+{
+    static_assert(CAPACITY > 0 && CAPACITY < 0x4000, "slot index must fit the uint16_t buckets");
+
+public:
+    RouteTable() { clear(); }
+
+    RouteEntry *find(uint32_t dest)
+    {
+        uint16_t pos;
+        uint16_t slot = lookup(_byDest, dest, pos);
+        return slot == NIL ? nullptr : &_slots[slot].route;
+    }
+
+    const RouteEntry *find(uint32_t dest) const
+    {
+        return const_cast<RouteTable *>(this)->find(dest);
+    }
+
+    size_t count(uint32_t dest) const { return find(dest) ? 1 : 0; }
+
+    /// add or overwrite the route to dest; nullptr if the table is full
+    RouteEntry *insert(uint32_t dest, const RouteEntry &re)
+    {
+        uint16_t pos;
+        uint16_t slot = lookup(_byDest, dest, pos);
+        if (slot != NIL)
+        {
+            Slot &s = _slots[slot];
+            if (s.route.nextHop != re.nextHop)
+            {
+                dropBackup(s, re.nextHop); // an alternative made primary is no longer one
+                unlinkVia(slot);
+                s.route = re;
+                linkVia(slot);
+            }
+            else
+            {
+                s.route = re;
+            }
+            return &s.route;
+        }
+
+        if (_free == NIL)
+            return nullptr;
+        slot = _free;
+        _free = _slots[slot].viaNext;
+
+        Slot &s = _slots[slot];
+        s.dest = dest;
+        s.route = re;
+        s.numBackups = 0;
+        s.numPrecursors = 0;
+        s.used = true;
+        _byDest[pos] = {dest, slot};
+        linkVia(slot);
+        ++_size;
+        return &s.route;
+    }
+
+    bool erase(uint32_t dest)
+    {
+        uint16_t pos;
+        uint16_t slot = lookup(_byDest, dest, pos);
+        if (slot == NIL)
+            return false;
+        removeSlot(slot, pos);
+        return true;
+    }
+
+    /// drop every route whose next hop is nextHop, calling onErase(dest) for each
+    template <typename F>
+    size_t eraseVia(uint32_t nextHop, F onErase)
+    {
+        uint16_t pos;
+        uint16_t slot = lookup(_byVia, nextHop, pos);
+        size_t n = 0;
+        while (slot != NIL)
+        {
+            uint16_t next = _slots[slot].viaNext;
+            uint32_t dest = _slots[slot].dest;
+            erase(dest);
+            onErase(dest);
+            ++n;
+            slot = next;
+        }
+        return n;
+    }
+
+    /// f(dest, route) for every route whose next hop is nextHop; f must not change the next hop
+    template <typename F>
+    void forEachVia(uint32_t nextHop, F f)
+    {
+        uint16_t pos;
+        for (uint16_t slot = lookup(_byVia, nextHop, pos); slot != NIL; slot = _slots[slot].viaNext)
+            f(_slots[slot].dest, _slots[slot].route);
+    }
+
+    /**
+     * @brief Keep alt as an alternative to the route to dest.
+     * An alternative through a next hop already held replaces it; otherwise
+     * it takes a free place or the worst one's, if it is better. Ranked by
+     * metric, then hop count. False if dest has no route, alt goes through
+     * its next hop, or it ranks below every alternative of a full set.
+     */
+    bool addBackup(uint32_t dest, const RouteEntry &alt)
+    {
+        if (ROUTE_BACKUPS == 0)
+            return false;
+        uint16_t pos;
+        uint16_t slot = lookup(_byDest, dest, pos);
+        if (slot == NIL || _slots[slot].route.nextHop == alt.nextHop)
+            return false;
+        Slot &s = _slots[slot];
+        dropBackup(s, alt.nextHop);
+        if (s.numBackups == ROUTE_BACKUPS)
+        {
+            if (!better(alt, s.backups[ROUTE_BACKUPS - 1]))
+                return false;
+            --s.numBackups;
+        }
+        uint8_t i = s.numBackups++;
+        for (; i > 0 && better(alt, s.backups[i - 1]); --i)
+            s.backups[i] = s.backups[i - 1];
+        s.backups[i] = alt;
+        return true;
+    }
+
+    /// the alternatives to dest, best first; count set to how many (0 if no route)
+    const RouteEntry *backups(uint32_t dest, uint8_t &count) const
+    {
+        uint16_t pos;
+        uint16_t slot = lookup(_byDest, dest, pos);
+        count = slot == NIL ? 0 : _slots[slot].numBackups;
+        return slot == NIL ? nullptr : _slots[slot].backups;
+    }
+
+    /**
+     * @brief Replace the route to dest with its best alternative for which
+     *        usable(dest, alt) holds. The old route is dropped, the alternatives
+     *        ranked above the one taken too: they were found unusable.
+     * @return the new route, or nullptr (route left as it was) if none is.
+     */
+    template <typename F>
+    RouteEntry *promote(uint32_t dest, F usable)
+    {
+        uint16_t pos;
+        uint16_t slot = lookup(_byDest, dest, pos);
+        return slot == NIL ? nullptr : promoteSlot(slot, usable);
+    }
+
+    /**
+     * @brief Every route whose next hop is nextHop moves to its best usable
+     *        alternative, calling onPromote(dest, route); the ones without
+     *        are dropped, calling onErase(dest) just before, while their
+     *        precursors can still be read.
+     * @return routes dropped
+     */
+    template <typename F, typename P, typename E>
+    size_t failoverVia(uint32_t nextHop, F usable, P onPromote, E onErase)
+    {
+        uint16_t pos;
+        uint16_t slot = lookup(_byVia, nextHop, pos);
+        size_t n = 0;
+        while (slot != NIL)
+        {
+            uint16_t next = _slots[slot].viaNext; // promotion relinks slot under another next hop
+            uint32_t dest = _slots[slot].dest;
+            if (const RouteEntry *re = promoteSlot(slot, usable))
+            {
+                onPromote(dest, *re);
+            }
+            else
+            {
+                onErase(dest);
+                erase(dest);
+                ++n;
+            }
+            slot = next;
+        }
+        return n;
+    }
+
+    /// forget every alternative through nextHop (full scan)
+    size_t dropBackupsVia(uint32_t nextHop)
+    {
+        size_t n = 0;
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            if (_slots[i].used)
+                n += dropBackup(_slots[i], nextHop);
+        }
+        return n;
+    }
+
+    /// neighbour forwards traffic for dest through us; false if dest has no route or it is listed already
+    bool addPrecursor(uint32_t dest, uint32_t neighbour)
+    {
+        if (ROUTE_PRECURSORS == 0)
+            return false;
+        uint16_t pos;
+        uint16_t slot = lookup(_byDest, dest, pos);
+        if (slot == NIL)
+            return false;
+        Slot &s = _slots[slot];
+        for (uint8_t i = 0; i < s.numPrecursors; ++i)
+        {
+            if (s.precursors[i] == neighbour)
+                return false;
+        }
+        if (s.numPrecursors == ROUTE_PRECURSORS)
+        {
+            for (uint8_t i = 1; i < ROUTE_PRECURSORS; ++i)
+                s.precursors[i - 1] = s.precursors[i];
+            --s.numPrecursors;
+        }
+        s.precursors[s.numPrecursors++] = neighbour;
+        return true;
+    }
+
+    /// the precursors of the route to dest, oldest first; count set to how many (0 if no route)
+    const uint32_t *precursors(uint32_t dest, uint8_t &count) const
+    {
+        uint16_t pos;
+        uint16_t slot = lookup(_byDest, dest, pos);
+        count = slot == NIL ? 0 : _slots[slot].numPrecursors;
+        return slot == NIL ? nullptr : _slots[slot].precursors;
+    }
+
+    /// forget neighbour as a precursor of every route (full scan)
+    size_t dropPrecursor(uint32_t neighbour)
+    {
+        size_t n = 0;
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            Slot &s = _slots[i];
+            if (!s.used)
+                continue;
+            for (uint8_t j = 0; j < s.numPrecursors && j < ROUTE_PRECURSORS; ++j)
+            {
+                if (s.precursors[j] != neighbour)
+                    continue;
+                for (--s.numPrecursors; j < s.numPrecursors; ++j)
+                    s.precursors[j] = s.precursors[j + 1];
+                ++n;
+                break;
+            }
+        }
+        return n;
+    }
+
+    /// drop every route for which pred(dest, route) holds
+    template <typename F>
+    size_t eraseIf(F pred)
+    {
+        size_t n = 0;
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            if (_slots[i].used && pred(_slots[i].dest, (const RouteEntry &)_slots[i].route))
+            {
+                erase(_slots[i].dest);
+                ++n;
+            }
+        }
+        return n;
+    }
+
+    /// f(dest, route) for every route, in slot order
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            if (_slots[i].used)
+                f(_slots[i].dest, _slots[i].route);
+        }
+    }
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    bool full() const { return _free == NIL; }
+    static constexpr size_t capacity() { return CAPACITY; }
+
+    void clear()
+    {
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            _slots[i].used = false;
+            _slots[i].viaNext = (i + 1 < CAPACITY) ? (uint16_t)(i + 1) : NIL;
+        }
+        for (uint16_t i = 0; i < TABLE_SIZE; ++i)
+        {
+            _byDest[i].slot = NIL;
+            _byVia[i].slot = NIL;
+        }
+        _free = 0;
+        _size = 0;
+    }
+
+private:
+    static constexpr uint16_t NIL = 0xFFFF;
+
+    static constexpr uint16_t tableSize()
+    {
+        uint16_t n = 1;
+        while (n < 2 * CAPACITY)
+            n <<= 1;
+        return n;
+    }
+    static constexpr uint16_t TABLE_SIZE = tableSize();
+
+    struct Slot
+    {
+        uint32_t dest;
+        RouteEntry route;
+        RouteEntry backups[ROUTE_BACKUPS ? ROUTE_BACKUPS : 1]; ///< alternatives, best first
+        uint8_t numBackups;
+        uint32_t precursors[ROUTE_PRECURSORS ? ROUTE_PRECURSORS : 1]; ///< neighbours routing dest through us, oldest first
+        uint8_t numPrecursors;
+        uint16_t viaPrev; ///< previous slot with the same next hop (NIL = head)
+        uint16_t viaNext; ///< next slot with the same next hop; free-list link when unused
+        bool used;
+    };
+
+    struct Bucket
+    {
+        uint32_t key;
+        uint16_t slot; ///< NIL = empty bucket
+    };
+
+    static uint16_t home(uint32_t key)
+    {
+        // Fibonacci hashing: node IDs are MAC-derived and cluster in the low bits
+        return (uint16_t)((key * 2654435769u) >> 16) & (TABLE_SIZE - 1);
+    }
+
+    /* Returns the slot stored under key, or NIL. pos is the bucket of the
+       match, or the empty bucket where key would go.                      */
+    static uint16_t lookup(const Bucket *index, uint32_t key, uint16_t &pos)
+    {
+        pos = home(key);
+        while (index[pos].slot != NIL)
+        {
+            if (index[pos].key == key)
+                return index[pos].slot;
+            pos = (pos + 1) & (TABLE_SIZE - 1);
+        }
+        return NIL;
+    }
+
+    /* Empty bucket pos and close the gap with backward-shift deletion so
+       later probes still find their keys.                                */
+    static void removeBucket(Bucket *index, uint16_t pos)
+    {
+        uint16_t gap = pos;
+        uint16_t next = (gap + 1) & (TABLE_SIZE - 1);
+        while (index[next].slot != NIL)
+        {
+            uint16_t want = home(index[next].key);
+            // move next into the gap unless its home lies cyclically in (gap, next]
+            bool stays = (gap <= next) ? (gap < want && want <= next)
+                                       : (gap < want || want <= next);
+            if (!stays)
+            {
+                index[gap] = index[next];
+                gap = next;
+            }
+            next = (next + 1) & (TABLE_SIZE - 1);
+        }
+        index[gap].slot = NIL;
+    }
+
+    void linkVia(uint16_t slot)
+    {
+        Slot &s = _slots[slot];
+        uint16_t pos;
+        uint16_t head = lookup(_byVia, s.route.nextHop, pos);
+        s.viaPrev = NIL;
+        s.viaNext = head;
+        if (head != NIL)
+        {
+            _slots[head].viaPrev = slot;
+            _byVia[pos].slot = slot;
+        }
+        else
+        {
+            _byVia[pos] = {s.route.nextHop, slot};
+        }
+    }
+
+    void unlinkVia(uint16_t slot)
+    {
+        Slot &s = _slots[slot];
+        if (s.viaNext != NIL)
+            _slots[s.viaNext].viaPrev = s.viaPrev;
+        if (s.viaPrev != NIL)
+        {
+            _slots[s.viaPrev].viaNext = s.viaNext;
+            return;
+        }
+
+        // slot was the head of its next hop's list
+        uint16_t pos;
+        lookup(_byVia, s.route.nextHop, pos);
+        if (s.viaNext != NIL)
+            _byVia[pos].slot = s.viaNext;
+        else
+            removeBucket(_byVia, pos);
+    }
+
+    static bool better(const RouteEntry &a, const RouteEntry &b)
+    {
+        return a.metric < b.metric || (a.metric == b.metric && a.hopcount < b.hopcount);
+    }
+
+    /// remove the alternative through nextHop, if held; 1 if it was
+    static size_t dropBackup(Slot &s, uint32_t nextHop)
+    {
+        for (uint8_t i = 0; i < s.numBackups; ++i)
+        {
+            if (s.backups[i].nextHop != nextHop)
+                continue;
+            for (--s.numBackups; i < s.numBackups; ++i)
+                s.backups[i] = s.backups[i + 1];
+            return 1;
+        }
+        return 0;
+    }
+
+    template <typename F>
+    RouteEntry *promoteSlot(uint16_t slot, F usable)
+    {
+        Slot &s = _slots[slot];
+        for (uint8_t i = 0; i < s.numBackups; ++i)
+        {
+            if (!usable(s.dest, (const RouteEntry &)s.backups[i]))
+                continue;
+            RouteEntry alt = s.backups[i];
+            uint8_t kept = 0;
+            for (uint8_t j = i + 1; j < s.numBackups && j < ROUTE_BACKUPS; ++j)
+                s.backups[kept++] = s.backups[j];
+            s.numBackups = kept;
+            unlinkVia(slot);
+            s.route = alt;
+            linkVia(slot);
+            return &s.route;
+        }
+        return nullptr;
+    }
+
+    void removeSlot(uint16_t slot, uint16_t destPos)
+    {
+        unlinkVia(slot);
+        removeBucket(_byDest, destPos);
+        _slots[slot].used = false;
+        _slots[slot].viaNext = _free;
+        _free = slot;
+        --_size;
+    }
+
+    Slot _slots[CAPACITY];
+    Bucket _byDest[TABLE_SIZE];
+    Bucket _byVia[TABLE_SIZE];
+    uint16_t _free;
+    uint16_t _size;
+};
+
+#endif // ROUTE_TABLE_H
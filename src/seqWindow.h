@@ -0,0 +1,255 @@
+#ifndef SEQ_WINDOW_H
+#define SEQ_WINDOW_H
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+
+/* Origins tracked at once, fixed at build time. Each costs one slot (~16
+   bytes) and two 8-byte index buckets; beyond this an origin not heard
+   from lately makes room.                                              */
+#ifndef SEQ_WINDOW_MAX_ORIGINS
+#define SEQ_WINDOW_MAX_ORIGINS 128
+#endif
+
+/* A sequence number further behind than the window only restarts it (a
+   reboot, whose counter starts afresh) once its origin has been silent
+   this long. Until then it is a late or replayed copy and is dropped.
+   Must outlast a flood: hop limits x one LoRa hop is well under this.  */
+#ifndef SEQ_WINDOW_RESYNC_MS
+#define SEQ_WINDOW_RESYNC_MS 30000
+#endif
+
+struct SeqWindowStats
+{
+    uint32_t hits;      ///< duplicates detected inside the window
+    uint32_t stale;     ///< far behind the window of an origin still heard: dropped as a late copy
+    uint32_t misses;    ///< new sequence numbers accepted
+    uint32_t resyncs;   ///< far behind after the origin fell silent (reboot) – window restarted
+    uint32_t evictions; ///< origins dropped to stay within SEQ_WINDOW_MAX_ORIGINS
+};
+
+/**
+ * @brief Per-origin sliding-window duplicate filter (IPsec replay-window style).
+ *
+ * Every node stamps the packets it originates with an increasing 16-bit
+ * BaseHeader::originSeq. For each origin we keep the highest sequence seen
+ * plus a 32-bit bitmap of the ones just below it, so a duplicate check is
+ * a shift and a mask. Sequence numbers compare in serial-number arithmetic
+ * (RFC 1982) so wrap-around is harmless. A jump ahead of the window moves
+ * it on; a number further behind it restarts the window only after the
+ * origin has been silent for SEQ_WINDOW_RESYNC_MS, so one late flood copy
+ * cannot reopen what was already seen.
+ *
+ * Windows sit in a fixed slot array behind an open-addressing index
+ * (linear probing, twice the capacity), as in RouteTable. When it is full
+ * a CLOCK sweep picks the victim: every mark() sets a slot's referenced
+ * bit, the hand clears them in passing and takes the first slot found
+ * clear. Nothing is allocated after construction. Not thread-safe –
+ * AODVRouter guards it with _mutex.
+ */
+template <uint16_t CAPACITY>
+class SeqWindowTable
+{
+    static_assert(CAPACITY > 0 && CAPACITY < 0x4000, "slot index must fit the uint16_t buckets");
+
+public:
+    static const uint8_t WINDOW = 32;
+
+    explicit SeqWindowTable(TickType_t resyncAfter = pdMS_TO_TICKS(SEQ_WINDOW_RESYNC_MS))
+        : _resyncAfter(resyncAfter)
+    {
+        clear();
+    }
+
+    /// true if seq from origin was already recorded, or is a late copy from an origin still heard
+    bool isDuplicate(uint32_t origin, uint16_t seq, TickType_t now)
+    {
+        uint16_t pos;
+        uint16_t slot = lookup(origin, pos);
+        if (slot == NIL)
+        {
+            ++_stats.misses;
+            return false;
+        }
+        const Window &w = _slots[slot];
+        int16_t ahead = (int16_t)(seq - w.top);
+        if (ahead > 0)
+        {
+            ++_stats.misses;
+            return false;
+        }
+        if (-ahead >= WINDOW)
+        {
+            if (silent(w, now))
+            {
+                ++_stats.misses;
+                return false;
+            }
+            ++_stats.stale;
+            return true;
+        }
+        if (!(w.seen & (1u << -ahead)))
+        {
+            ++_stats.misses;
+            return false;
+        }
+        ++_stats.hits;
+        return true;
+    }
+
+    /// record seq from origin as seen; a late copy from an origin still heard leaves its window alone
+    void mark(uint32_t origin, uint16_t seq, TickType_t now)
+    {
+        uint16_t pos;
+        uint16_t slot = lookup(origin, pos);
+        if (slot == NIL)
+        {
+            slot = claim();
+            lookup(origin, pos); // eviction may have moved the empty bucket
+            _index[pos] = {origin, slot};
+            _slots[slot] = {origin, seq, 1u, now, true};
+            return;
+        }
+
+        Window &w = _slots[slot];
+        int16_t ahead = (int16_t)(seq - w.top);
+        if (ahead > 0)
+        {
+            w.seen = (ahead >= WINDOW) ? 1u : (w.seen << ahead) | 1u;
+            w.top = seq;
+        }
+        else if (-ahead >= WINDOW)
+        {
+            if (!silent(w, now))
+                return;
+            ++_stats.resyncs;
+            w.top = seq;
+            w.seen = 1u;
+        }
+        else
+        {
+            w.seen |= 1u << -ahead;
+        }
+        w.lastHeard = now;
+        w.referenced = true;
+    }
+
+    void clear()
+    {
+        for (uint16_t i = 0; i < TABLE_SIZE; ++i)
+            _index[i].slot = NIL;
+        _size = 0;
+        _hand = 0;
+    }
+
+    size_t size() const { return _size; }
+    static constexpr size_t capacity() { return CAPACITY; }
+
+    const SeqWindowStats &stats() const { return _stats; }
+
+private:
+    static constexpr uint16_t NIL = 0xFFFF;
+
+    static constexpr uint16_t tableSize()
+    {
+        uint16_t n = 1;
+        while (n < 2 * CAPACITY)
+            n <<= 1;
+        return n;
+    }
+    static constexpr uint16_t TABLE_SIZE = tableSize();
+
+    struct Window
+    {
+        uint32_t origin;
+        uint16_t top;         ///< highest sequence number seen
+        uint32_t seen;        ///< bit i set: top - i seen
+        TickType_t lastHeard; ///< last sequence number recorded
+        bool referenced;      ///< recorded since the CLOCK hand last passed
+    };
+
+    struct Bucket
+    {
+        uint32_t key;
+        uint16_t slot; ///< NIL = empty bucket
+    };
+
+    bool silent(const Window &w, TickType_t now) const
+    {
+        return (int32_t)(now - w.lastHeard) >= (int32_t)_resyncAfter;
+    }
+
+    static uint16_t home(uint32_t key)
+    {
+        // Fibonacci hashing: node IDs are MAC-derived and cluster in the low bits
+        return (uint16_t)((key * 2654435769u) >> 16) & (TABLE_SIZE - 1);
+    }
+
+    /* Returns the slot stored under key, or NIL. pos is the bucket of the
+       match, or the empty bucket where key would go.                      */
+    uint16_t lookup(uint32_t key, uint16_t &pos) const
+    {
+        pos = home(key);
+        while (_index[pos].slot != NIL)
+        {
+            if (_index[pos].key == key)
+                return _index[pos].slot;
+            pos = (pos + 1) & (TABLE_SIZE - 1);
+        }
+        return NIL;
+    }
+
+    /* Empty bucket pos and close the gap with backward-shift deletion so
+       later probes still find their keys.                                */
+    void removeBucket(uint16_t pos)
+    {
+        uint16_t gap = pos;
+        uint16_t next = (gap + 1) & (TABLE_SIZE - 1);
+        while (_index[next].slot != NIL)
+        {
+            uint16_t want = home(_index[next].key);
+            // move next into the gap unless its home lies cyclically in (gap, next]
+            bool stays = (gap <= next) ? (gap < want && want <= next)
+                                       : (gap < want || want <= next);
+            if (!stays)
+            {
+                _index[gap] = _index[next];
+                gap = next;
+            }
+            next = (next + 1) & (TABLE_SIZE - 1);
+        }
+        _index[gap].slot = NIL;
+    }
+
+    /// a free slot, evicting the first one the CLOCK hand finds unreferenced if all are taken
+    uint16_t claim()
+    {
+        if (_size < CAPACITY)
+            return _size++;
+        for (;;)
+        {
+            uint16_t slot = _hand;
+            _hand = (uint16_t)((_hand + 1) % CAPACITY);
+            Window &w = _slots[slot];
+            if (w.referenced)
+            {
+                w.referenced = false;
+                continue;
+            }
+            uint16_t pos;
+            lookup(w.origin, pos);
+            removeBucket(pos);
+            ++_stats.evictions;
+            return slot;
+        }
+    }
+
+    Window _slots[CAPACITY];
+    Bucket _index[TABLE_SIZE];
+    uint16_t _size;
+    uint16_t _hand; ///< CLOCK hand over _slots
+    TickType_t _resyncAfter;
+    SeqWindowStats _stats{};
+};
+
+#endif // SEQ_WINDOW_H
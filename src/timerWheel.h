@@ -0,0 +1,268 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+
+struct TimerWheelStats
+{
+    uint32_t scheduled; ///< timers armed
+    uint32_t fired;     ///< timers that ran out
+    uint32_t cancelled; ///< timers disarmed before running out
+    uint32_t cascaded;  ///< moves from a coarser level to a finer one
+    uint32_t exhausted; ///< schedule() found every timer armed
+    uint16_t armed;     ///< timers armed now
+    uint16_t peak;      ///< high-water mark of armed
+};
+
+/**
+ * @brief Fixed-capacity hierarchical timer wheel over the FreeRTOS tick.
+ *
+ * Four levels of 256 slots each cover the whole 32-bit tick range at
+ * one-tick resolution: level 0 holds timers due within 256 ticks, one
+ * slot per tick; level k holds those due within 2^(8(k+1)) ticks, one slot
+ * per 2^(8k) ticks, and a slot is spread over the level below when the
+ * wheel reaches it (Varghese & Lauck). Arming and cancelling are O(1); a
+ * bitmap per level lets advance() and nextDeadline() jump straight to the
+ * next occupied slot, so a long idle stretch costs nothing.
+ *
+ * A timer is just (kind, key): advance() hands them to a callback and the
+ * owner decides what they mean. Nothing is allocated after construction.
+ * Not thread-safe – AODVRouter guards it with _mutex.
+ */
+template <uint16_t CAPACITY>
+class TimerWheel
+{
+    static_assert(CAPACITY > 0 && CAPACITY < 0xFFFF, "timer index must fit uint16_t");
+
+public:
+    explicit TimerWheel(TickType_t now = 0) { clear(now); }
+
+    /// arm a timer; a deadline not after the last advance() runs on the next one. Returns a handle for cancel(), 0 if full
+    uint32_t schedule(TickType_t deadline, uint8_t kind, uint32_t key)
+    {
+        if (_free == NIL)
+        {
+            ++_stats.exhausted;
+            return 0;
+        }
+        uint16_t i = _free;
+        Timer &t = _timers[i];
+        _free = t.next;
+
+        t.deadline = ((int32_t)(deadline - _now) > 0) ? deadline : _now + 1;
+        t.kind = kind;
+        t.key = key;
+        t.armed = true;
+        if (++t.gen == 0)
+            t.gen = 1;
+        link(i);
+
+        ++_stats.scheduled;
+        if (++_stats.armed > _stats.peak)
+            _stats.peak = _stats.armed;
+        return ((uint32_t)t.gen << 16) | i;
+    }
+
+    /// disarm the timer behind handle; false if it already ran out or was cancelled
+    bool cancel(uint32_t handle)
+    {
+        uint16_t i = (uint16_t)handle;
+        if (handle == 0 || i >= CAPACITY || !_timers[i].armed || _timers[i].gen != (uint16_t)(handle >> 16))
+            return false;
+        unlink(i);
+        release(i);
+        ++_stats.cancelled;
+        return true;
+    }
+
+    /// run every timer due at or before now through fire(kind, key), earliest first; returns how many ran
+    template <typename F>
+    size_t advance(TickType_t now, F fire)
+    {
+        size_t n = 0;
+        while ((int32_t)(now - _now) > 0)
+        {
+            TickType_t next = 0;
+            if (!nextDeadline(next) || (int32_t)(next - now) > 0)
+            {
+                _now = now;
+                break;
+            }
+            _now = next;
+
+            for (uint8_t level = LEVELS - 1; level > 0; --level)
+            {
+                if ((_now & ((1u << (BITS * level)) - 1)) == 0)
+                    cascade(level, (uint8_t)(_now >> (BITS * level)));
+            }
+
+            uint8_t slot = (uint8_t)_now;
+            while (_heads[0][slot] != NIL)
+            {
+                uint16_t i = _heads[0][slot];
+                uint8_t kind = _timers[i].kind;
+                uint32_t key = _timers[i].key;
+                unlink(i);
+                release(i);
+                ++_stats.fired;
+                ++n;
+                fire(kind, key);
+            }
+        }
+        return n;
+    }
+
+    /// the next tick advance() has work at – a deadline, or a coarser slot to spread out; false if nothing is armed
+    bool nextDeadline(TickType_t &at) const
+    {
+        if (_stats.armed == 0)
+            return false;
+        bool found = false;
+        for (uint8_t level = 0; level < LEVELS; ++level)
+        {
+            uint8_t shift = BITS * level;
+            uint8_t cur = (uint8_t)(_now >> shift);
+            int slot = nextOccupied(level, (uint8_t)(cur + 1));
+            if (slot < 0)
+                continue;
+            uint32_t steps = (uint8_t)(slot - cur);
+            if (steps == 0)
+                steps = SLOTS; // the slot we are in comes round again only after a full turn
+            TickType_t t = (TickType_t)(((_now >> shift) + steps) << shift);
+            if (!found || (int32_t)(t - at) < 0)
+                at = t;
+            found = true;
+        }
+        return found;
+    }
+
+    size_t size() const { return _stats.armed; }
+    bool empty() const { return _stats.armed == 0; }
+    TickType_t now() const { return _now; }
+    static constexpr size_t capacity() { return CAPACITY; }
+
+    const TimerWheelStats &stats() const { return _stats; }
+
+    /// disarm everything and restart the wheel at now
+    void clear(TickType_t now)
+    {
+        for (uint16_t i = 0; i < CAPACITY; ++i)
+        {
+            _timers[i].armed = false;
+            _timers[i].gen = 0;
+            _timers[i].next = (i + 1 < CAPACITY) ? (uint16_t)(i + 1) : NIL;
+        }
+        for (uint8_t level = 0; level < LEVELS; ++level)
+        {
+            for (uint16_t s = 0; s < SLOTS; ++s)
+                _heads[level][s] = NIL;
+            for (uint8_t w = 0; w < WORDS; ++w)
+                _occupied[level][w] = 0;
+        }
+        _free = 0;
+        _now = now;
+        _stats = {};
+    }
+
+private:
+    static constexpr uint8_t LEVELS = 4;
+    static constexpr uint8_t BITS = 8;
+    static constexpr uint16_t SLOTS = 1u << BITS;
+    static constexpr uint8_t WORDS = SLOTS / 32;
+    static constexpr uint16_t NIL = 0xFFFF;
+
+    struct Timer
+    {
+        TickType_t deadline;
+        uint32_t key;
+        uint16_t prev; ///< within its slot
+        uint16_t next; ///< within its slot; free-list link when unarmed
+        uint16_t gen;  ///< bumped on every schedule so stale handles miss
+        uint8_t kind;
+        uint8_t level;
+        uint8_t slot;
+        bool armed;
+    };
+
+    void link(uint16_t i)
+    {
+        Timer &t = _timers[i];
+        uint32_t delta = t.deadline - _now; // 0 only while cascading into the slot about to run
+        uint8_t level = 0;
+        while (level < LEVELS - 1 && delta >= (1u << (BITS * (level + 1))))
+            ++level;
+        t.level = level;
+        t.slot = (uint8_t)(t.deadline >> (BITS * level));
+        t.prev = NIL;
+        t.next = _heads[level][t.slot];
+        if (t.next != NIL)
+            _timers[t.next].prev = i;
+        _heads[level][t.slot] = i;
+        _occupied[level][t.slot >> 5] |= 1u << (t.slot & 31);
+    }
+
+    void unlink(uint16_t i)
+    {
+        Timer &t = _timers[i];
+        if (t.prev != NIL)
+            _timers[t.prev].next = t.next;
+        else
+            _heads[t.level][t.slot] = t.next;
+        if (t.next != NIL)
+            _timers[t.next].prev = t.prev;
+        if (_heads[t.level][t.slot] == NIL)
+            _occupied[t.level][t.slot >> 5] &= ~(1u << (t.slot & 31));
+    }
+
+    void release(uint16_t i)
+    {
+        _timers[i].armed = false;
+        _timers[i].next = _free;
+        _free = i;
+        --_stats.armed;
+    }
+
+    /// re-file every timer of (level, slot) against the current time
+    void cascade(uint8_t level, uint8_t slot)
+    {
+        uint16_t i = _heads[level][slot];
+        _heads[level][slot] = NIL;
+        _occupied[level][slot >> 5] &= ~(1u << (slot & 31));
+        while (i != NIL)
+        {
+            uint16_t next = _timers[i].next;
+            link(i);
+            ++_stats.cascaded;
+            i = next;
+        }
+    }
+
+    /// first occupied slot of level at or after from, wrapping round; -1 if the level is empty
+    int nextOccupied(uint8_t level, uint8_t from) const
+    {
+        const uint32_t *bm = _occupied[level];
+        uint8_t word = from >> 5;
+        for (uint8_t n = 0; n <= WORDS; ++n)
+        {
+            uint8_t w = (uint8_t)((word + n) % WORDS);
+            uint32_t bits = bm[w];
+            if (n == 0)
+                bits &= ~0u << (from & 31);
+            else if (n == WORDS)
+                bits &= (1u << (from & 31)) - 1; // back at the first word: only what lies before from
+            if (bits)
+                return w * 32 + __builtin_ctz(bits);
+        }
+        return -1;
+    }
+
+    Timer _timers[CAPACITY];
+    uint16_t _heads[LEVELS][SLOTS];
+    uint32_t _occupied[LEVELS][WORDS];
+    uint16_t _free;
+    TickType_t _now; // every timer due at or before this has run
+    TimerWheelStats _stats;
+};
+
+#endif // TIMER_WHEEL_H
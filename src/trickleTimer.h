@@ -0,0 +1,141 @@
+#ifndef TRICKLE_TIMER_H
+#define TRICKLE_TIMER_H
+
+#include <stdint.h>
+#include <FreeRTOS.h>
+
+/* Trickle parameters for BROADCAST_INFO (RFC 6206 §4.1). The interval runs
+   from Imin to Imin << DOUBLINGS; a beacon is suppressed once K consistent
+   ones from neighbours were heard in the same interval (0 = never).
+   Override with -D in platformio.ini.                                     */
+#ifndef TRICKLE_IMIN_MS
+#define TRICKLE_IMIN_MS 30000
+#endif
+
+#ifndef TRICKLE_DOUBLINGS
+#define TRICKLE_DOUBLINGS 3
+#endif
+
+#ifndef TRICKLE_K
+#define TRICKLE_K 3
+#endif
+
+struct TrickleConfig
+{
+    TickType_t imin = pdMS_TO_TICKS(TRICKLE_IMIN_MS);
+    uint8_t doublings = TRICKLE_DOUBLINGS;
+    uint8_t k = TRICKLE_K; ///< redundancy constant, 0 = never suppress
+};
+
+struct TrickleStats
+{
+    uint32_t intervals;   ///< intervals started
+    uint32_t transmitted; ///< decision points that let the beacon go
+    uint32_t suppressed;  ///< decision points skipped for redundancy
+    uint32_t resets;      ///< inconsistencies that cut the interval back to Imin
+    uint32_t heard;       ///< consistent transmissions counted
+};
+
+enum class TrickleAction : uint8_t
+{
+    None,     ///< the interval ended, a new one started
+    Transmit, ///< decision point: send now
+    Suppress  ///< decision point: enough neighbours already said the same
+};
+
+/**
+ * @brief Trickle algorithm (RFC 6206) over the FreeRTOS tick.
+ *
+ * Each interval I has one decision point t drawn from [I/2, I). At t the
+ * owner transmits unless k consistent transmissions were heard since the
+ * interval began; at the end of I the interval doubles up to Imax. Anything
+ * inconsistent cuts I back to Imin, so news goes out fast while a quiet
+ * network costs almost nothing.
+ *
+ * The timer does not run itself: the owner arms its own timer at
+ * nextEvent() and calls fire() there. Randomness is passed in so the class
+ * stays deterministic under test. Not thread-safe – AODVRouter guards it
+ * with _mutex.
+ */
+class TrickleTimer
+{
+public:
+    explicit TrickleTimer(const TrickleConfig &cfg = TrickleConfig()) : _cfg(cfg) {}
+
+    void configure(const TrickleConfig &cfg) { _cfg = cfg; }
+    const TrickleConfig &config() const { return _cfg; }
+
+    /// begin with an interval of Imin
+    void start(TickType_t now, uint32_t rnd)
+    {
+        _interval = _cfg.imin;
+        begin(now, rnd);
+    }
+
+    /// a neighbour transmitted the same state we would
+    void consistent()
+    {
+        if (_heard < 0xFF)
+            ++_heard;
+        ++_stats.heard;
+    }
+
+    /// something changed: back to Imin. False if already there (nothing to re-arm)
+    bool reset(TickType_t now, uint32_t rnd)
+    {
+        if (_interval == _cfg.imin)
+            return false;
+        ++_stats.resets;
+        start(now, rnd);
+        return true;
+    }
+
+    /// run the event due at nextEvent()
+    TrickleAction fire(TickType_t now, uint32_t rnd)
+    {
+        if (!_decided)
+        {
+            _decided = true;
+            if (_cfg.k != 0 && _heard >= _cfg.k)
+            {
+                ++_stats.suppressed;
+                return TrickleAction::Suppress;
+            }
+            ++_stats.transmitted;
+            return TrickleAction::Transmit;
+        }
+
+        TickType_t imax = _cfg.imin << _cfg.doublings;
+        TickType_t end = _start + _interval;
+        _interval = (_interval >= imax / 2) ? imax : _interval * 2;
+        begin((int32_t)(now - end) > 0 ? now : end, rnd);
+        return TrickleAction::None;
+    }
+
+    /// tick of the next decision point or interval end
+    TickType_t nextEvent() const { return _decided ? _start + _interval : _start + _t; }
+
+    TickType_t interval() const { return _interval; }
+
+    const TrickleStats &stats() const { return _stats; }
+
+private:
+    void begin(TickType_t now, uint32_t rnd)
+    {
+        _start = now;
+        _t = _interval / 2 + (_interval > 1 ? rnd % (_interval / 2) : 0);
+        _heard = 0;
+        _decided = false;
+        ++_stats.intervals;
+    }
+
+    TrickleConfig _cfg;
+    TickType_t _interval = 0; ///< I
+    TickType_t _start = 0;    ///< when the current interval began
+    TickType_t _t = 0;        ///< decision point, offset into the interval
+    uint8_t _heard = 0;       ///< c: consistent transmissions this interval
+    bool _decided = false;    ///< the decision point of this interval has passed
+    TrickleStats _stats{};
+};
+
+#endif // TRICKLE_TIMER_H
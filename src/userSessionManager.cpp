@@ -16,12 +16,13 @@ UserSessionManager::~UserSessionManager()
         vSemaphoreDelete(_writeMutex);
 }
 
-void UserSessionManager::addOrRefresh(uint32_t userID, uint16_t bleHandle)
+bool UserSessionManager::addOrRefresh(uint32_t userID, uint16_t bleHandle)
 {
     writeLock();
     unsigned long now = millis();
     auto it = _users.find(userID);
-    if (it != _users.end())
+    bool added = it == _users.end();
+    if (!added)
     {
         Serial.printf("Welcome back %u\n", userID);
         it->second.bleConnHandle = bleHandle;
@@ -41,6 +42,7 @@ void UserSessionManager::addOrRefresh(uint32_t userID, uint16_t bleHandle)
     {
         _mqttManager->publishUserAdded(userID);
     }
+    return added;
 }
 
 void UserSessionManager::remove(uint32_t userID)
@@ -58,9 +58,9 @@ class UserSessionManager
 public:
     UserSessionManager(MQTTManager *mqttManager);
     ~UserSessionManager();
-    // Register or refresh a user's session on BLE connect/auth
+    // Register or refresh a user's session on BLE connect/auth; true if the user is new
     // Could block on mutex!! - need to handle this
-    void addOrRefresh(uint32_t userID, uint16_t bleHandle);
+    bool addOrRefresh(uint32_t userID, uint16_t bleHandle);
 
     // Remove a user completely (explicit disconnect command)
     // Could block on mutex!! - need to handle this
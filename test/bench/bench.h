@@ -0,0 +1,28 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdint>
+
+/// wall-clock nanoseconds per call of f, averaged over iters calls
+template <typename F>
+double nsPerOp(uint32_t iters, F f)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iters; ++i)
+        f(i);
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+}
+
+/// keeps the optimiser from discarding a result
+template <typename T>
+inline void keep(const T &v)
+{
+    asm volatile("" : : "g"(&v) : "memory");
+}
+
+int routeTableBench(int argc, char **argv);
+int cryptoBench(int argc, char **argv);
+
+#endif // BENCH_H
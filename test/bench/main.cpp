@@ -0,0 +1,46 @@
+/*
+ * Host-side microbenchmarks.
+ *
+ *   pio run -e bench
+ *   .pio/build/bench/program routetable
+ *   .pio/build/bench/program crypto
+ *
+ * Each benchmark prints one row per configuration so a change can be
+ * compared by running it before and after.
+ */
+#include <cstdio>
+#include <cstring>
+
+#include "bench.h"
+
+struct Bench
+{
+    const char *name;
+    int (*run)(int argc, char **argv);
+};
+
+static const Bench benches[] = {
+    {"routetable", routeTableBench},
+    {"crypto", cryptoBench},
+};
+
+int main(int argc, char **argv)
+{
+    bool ran = false;
+    for (const Bench &b : benches)
+    {
+        if (argc > 1 && strcmp(argv[1], b.name) != 0)
+            continue;
+        b.run(argc - 1, argv + 1);
+        ran = true;
+    }
+    if (!ran)
+    {
+        fprintf(stderr, "usage: %s [", argv[0]);
+        for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); ++i)
+            fprintf(stderr, "%s%s", i ? " | " : "", benches[i].name);
+        fprintf(stderr, "]\n");
+        return 1;
+    }
+    return 0;
+}
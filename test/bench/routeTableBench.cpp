@@ -0,0 +1,87 @@
+/*
+ * RouteTable against the std::map it replaced: lookup of present routes and
+ * invalidation of every route through one neighbour (AODVRouter::invalidateRoute).
+ */
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "routeTable.h"
+
+static const uint32_t NEIGHBOURS = 8; // next hops the routes are spread over
+static const uint32_t LOOKUPS = 1000000;
+static const uint32_t INVALIDATIONS = 20000;
+
+template <uint16_t CAP>
+static void run(size_t routes, std::mt19937 &rng)
+{
+    std::vector<uint32_t> dests(routes);
+    for (auto &d : dests)
+        d = rng() | 1u; // node IDs are random 32-bit MAC fragments
+    auto hopFor = [](size_t i)
+    { return 0x1000u + (uint32_t)(i % NEIGHBOURS); };
+
+    std::map<uint32_t, RouteEntry> map;
+    RouteTable<CAP> table;
+    for (size_t i = 0; i < routes; ++i)
+    {
+        RouteEntry re{hopFor(i), 2, 0, 0, 0};
+        map[dests[i]] = re;
+        table.insert(dests[i], re);
+    }
+
+    std::vector<uint32_t> probe(4096);
+    for (auto &p : probe)
+        p = dests[rng() % routes];
+
+    double mapLookup = nsPerOp(LOOKUPS, [&](uint32_t i)
+                               { auto it = map.find(probe[i & 4095]); keep(it->second.hopcount); });
+    double tableLookup = nsPerOp(LOOKUPS, [&](uint32_t i)
+                                 { keep(table.find(probe[i & 4095])->hopcount); });
+
+    /* drop all routes through one neighbour, then put them back so every
+       iteration sees the same table; the re-insert is timed for both     */
+    std::vector<uint32_t> removed;
+    removed.reserve(routes);
+    double mapInval = nsPerOp(INVALIDATIONS, [&](uint32_t i)
+                              {
+        uint32_t broken = hopFor(i);
+        removed.clear();
+        for (auto it = map.begin(); it != map.end();)
+        {
+            if (it->second.nextHop == broken)
+            {
+                removed.push_back(it->first);
+                it = map.erase(it);
+            }
+            else
+                ++it;
+        }
+        for (uint32_t d : removed)
+            map[d] = RouteEntry{broken, 2, 0, 0, 0}; });
+    double tableInval = nsPerOp(INVALIDATIONS, [&](uint32_t i)
+                                {
+        uint32_t broken = hopFor(i);
+        removed.clear();
+        table.eraseVia(broken, [&](uint32_t d)
+                       { removed.push_back(d); });
+        for (uint32_t d : removed)
+            table.insert(d, RouteEntry{broken, 2, 0, 0, 0}); });
+
+    printf("%7zu %12.1f %12.1f %14.0f %14.0f\n", routes, mapLookup, tableLookup, mapInval, tableInval);
+}
+
+int routeTableBench(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    std::mt19937 rng(1);
+    printf("# lookup: ns per hit, invalidate: ns per broken neighbour incl. re-insert (%u next hops)\n", NEIGHBOURS);
+    printf("%7s %12s %12s %14s %14s\n", "routes", "map.find", "table.find", "map.invalid", "table.invalid");
+    run<64>(50, rng);
+    run<256>(200, rng);
+    run<1024>(1000, rng);
+    return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef SIM_LORA_PHY_H
+#define SIM_LORA_PHY_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Modem settings that decide time-on-air and sensitivity.
+ *
+ * Defaults mirror RadioManager::begin(): 868 MHz, BW125, SF9, CR4/7,
+ * 8 symbol preamble, 10 dBm.
+ */
+struct LoRaParams
+{
+    float freqMHz = 868.0f;
+    float bwKHz = 125.0f;
+    uint8_t sf = 9;
+    uint8_t cr = 7; ///< RadioLib style denominator: 5..8 for 4/5..4/8
+    uint16_t preambleLen = 8;
+    int8_t powerDbm = 10;
+
+    bool sameChannel(const LoRaParams &o) const
+    {
+        return freqMHz == o.freqMHz && bwKHz == o.bwKHz && sf == o.sf;
+    }
+};
+
+/// symbol duration in microseconds
+inline uint32_t loraSymbolUs(const LoRaParams &p)
+{
+    return (uint32_t)((1u << p.sf) * 1000.0f / p.bwKHz);
+}
+
+/// preamble + sync word duration in microseconds
+inline uint32_t loraPreambleUs(const LoRaParams &p)
+{
+    return (uint32_t)((p.preambleLen + 4.25f) * loraSymbolUs(p));
+}
+
+/**
+ * @brief Time-on-air from the Semtech SX126x datasheet formula
+ * (explicit header, CRC on, low data-rate optimisation when Tsym > 16 ms).
+ */
+inline uint32_t loraTimeOnAirUs(const LoRaParams &p, size_t len)
+{
+    const uint32_t tSym = loraSymbolUs(p);
+    const int de = (tSym > 16000) ? 1 : 0;
+    const int crIdx = (p.cr >= 5 && p.cr <= 8) ? p.cr - 4 : 3;
+    const int num = 8 * (int)len - 4 * p.sf + 28 + 16;
+    const int den = 4 * (p.sf - 2 * de);
+    int nPayload = (int)std::ceil((double)num / den) * (crIdx + 4);
+    if (nPayload < 0)
+        nPayload = 0;
+    return loraPreambleUs(p) + (uint32_t)(8 + nPayload) * tSym;
+}
+
+/// demodulator SNR floor per spreading factor (SX126x datasheet)
+inline float loraSnrThresholdDb(uint8_t sf)
+{
+    static const float table[] = {-5.0f, -7.5f, -10.0f, -12.5f, -15.0f, -17.5f, -20.0f}; // SF6..SF12
+    if (sf < 6)
+        sf = 6;
+    if (sf > 12)
+        sf = 12;
+    return table[sf - 6];
+}
+
+/// thermal noise over the channel bandwidth plus receiver noise figure
+inline float loraNoiseFloorDbm(float bwKHz, float noiseFigureDb)
+{
+    return -174.0f + 10.0f * std::log10(bwKHz * 1000.0f) + noiseFigureDb;
+}
+
+#endif // SIM_LORA_PHY_H
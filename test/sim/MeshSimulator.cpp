@@ -0,0 +1,355 @@
+#include "MeshSimulator.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include <Arduino.h>
+#include <mqttmanager.h>
+#include <userSessionManager.h>
+
+MeshSimulator *MeshSimulator::s_active = nullptr;
+
+static const uint32_t FIRST_NODE_ID = 0x1000;
+
+/* Records what the router hands to "the phone" so deliveries and failures
+   can be attributed back to the message that caused them.                */
+class MeshSimulator::Notifier : public IClientNotifier
+{
+public:
+    Notifier(MeshSimulator &sim, size_t index) : _sim(sim), _index(index) {}
+
+    bool notify(const Outgoing &o) override
+    {
+        _sim.onNotify(_index, o);
+        return true;
+    }
+
+    bool setGatewayState(bool) override { return true; }
+
+private:
+    MeshSimulator &_sim;
+    size_t _index;
+};
+
+struct MeshSimulator::Node
+{
+    Node(MeshSimulator &sim, size_t index, uint32_t nodeID)
+        : id(nodeID),
+          mqtt(nullptr, nodeID, nullptr),
+          usm(&mqtt),
+          notifier(sim, index),
+          lora(index, *sim._channel, sim._events),
+          radio(lora, sim._events),
+          router(new AODVRouter(&radio, &mqtt, nodeID, &usm, &notifier))
+    {
+    }
+
+    uint32_t id;
+    MQTTManager mqtt;
+    UserSessionManager usm;
+    Notifier notifier;
+    VirtualLoRaRadio lora;
+    SimRadioManager radio;
+    std::unique_ptr<AODVRouter> router;
+    bool booted = false;
+    bool rxPending = false;
+    bool timerArmed = false; ///< a runTimers event is scheduled for timerAt
+    TickType_t timerAt = 0;
+    uint64_t timerGen = 0; ///< bumped on re-plan so the superseded event does nothing
+};
+
+MeshSimulator::MeshSimulator(const SimConfig &cfg)
+    : _cfg(cfg), _rng(cfg.seed)
+{
+    configASSERT(s_active == nullptr);
+    s_active = this;
+    stubTickSource = &MeshSimulator::simTick;
+    srand(cfg.seed); // esp_random() on the host is rand()
+
+    _topo = Topology::build(cfg.topology, _rng);
+    _channel.reset(new SimChannel(_events, _topo, cfg.channel, _rng));
+
+    _nodes.reserve(_topo.size());
+    for (size_t i = 0; i < _topo.size(); ++i)
+    {
+        uint32_t id = FIRST_NODE_ID + (uint32_t)i;
+        _nodes.emplace_back(new Node(*this, i, id));
+        _nodes[i]->radio.csma = cfg.csma;
+        _nodes[i]->radio.setRxReady([this, i]()
+                                    { drainRx(i); });
+    }
+}
+
+MeshSimulator::~MeshSimulator()
+{
+    _nodes.clear();
+    stubTickSource = nullptr;
+    s_active = nullptr;
+}
+
+TickType_t MeshSimulator::simTick()
+{
+    return s_active ? s_active->_events.now() : 0;
+}
+
+uint32_t MeshSimulator::nodeID(size_t i) const
+{
+    return _nodes[i]->id;
+}
+
+AODVRouter &MeshSimulator::router(size_t i)
+{
+    return *_nodes[i]->router;
+}
+
+void MeshSimulator::bootAll()
+{
+    std::uniform_int_distribution<uint32_t> jitter(0, _cfg.bootJitterMs);
+    for (size_t i = 0; i < _nodes.size(); ++i)
+    {
+        _events.after(jitter(_rng), [this, i]()
+                      { boot(i); });
+    }
+}
+
+void MeshSimulator::boot(size_t i)
+{
+    Node &n = *_nodes[i];
+    if (n.booted)
+        return;
+    n.booted = true;
+    n.radio.begin(_cfg.channel.phy); // radio stays in standby, deaf, until here
+    n.router->setTrickleConfig(_cfg.trickle);
+    n.router->begin(); // UNIT_TEST begin(): one BROADCAST_INFO, no tasks
+    armTimers(i);
+}
+
+/* timerWorkerTask: sleep until the wheel's next deadline, run what is due */
+void MeshSimulator::armTimers(size_t i)
+{
+    Node &n = *_nodes[i];
+    TickType_t at;
+    if (!n.booted || !n.router->nextTimerDeadline(at))
+        return;
+    if (n.timerArmed && (int32_t)(at - n.timerAt) >= 0)
+        return; // already waking up in time
+
+    n.timerArmed = true;
+    n.timerAt = at;
+    uint64_t gen = ++n.timerGen;
+    _events.schedule(at, [this, i, gen]()
+                     {
+        Node &node = *_nodes[i];
+        if (gen != node.timerGen)
+            return;
+        node.timerArmed = false;
+        node.router->runTimers();
+        armTimers(i); });
+}
+
+void MeshSimulator::drainRx(size_t i)
+{
+    Node &n = *_nodes[i];
+    if (n.rxPending)
+        return;
+    n.rxPending = true;
+
+    // routerTask runs as its own task – hand over at the same instant but
+    // outside the channel callback
+    _events.after(0, [this, i]()
+                  {
+        Node &node = *_nodes[i];
+        node.rxPending = false;
+        if (!node.booted)
+        {
+            // radio is off: throw the frames away
+            RadioPacket *p = nullptr;
+            while (node.radio.dequeueRxPacket(&p))
+                FramePool::instance().release(p);
+            return;
+        }
+        RadioPacket *packet = nullptr;
+        while (node.radio.dequeueRxPacket(&packet))
+        {
+            node.router->handlePacket(packet);
+            FramePool::instance().release(packet);
+        }
+        armTimers(i); });
+}
+
+void MeshSimulator::powerOff(size_t i)
+{
+    Node &n = *_nodes[i];
+    n.booted = false; // drainRx throws frames away, armTimers stops
+    ++n.timerGen;     // and the runTimers already scheduled does nothing
+    n.timerArmed = false;
+    n.radio.powerOff();
+}
+
+void MeshSimulator::sendData(size_t from, size_t to)
+{
+    std::uniform_int_distribution<uint32_t> id(1, 0xFFFFFFFEu);
+    uint32_t pid;
+    do
+    {
+        pid = id(_rng);
+    } while (_inFlight.count(pid));
+
+    std::vector<uint8_t> payload(_cfg.payloadLen);
+    for (size_t k = 0; k < payload.size(); ++k)
+        payload[k] = (uint8_t)('a' + (k % 26));
+
+    _inFlight[pid] = {now(), to, false};
+    ++_stats.dataSent;
+    _nodes[from]->router->sendData(_nodes[to]->id, payload.data(), payload.size(), pid, _cfg.dataFlags);
+    armTimers(from);
+}
+
+void MeshSimulator::onNotify(size_t i, const Outgoing &o)
+{
+    switch (o.type)
+    {
+    case BleType::BLE_Node:
+    {
+        auto it = _inFlight.find(o.pktId);
+        if (it == _inFlight.end() || it->second.dest != i || it->second.delivered)
+            return;
+        it->second.delivered = true;
+        ++_stats.dataDelivered;
+        _stats.latenciesMs.push_back(now() - it->second.sentAt);
+        break;
+    }
+    case BleType::BLE_ACK_FAILURE:
+        ++_stats.ackFailures;
+        break;
+    default:
+        break;
+    }
+}
+
+void MeshSimulator::runUntil(uint32_t ms)
+{
+    while (_events.runNext(ms))
+    {
+    }
+}
+
+void MeshSimulator::run()
+{
+    bootAll();
+
+    std::vector<bool> failing(_nodes.size(), false);
+    if (_cfg.failNodes > 0 && _cfg.failNodes + 2 <= _nodes.size())
+    {
+        std::vector<size_t> order(_nodes.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), _rng);
+        uint32_t at = _cfg.failAtMs ? _cfg.failAtMs : _cfg.warmupMs + _cfg.trafficMs / 3;
+        for (size_t k = 0; k < _cfg.failNodes; ++k)
+        {
+            size_t i = order[k];
+            failing[i] = true;
+            _events.schedule(at, [this, i]()
+                             { powerOff(i); });
+        }
+    }
+
+    std::uniform_int_distribution<uint32_t> when(0, _cfg.trafficMs ? _cfg.trafficMs - 1 : 0);
+    std::uniform_int_distribution<size_t> pick(0, _nodes.size() - 1);
+    for (size_t m = 0; m < _cfg.messages && _nodes.size() > 1; ++m)
+    {
+        size_t src, dst;
+        do
+        {
+            src = pick(_rng);
+        } while (failing[src]);
+        do
+        {
+            dst = pick(_rng);
+        } while (dst == src || failing[dst]);
+        _events.schedule(_cfg.warmupMs + when(_rng), [this, src, dst]()
+                         { sendData(src, dst); });
+    }
+
+    GcmStats before = aes_gcm_stats();
+    runUntil(_cfg.warmupMs + _cfg.trafficMs + _cfg.drainMs);
+    GcmStats after = aes_gcm_stats();
+    _stats.cryptoFrames = (after.encrypted - before.encrypted) + (after.decrypted - before.decrypted) +
+                          (after.authFailed - before.authFailed);
+    _stats.cryptoUs = after.busyUs - before.busyUs;
+}
+
+const SimStats &MeshSimulator::stats()
+{
+    const ChannelStats &cs = _channel->stats();
+    _stats.controlFrames = _stats.controlBytes = 0;
+    _stats.dataFrames = _stats.dataBytes = 0;
+    for (size_t t = 0; t < cs.framesByType.size(); ++t)
+    {
+        bool isData = (t == PKT_DATA || t == PKT_USER_MSG || t == PKT_BROADCAST);
+        (isData ? _stats.dataFrames : _stats.controlFrames) += cs.framesByType[t];
+        (isData ? _stats.dataBytes : _stats.controlBytes) += cs.bytesByType[t];
+    }
+    _stats.beaconFrames = cs.framesByType[PKT_BROADCAST_INFO];
+    _stats.beaconAirtimeMs = cs.airtimeMsByType[PKT_BROADCAST_INFO];
+    return _stats;
+}
+
+double SimStats::meanLatencyMs() const
+{
+    if (latenciesMs.empty())
+        return 0.0;
+    return std::accumulate(latenciesMs.begin(), latenciesMs.end(), 0.0) / latenciesMs.size();
+}
+
+uint32_t SimStats::latencyPercentileMs(double p) const
+{
+    if (latenciesMs.empty())
+        return 0;
+    std::vector<uint32_t> sorted = latenciesMs;
+    std::sort(sorted.begin(), sorted.end());
+    size_t idx = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+void MeshSimulator::printReportHeader(FILE *out) const
+{
+    fprintf(out, "%6s %-7s %5s %4s %6s %6s %7s %9s %9s %9s %8s %8s %8s %8s %10s %10s %9s %9s %9s %9s\n",
+            "nodes", "topo", "deg", "diam", "sent", "deliv", "PDR",
+            "lat_mean", "lat_p50", "lat_p95", "ctl_tx", "rreq_tx", "info_tx", "data_tx", "info_air_s",
+            "ctl/deliv", "collided", "captured", "backoffs", "crypto_ms");
+}
+
+void MeshSimulator::printReport(FILE *out)
+{
+    const SimStats &s = stats();
+
+    // with path loss the topology's unit-disk degree is only nominal
+    double degree = _topo.meanDegree();
+    uint64_t backoffs = 0;
+    if (_cfg.channel.model != PropagationModel::UnitDisk && !_nodes.empty())
+    {
+        size_t reach = 0;
+        for (size_t i = 0; i < _nodes.size(); ++i)
+            reach += _channel->reachableCount(i);
+        degree = (double)reach / _nodes.size();
+    }
+    for (const auto &n : _nodes)
+        backoffs += n->radio.backoffs;
+
+    fprintf(out, "%6zu %-7s %5.1f %4zu %6zu %6zu %6.1f%% %9.0f %9u %9u %8llu %8llu %8llu %8llu %10.1f %10.1f %9llu %9llu %9llu %9.1f\n",
+            _nodes.size(), Topology::kindName(_cfg.topology.kind),
+            degree, _topo.diameter(),
+            s.dataSent, s.dataDelivered, 100.0 * s.deliveryRatio(),
+            s.meanLatencyMs(), s.latencyPercentileMs(0.5), s.latencyPercentileMs(0.95),
+            (unsigned long long)s.controlFrames,
+            (unsigned long long)_channel->stats().framesByType[PKT_RREQ],
+            (unsigned long long)s.beaconFrames,
+            (unsigned long long)s.dataFrames,
+            s.beaconAirtimeMs / 1000.0,
+            s.controlPerDelivered(),
+            (unsigned long long)_channel->stats().collided,
+            (unsigned long long)_channel->stats().captured,
+            (unsigned long long)backoffs,
+            s.cryptoUs / 1000.0);
+}
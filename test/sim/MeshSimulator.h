@@ -0,0 +1,141 @@
+#ifndef MESH_SIMULATOR_H
+#define MESH_SIMULATOR_H
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "aodvRouter.h"
+#include "SimChannel.h"
+#include "SimEventQueue.h"
+#include "SimRadioManager.h"
+#include "Topology.h"
+#include "VirtualLoRaRadio.h"
+
+struct SimConfig
+{
+    TopologyConfig topology;
+    ChannelConfig channel;
+    CsmaOptions csma;      ///< copied into every node's radio manager
+    TrickleConfig trickle; ///< BROADCAST_INFO schedule of every router
+    uint32_t seed = 1;
+
+    uint32_t bootJitterMs = 10000; ///< nodes power up spread over this window
+
+    uint32_t warmupMs = 120000;  ///< no application traffic before this
+    uint32_t trafficMs = 600000; ///< window over which messages are spread
+    uint32_t drainMs = 180000;   ///< keep running after the last message
+
+    size_t messages = 200;    ///< unicast DATA messages between random node pairs
+    size_t payloadLen = 32;
+    uint8_t dataFlags = 0;    ///< e.g. REQ_ACK for hop-by-hop ACKs
+
+    size_t failNodes = 0;     ///< nodes that lose power for good; never a traffic endpoint
+    uint32_t failAtMs = 0;    ///< when they do; 0 = a third into the traffic window
+};
+
+struct SimStats
+{
+    size_t dataSent = 0;
+    size_t dataDelivered = 0;
+    size_t ackFailures = 0; ///< BLE_ACK_FAILURE raised at a source
+    std::vector<uint32_t> latenciesMs;
+
+    uint64_t controlFrames = 0;
+    uint64_t controlBytes = 0;
+    uint64_t dataFrames = 0;
+    uint64_t dataBytes = 0;
+
+    uint64_t beaconFrames = 0;    ///< BROADCAST_INFO on air, originated and relayed
+    uint64_t beaconAirtimeMs = 0; ///< summed over every transmitter
+
+    uint64_t cryptoFrames = 0; ///< AES-GCM seals + opens across all nodes
+    uint64_t cryptoUs = 0;     ///< host wall time spent in them
+
+    double deliveryRatio() const { return dataSent ? (double)dataDelivered / dataSent : 0.0; }
+    double meanLatencyMs() const;
+    uint32_t latencyPercentileMs(double p) const;
+    /// control frames put on air per delivered message
+    double controlPerDelivered() const { return dataDelivered ? (double)controlFrames / dataDelivered : 0.0; }
+};
+
+/**
+ * @brief Discrete-event simulation of a whole mesh on the host.
+ *
+ * Every node runs the real AODVRouter against a SimRadioManager driving a
+ * VirtualLoRaRadio; all of them share one SimChannel. The FreeRTOS tick stub is pointed at the
+ * simulated clock, and each router's timer worker is replayed as one event
+ * per node at AODVRouter::nextTimerDeadline(), re-planned whenever the node
+ * has handled something that may have armed an earlier timer.
+ *
+ * Only one simulator may be alive at a time since the tick source is global.
+ */
+class MeshSimulator
+{
+public:
+    explicit MeshSimulator(const SimConfig &cfg);
+    ~MeshSimulator();
+
+    MeshSimulator(const MeshSimulator &) = delete;
+    MeshSimulator &operator=(const MeshSimulator &) = delete;
+
+    /// boot every node, schedule the traffic pattern and run to completion
+    void run();
+
+    /// advance the simulation without scheduling the default traffic
+    void runUntil(uint32_t ms);
+
+    /// unicast DATA from node index `from` to node index `to` at the current time
+    void sendData(size_t from, size_t to);
+
+    /// node i loses power: its radio goes deaf and mute, its router stops
+    void powerOff(size_t i);
+
+    void bootAll();
+
+    uint32_t now() const { return _events.now(); }
+    size_t size() const { return _nodes.size(); }
+    uint32_t nodeID(size_t i) const;
+    AODVRouter &router(size_t i);
+    const Topology &topology() const { return _topo; }
+    const SimChannel &channel() const { return *_channel; }
+
+    /// fold channel counters into the stats and return them
+    const SimStats &stats();
+
+    void printReportHeader(FILE *out) const;
+    void printReport(FILE *out);
+
+private:
+    class Notifier;
+    struct Node;
+
+    void boot(size_t i);
+    void armTimers(size_t i);
+    void drainRx(size_t i);
+    void onNotify(size_t i, const Outgoing &o);
+
+    static TickType_t simTick();
+    static MeshSimulator *s_active;
+
+    SimConfig _cfg;
+    std::mt19937 _rng;
+    SimEventQueue _events;
+    Topology _topo;
+    std::unique_ptr<SimChannel> _channel;
+    std::vector<std::unique_ptr<Node>> _nodes;
+
+    struct InFlight
+    {
+        uint32_t sentAt;
+        size_t dest;
+        bool delivered;
+    };
+    std::unordered_map<uint32_t, InFlight> _inFlight; // packetID -> send record
+
+    SimStats _stats;
+};
+
+#endif // MESH_SIMULATOR_H
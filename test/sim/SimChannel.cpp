@@ -0,0 +1,221 @@
+#include "SimChannel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "packet.h"
+
+// received level between any two unit-disk neighbours; far above every SF floor
+static const float UNIT_DISK_RSSI_DBM = -90.0f;
+// signals this far under the noise floor are not worth tracking as interference
+static const float AUDIBLE_MARGIN_DB = 10.0f;
+
+float ChannelConfig::nominalRangeM() const
+{
+    const float budget = phy.powerDbm - loraNoiseFloorDbm(phy.bwKHz, noiseFigureDb) - loraSnrThresholdDb(phy.sf) - refLossDb;
+    return refDistanceM * std::pow(10.0f, budget / (10.0f * pathLossExponent));
+}
+
+SimChannel::SimChannel(SimEventQueue &events, const Topology &topo,
+                       const ChannelConfig &cfg, std::mt19937 &rng)
+    : _events(events), _topo(topo), _cfg(cfg), _rng(rng),
+      _rx(topo.size()), _params(topo.size(), cfg.phy), _links(topo.size()),
+      _txUntil(topo.size(), 0), _onAir(topo.size()), _incoming(topo.size())
+{
+    buildLinks();
+}
+
+void SimChannel::buildLinks()
+{
+    if (_cfg.model == PropagationModel::UnitDisk)
+    {
+        const float loss = _cfg.phy.powerDbm - UNIT_DISK_RSSI_DBM;
+        for (size_t a = 0; a < _topo.size(); ++a)
+            for (size_t b : _topo.neighbours(a))
+                _links[a].push_back({b, loss});
+        return;
+    }
+
+    /* log-distance with one shadowing draw per pair so links stay symmetric */
+    std::normal_distribution<float> shadow(0.0f, _cfg.shadowingSigmaDb);
+    const float audible = loraNoiseFloorDbm(_cfg.phy.bwKHz, _cfg.noiseFigureDb) - AUDIBLE_MARGIN_DB;
+    for (size_t a = 0; a < _topo.size(); ++a)
+    {
+        for (size_t b = a + 1; b < _topo.size(); ++b)
+        {
+            float d = std::max(_topo.distance(a, b), _cfg.refDistanceM);
+            float loss = _cfg.refLossDb + 10.0f * _cfg.pathLossExponent * std::log10(d / _cfg.refDistanceM);
+            if (_cfg.shadowingSigmaDb > 0.0f)
+                loss += shadow(_rng);
+            if (_cfg.phy.powerDbm - loss < audible)
+                continue;
+            _links[a].push_back({b, loss});
+            _links[b].push_back({a, loss});
+        }
+    }
+}
+
+void SimChannel::setRxHandler(size_t node, RxHandler handler)
+{
+    _rx[node] = std::move(handler);
+}
+
+void SimChannel::setParams(size_t node, const LoRaParams &params)
+{
+    _params[node] = params;
+}
+
+bool SimChannel::isBusy(size_t node) const
+{
+    const uint32_t now = _events.now();
+    if (_txUntil[node] > now)
+        return true;
+    for (const Signal &s : _onAir[node])
+    {
+        if (s.detectable && (!_cfg.cadPreambleOnly || now < s.preambleEnd))
+            return true;
+    }
+    return false;
+}
+
+uint32_t SimChannel::airtimeMs(size_t node, size_t len) const
+{
+    return (loraTimeOnAirUs(_params[node], len) + 999u) / 1000u;
+}
+
+uint32_t SimChannel::transmit(size_t node, const uint8_t *data, size_t len)
+{
+    const uint32_t now = _events.now();
+    const LoRaParams &tx = _params[node];
+    const uint32_t air = airtimeMs(node, len);
+    const uint32_t preambleEnd = now + (loraPreambleUs(tx) + 999u) / 1000u;
+    const uint64_t frameID = _nextFrameID++;
+
+    _txUntil[node] = now + air;
+
+    ++_stats.framesSent;
+    _stats.bytesSent += len;
+    _stats.airtimeMs += air;
+    if (len >= sizeof(BaseHeader))
+    {
+        BaseHeader bh;
+        deserialiseBaseHeader(data, bh);
+        ++_stats.framesByType[bh.packetType];
+        _stats.bytesByType[bh.packetType] += len;
+        _stats.airtimeMsByType[bh.packetType] += air;
+    }
+
+    // switching to TX wrecks anything this node was half-way through hearing
+    for (auto &r : _incoming[node])
+        r.corrupted = true;
+
+    std::normal_distribution<float> fading(0.0f, _cfg.fadingSigmaDb);
+    for (const Link &l : _links[node])
+    {
+        const size_t nb = l.to;
+        const LoRaParams &rxp = _params[nb];
+        if (!rxp.sameChannel(tx))
+            continue; // orthogonal SF / other channel: neither heard nor interfering
+
+        float power = tx.powerDbm - l.lossDb;
+        if (_cfg.fadingSigmaDb > 0.0f)
+            power += fading(_rng);
+        const float snr = power - loraNoiseFloorDbm(rxp.bwKHz, _cfg.noiseFigureDb);
+        const bool decodable = snr >= loraSnrThresholdDb(rxp.sf);
+
+        _onAir[nb].push_back({frameID, preambleEnd, decodable});
+
+        if (_txUntil[nb] > now)
+        {
+            if (decodable)
+                ++_stats.halfDuplexMissed;
+            continue; // deaf while transmitting – no reception record
+        }
+
+        Reception rec{frameID, power, snr, preambleEnd, decodable, !decodable, false};
+        if (_cfg.collisions)
+        {
+            for (auto &r : _incoming[nb])
+            {
+                r.overlapped = rec.overlapped = true;
+                if (r.powerDbm - power < _cfg.captureThresholdDb)
+                    r.corrupted = true;
+
+                // once the demodulator has synced to a payload it ignores
+                // later preambles however strong they are
+                bool locked = r.decodable && now >= r.preambleEnd;
+                if (locked || power - r.powerDbm < _cfg.captureThresholdDb)
+                    rec.corrupted = true;
+            }
+        }
+        _incoming[nb].push_back(rec);
+    }
+
+    auto bytes = std::make_shared<std::vector<uint8_t>>(data, data + len);
+    _events.schedule(now + air, [this, node, frameID, bytes]()
+                     { finish(node, frameID, bytes); });
+    return now + air;
+}
+
+void SimChannel::finish(size_t sender, uint64_t frameID,
+                        std::shared_ptr<std::vector<uint8_t>> bytes)
+{
+    std::uniform_real_distribution<float> coin(0.0f, 1.0f);
+
+    for (const Link &l : _links[sender])
+    {
+        const size_t nb = l.to;
+
+        auto &air = _onAir[nb];
+        air.erase(std::remove_if(air.begin(), air.end(),
+                                 [frameID](const Signal &s)
+                                 { return s.frameID == frameID; }),
+                  air.end());
+
+        auto &in = _incoming[nb];
+        auto it = std::find_if(in.begin(), in.end(),
+                               [frameID](const Reception &r)
+                               { return r.frameID == frameID; });
+        if (it == in.end())
+            continue; // other channel, or was transmitting when the frame started
+
+        Reception r = *it;
+        in.erase(it);
+
+        if (!r.decodable)
+        {
+            ++_stats.belowSensitivity;
+            continue;
+        }
+        if (r.corrupted)
+        {
+            ++_stats.collided;
+            continue;
+        }
+        if (_cfg.lossRate > 0.0f && coin(_rng) < _cfg.lossRate)
+        {
+            ++_stats.lost;
+            continue;
+        }
+
+        ++_stats.delivered;
+        if (r.overlapped)
+            ++_stats.captured;
+        if (_rx[nb])
+            _rx[nb](bytes->data(), bytes->size(), r.powerDbm, r.snrDb);
+    }
+}
+
+size_t SimChannel::reachableCount(size_t node) const
+{
+    const LoRaParams &tx = _params[node];
+    size_t n = 0;
+    for (const Link &l : _links[node])
+    {
+        const LoRaParams &rxp = _params[l.to];
+        float snr = tx.powerDbm - l.lossDb - loraNoiseFloorDbm(rxp.bwKHz, _cfg.noiseFigureDb);
+        if (rxp.sameChannel(tx) && snr >= loraSnrThresholdDb(rxp.sf))
+            ++n;
+    }
+    return n;
+}
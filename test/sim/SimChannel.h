@@ -0,0 +1,151 @@
+#ifndef SIM_CHANNEL_H
+#define SIM_CHANNEL_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "LoRaPhy.h"
+#include "SimEventQueue.h"
+#include "Topology.h"
+
+enum class PropagationModel
+{
+    UnitDisk,   ///< topology neighbours hear each other at one fixed level
+    LogDistance ///< path loss from node positions, per-link shadowing
+};
+
+struct ChannelConfig
+{
+    PropagationModel model = PropagationModel::UnitDisk;
+    LoRaParams phy; ///< modem settings for nodes whose radio never called begin()
+
+    /* log-distance:  PL(d) = PL(d0) + 10 n log10(d / d0) + X(sigma)        */
+    float refDistanceM = 1.0f;
+    float refLossDb = 31.2f; ///< free space at 1 m, 868 MHz
+    float pathLossExponent = 3.5f;
+    float shadowingSigmaDb = 4.0f; ///< drawn once per link, symmetric
+    float fadingSigmaDb = 0.0f;    ///< redrawn for every frame
+    float noiseFigureDb = 6.0f;
+
+    float captureThresholdDb = 6.0f; ///< stronger frame survives an overlap by this margin
+    bool cadPreambleOnly = false;    ///< SX126x CAD only detects preamble chirps
+    float lossRate = 0.0f;           ///< extra independent per-link frame loss, 0…1
+    bool collisions = true;          ///< false: overlapping frames never interfere
+
+    /// distance at which the mean SNR hits the SF demodulation floor
+    float nominalRangeM() const;
+};
+
+struct ChannelStats
+{
+    uint64_t framesSent = 0;
+    uint64_t bytesSent = 0;
+    uint64_t airtimeMs = 0;
+    uint64_t delivered = 0;         ///< per-receiver successful receptions
+    uint64_t collided = 0;          ///< per-receiver receptions lost to overlap
+    uint64_t captured = 0;          ///< overlapped but survived through capture
+    uint64_t belowSensitivity = 0;  ///< heard, but SNR under the SF floor
+    uint64_t halfDuplexMissed = 0;  ///< receiver was transmitting itself
+    uint64_t lost = 0;              ///< dropped by lossRate
+    std::array<uint64_t, 256> framesByType{};
+    std::array<uint64_t, 256> bytesByType{};
+    std::array<uint64_t, 256> airtimeMsByType{};
+};
+
+/**
+ * @brief Shared broadcast medium connecting every simulated node.
+ *
+ * A frame reaches every node with a usable link after its time-on-air.
+ * Each receiver tracks the frames arriving at it: a frame is decoded only
+ * if its SNR clears the SF floor, the receiver was not transmitting, and
+ * every overlapping signal was at least captureThresholdDb weaker (and the
+ * receiver had not already locked onto another payload). The packet type
+ * is read from the clear-text BaseHeader so statistics can split control
+ * from data.
+ */
+class SimChannel
+{
+public:
+    using RxHandler = std::function<void(const uint8_t *data, size_t len, float rssiDbm, float snrDb)>;
+
+    SimChannel(SimEventQueue &events, const Topology &topo,
+               const ChannelConfig &cfg, std::mt19937 &rng);
+
+    void setRxHandler(size_t node, RxHandler handler);
+
+    /// modem settings used by node from now on (called from the radio's begin())
+    void setParams(size_t node, const LoRaParams &params);
+    const LoRaParams &params(size_t node) const { return _params[node]; }
+
+    /**
+     * @brief Channel activity as node's radio sees it.
+     *
+     * True while the node itself transmits or while a detectable frame is
+     * arriving (only its preamble when cadPreambleOnly is set).
+     */
+    bool isBusy(size_t node) const;
+
+    uint32_t airtimeMs(size_t node, size_t len) const;
+
+    /**
+     * @brief Put a frame on air from node.
+     *
+     * @return the simulated time at which the transmission finishes
+     */
+    uint32_t transmit(size_t node, const uint8_t *data, size_t len);
+
+    /// nodes node can reach, i.e. mean SNR above the demodulation floor
+    size_t reachableCount(size_t node) const;
+
+    const ChannelStats &stats() const { return _stats; }
+
+private:
+    struct Link
+    {
+        size_t to;
+        float lossDb;
+    };
+
+    struct Reception
+    {
+        uint64_t frameID;
+        float powerDbm;
+        float snrDb;
+        uint32_t preambleEnd;
+        bool decodable;
+        bool corrupted;
+        bool overlapped;
+    };
+
+    struct Signal
+    {
+        uint64_t frameID;
+        uint32_t preambleEnd;
+        bool detectable;
+    };
+
+    void buildLinks();
+    void finish(size_t sender, uint64_t frameID,
+                std::shared_ptr<std::vector<uint8_t>> bytes);
+
+    SimEventQueue &_events;
+    const Topology &_topo;
+    ChannelConfig _cfg;
+    std::mt19937 &_rng;
+
+    std::vector<RxHandler> _rx;
+    std::vector<LoRaParams> _params;
+    std::vector<std::vector<Link>> _links;         ///< per sender: who can hear it at all
+    std::vector<uint32_t> _txUntil;                ///< per node: end of own TX
+    std::vector<std::vector<Signal>> _onAir;       ///< per node: signals arriving now
+    std::vector<std::vector<Reception>> _incoming; ///< per node: frames being demodulated
+    uint64_t _nextFrameID = 1;
+
+    ChannelStats _stats;
+};
+
+#endif // SIM_CHANNEL_H
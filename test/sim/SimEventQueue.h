@@ -0,0 +1,77 @@
+#ifndef SIM_EVENT_QUEUE_H
+#define SIM_EVENT_QUEUE_H
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+/**
+ * @brief Discrete-event scheduler for the host-side mesh simulator.
+ *
+ * Time is kept in milliseconds, which is also one FreeRTOS tick on the
+ * host stub (pdMS_TO_TICKS(ms) == ms), so the value can be handed to the
+ * router through xTaskGetTickCount() unchanged. Events scheduled for the
+ * same millisecond run in the order they were scheduled.
+ */
+class SimEventQueue
+{
+public:
+    using Callback = std::function<void()>;
+
+    void schedule(uint32_t atMs, Callback cb)
+    {
+        if (atMs < _now)
+            atMs = _now;
+        _q.push(Event{atMs, _seq++, std::move(cb)});
+    }
+
+    void after(uint32_t delayMs, Callback cb) { schedule(_now + delayMs, std::move(cb)); }
+
+    /**
+     * @brief Run the next event if it is due at or before untilMs.
+     *
+     * @return false once nothing is left before untilMs (time is then
+     *         advanced to untilMs)
+     */
+    bool runNext(uint32_t untilMs)
+    {
+        if (_q.empty() || _q.top().t > untilMs)
+        {
+            if (_now < untilMs)
+                _now = untilMs;
+            return false;
+        }
+        /* copy out before pop – the callback may schedule more events */
+        Event ev = _q.top();
+        _q.pop();
+        _now = ev.t;
+        ev.cb();
+        return true;
+    }
+
+    uint32_t now() const { return _now; }
+    size_t pending() const { return _q.size(); }
+
+private:
+    struct Event
+    {
+        uint32_t t;
+        uint64_t seq;
+        Callback cb;
+    };
+
+    struct Later
+    {
+        bool operator()(const Event &a, const Event &b) const
+        {
+            return a.t > b.t || (a.t == b.t && a.seq > b.seq);
+        }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, Later> _q;
+    uint32_t _now = 0;
+    uint64_t _seq = 0;
+};
+
+#endif // SIM_EVENT_QUEUE_H
@@ -0,0 +1,251 @@
+#ifndef SIM_RADIO_MANAGER_H
+#define SIM_RADIO_MANAGER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <FreeRTOS.h>
+#include "IRadioManager.h"
+#include "LoRaPhy.h"
+#include "SimEventQueue.h"
+#include "VirtualLoRaRadio.h"
+#include "csmaBackoff.h"
+
+/**
+ * @brief IRadioManager for one simulated node.
+ *
+ * Event-driven replay of RadioManager on top of a VirtualLoRaRadio: the
+ * DIO1 interrupt either completes a transmission or reads a frame into the
+ * RX queue, and the TX side runs txTask's loop – CCA through
+ * isChannelFree(), CsmaBackoff on busy, the optional PCSMA defer slot,
+ * 2 ms RX→TX guard – with every vTaskDelay turned into a scheduled event.
+ * The simulator drains the RX queue into AODVRouter::handlePacket just like
+ * routerTask.
+ */
+class SimRadioManager : public IRadioManager
+{
+public:
+    static const size_t QUEUE_LEN = 10; // xQueueCreate(10, …) in RadioManager::begin
+    static const uint32_t GUARD_MS = 2; // RX→TX guard in RadioManager::txTask
+
+    SimRadioManager(VirtualLoRaRadio &radio, SimEventQueue &events)
+        : _radio(radio), _events(events)
+    {
+    }
+
+    ~SimRadioManager()
+    {
+        for (RadioPacket *frame : _txQueue)
+            FramePool::instance().release(frame);
+    }
+
+    /// RadioManager::begin with the modem settings in p
+    bool begin(const LoRaParams &p)
+    {
+        int status = _radio.begin(p.freqMHz, p.bwKHz, p.sf, p.cr, 18u, p.powerDbm, p.preambleLen, 1.6F, false);
+        if (status != 0)
+            return false;
+        _radio.setDio1Handler([this]()
+                              { dio1(); });
+        _radio.startReceive();
+        return true;
+    }
+
+    /// called whenever a frame lands in the RX queue
+    void setRxReady(std::function<void()> cb) { _rxReady = std::move(cb); }
+
+    bool enqueueTxPacket(const uint8_t *data, size_t len) override
+    {
+        if (len > sizeof(RadioPacket::data))
+        {
+            ++txDropped;
+            return false;
+        }
+        RadioPacket *frame = FramePool::instance().alloc();
+        if (frame == nullptr)
+        {
+            ++txDropped;
+            return false;
+        }
+        memcpy(frame->data, data, len);
+        frame->len = len;
+        return enqueueTxFrame(frame);
+    }
+
+    bool enqueueTxFrame(RadioPacket *frame) override
+    {
+        if (_off || _txQueue.size() >= QUEUE_LEN)
+        {
+            ++txDropped;
+            FramePool::instance().release(frame);
+            return false;
+        }
+        _txQueue.push_back(frame);
+        if (!_txBusy)
+            nextFrame();
+        return true;
+    }
+
+    bool enqueueRxPacket(const uint8_t *data, size_t len) override
+    {
+        return enqueueRx(data, len, 0, 0);
+    }
+
+    /* Hands out a FramePool frame – the caller releases it, exactly as
+       AODVRouter::routerTask does on target.                          */
+    bool dequeueRxPacket(RadioPacket **packet) override
+    {
+        if (_rxQueue.empty())
+            return false;
+        RadioPacket *p = FramePool::instance().alloc();
+        if (p == nullptr)
+            return false;
+        RxFrame &front = _rxQueue.front();
+        memcpy(p->data, front.bytes.data(), front.bytes.size());
+        p->len = front.bytes.size();
+        p->rssi = front.rssi;
+        p->snr = front.snr;
+        _rxQueue.pop_front();
+        *packet = p;
+        return true;
+    }
+
+    size_t txQueued() const { return _txQueue.size(); }
+
+    /// node failure: drop both queues and go deaf and mute for good
+    void powerOff()
+    {
+        _off = true;
+        for (RadioPacket *frame : _txQueue)
+            FramePool::instance().release(frame);
+        _txQueue.clear();
+        _rxQueue.clear();
+        _radio.powerOff();
+    }
+
+    CsmaOptions csma{};
+
+    uint64_t txDropped = 0;
+    uint64_t rxDropped = 0;
+    uint64_t backoffs = 0; ///< busy CCAs
+    uint64_t defers = 0;   ///< PCSMA defer slots taken
+
+private:
+    /* --- radioTask ------------------------------------------------ */
+    void dio1()
+    {
+        if (_isTransmitting)
+        {
+            _isTransmitting = false;
+            _radio.startReceive();
+            nextFrame(); // txTask was blocked on _txDoneSemaphore
+            return;
+        }
+
+        uint8_t buffer[255];
+        size_t len = _radio.getPacketLength();
+        if (len > 0 && _radio.readData(buffer, len) == 0)
+            enqueueRx(buffer, std::min(len, sizeof(RadioPacket::data)),
+                      (int16_t)std::lround(_radio.getRSSI()), (int8_t)std::lround(_radio.getSNR()));
+        _radio.startReceive();
+    }
+
+    bool enqueueRx(const uint8_t *data, size_t len, int16_t rssi, int8_t snr)
+    {
+        if (len > sizeof(RadioPacket::data) || _rxQueue.size() >= QUEUE_LEN)
+        {
+            ++rxDropped;
+            return false;
+        }
+        _rxQueue.push_back({std::vector<uint8_t>(data, data + len), rssi, snr});
+        if (_rxReady)
+            _rxReady();
+        return true;
+    }
+
+    /* --- txTask --------------------------------------------------- */
+    void nextFrame()
+    {
+        if (_txQueue.empty())
+        {
+            _txBusy = false;
+            return;
+        }
+        _txBusy = true;
+        _backoff.reset(new CsmaBackoff(csma));
+        cca();
+    }
+
+    void cca()
+    {
+        if (_txQueue.empty())
+        {
+            _txBusy = false; // powered off while backing off
+            return;
+        }
+        if (!_radio.isChannelFree())
+        {
+            ++backoffs;
+            _events.after(_backoff->busyWait(), [this]()
+                          { cca(); });
+            return;
+        }
+        if (_backoff->deferTransmit())
+        {
+            ++defers;
+            _events.after(pdMS_TO_TICKS(csma.deferSlotMs), [this]()
+                          { cca(); });
+            return;
+        }
+        _events.after(pdMS_TO_TICKS(GUARD_MS), [this]()
+                      { fire(); });
+    }
+
+    void fire()
+    {
+        if (_txQueue.empty())
+        {
+            _txBusy = false;
+            return;
+        }
+        RadioPacket *frame = _txQueue.front();
+        _txQueue.pop_front();
+
+        _isTransmitting = true;
+        int rc = _radio.startTransmit(frame->data, frame->len);
+        FramePool::instance().release(frame);
+        _radio.setDio1Handler([this]()
+                              { dio1(); });
+        if (rc != 0)
+        {
+            _isTransmitting = false;
+            _radio.startReceive();
+            nextFrame();
+        }
+    }
+
+    VirtualLoRaRadio &_radio;
+    SimEventQueue &_events;
+
+    std::deque<RadioPacket *> _txQueue; // FramePool frames, one reference each
+    struct RxFrame
+    {
+        std::vector<uint8_t> bytes;
+        int16_t rssi; ///< as RadioManager::handleReceiveInterrupt reads them
+        int8_t snr;
+    };
+
+    std::deque<RxFrame> _rxQueue;
+    std::unique_ptr<CsmaBackoff> _backoff;
+    bool _txBusy = false;
+    bool _isTransmitting = false;
+    bool _off = false;
+    std::function<void()> _rxReady;
+};
+
+#endif // SIM_RADIO_MANAGER_H
@@ -0,0 +1,180 @@
+#include "Topology.h"
+
+#include <cmath>
+#include <deque>
+
+static const float PI_F = 3.14159265f;
+static const int MAX_RANDOM_ATTEMPTS = 200;
+
+Topology Topology::build(const TopologyConfig &cfg, std::mt19937 &rng)
+{
+    Topology t;
+    t._rangeM = cfg.rangeM;
+    t._pos.resize(cfg.numNodes);
+    const size_t n = cfg.numNodes;
+
+    switch (cfg.kind)
+    {
+    case TopologyKind::Line:
+        for (size_t i = 0; i < n; ++i)
+            t._pos[i] = {i * cfg.spacingM, 0.0f};
+        break;
+
+    case TopologyKind::Ring:
+    {
+        // radius chosen so neighbouring nodes sit spacingM apart on the chord
+        float radius = (n > 1) ? cfg.spacingM / (2.0f * std::sin(PI_F / n)) : 0.0f;
+        for (size_t i = 0; i < n; ++i)
+        {
+            float a = 2.0f * PI_F * i / n;
+            t._pos[i] = {radius * std::cos(a), radius * std::sin(a)};
+        }
+        break;
+    }
+
+    case TopologyKind::Grid:
+    {
+        size_t cols = (size_t)std::ceil(std::sqrt((double)n));
+        for (size_t i = 0; i < n; ++i)
+            t._pos[i] = {(i % cols) * cfg.spacingM, (i / cols) * cfg.spacingM};
+        break;
+    }
+
+    case TopologyKind::Random:
+    {
+        // pick the square so that the expected degree is meanDegree:
+        // n * pi * r^2 / side^2 ~= meanDegree
+        double side = std::sqrt(n * PI_F * cfg.rangeM * cfg.rangeM / std::max(cfg.meanDegree, 1.0f));
+        std::uniform_real_distribution<float> coord(0.0f, (float)side);
+        for (int attempt = 0; attempt < MAX_RANDOM_ATTEMPTS; ++attempt)
+        {
+            for (size_t i = 0; i < n; ++i)
+                t._pos[i] = {coord(rng), coord(rng)};
+            t.link();
+            if (t.isConnected())
+                return t;
+        }
+        // give up and hand back the last (disconnected) draw – the report
+        // shows the diameter as 0 so the caller can tell
+        return t;
+    }
+    }
+
+    t.link();
+    return t;
+}
+
+void Topology::link()
+{
+    const size_t n = _pos.size();
+    _nbrs.assign(n, {});
+    for (size_t a = 0; a < n; ++a)
+    {
+        for (size_t b = a + 1; b < n; ++b)
+        {
+            if (distance(a, b) <= _rangeM)
+            {
+                _nbrs[a].push_back(b);
+                _nbrs[b].push_back(a);
+            }
+        }
+    }
+}
+
+float Topology::distance(size_t a, size_t b) const
+{
+    float dx = _pos[a].x - _pos[b].x;
+    float dy = _pos[a].y - _pos[b].y;
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+std::vector<size_t> Topology::hopsFrom(size_t src) const
+{
+    std::vector<size_t> hops(_pos.size(), SIZE_MAX);
+    std::deque<size_t> q;
+    hops[src] = 0;
+    q.push_back(src);
+    while (!q.empty())
+    {
+        size_t u = q.front();
+        q.pop_front();
+        for (size_t v : _nbrs[u])
+        {
+            if (hops[v] == SIZE_MAX)
+            {
+                hops[v] = hops[u] + 1;
+                q.push_back(v);
+            }
+        }
+    }
+    return hops;
+}
+
+bool Topology::isConnected() const
+{
+    if (_pos.empty())
+        return true;
+    for (size_t h : hopsFrom(0))
+    {
+        if (h == SIZE_MAX)
+            return false;
+    }
+    return true;
+}
+
+size_t Topology::diameter() const
+{
+    size_t best = 0;
+    for (size_t s = 0; s < _pos.size(); ++s)
+    {
+        for (size_t h : hopsFrom(s))
+        {
+            if (h == SIZE_MAX)
+                return 0;
+            if (h > best)
+                best = h;
+        }
+    }
+    return best;
+}
+
+double Topology::meanDegree() const
+{
+    if (_nbrs.empty())
+        return 0.0;
+    size_t total = 0;
+    for (auto &v : _nbrs)
+        total += v.size();
+    return (double)total / _nbrs.size();
+}
+
+bool Topology::parseKind(const std::string &name, TopologyKind &out)
+{
+    if (name == "line")
+        out = TopologyKind::Line;
+    else if (name == "ring")
+        out = TopologyKind::Ring;
+    else if (name == "grid")
+        out = TopologyKind::Grid;
+    else if (name == "random")
+        out = TopologyKind::Random;
+    else
+        return false;
+    return true;
+}
+
+const char *Topology::kindName(TopologyKind kind)
+{
+    switch (kind)
+    {
+    case TopologyKind::Line:
+        return "line";
+    case TopologyKind::Ring:
+        return "ring";
+    case TopologyKind::Grid:
+        return "grid";
+    case TopologyKind::Random:
+        return "random";
+    }
+    return "?";
+}
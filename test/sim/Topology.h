@@ -0,0 +1,73 @@
+#ifndef SIM_TOPOLOGY_H
+#define SIM_TOPOLOGY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+enum class TopologyKind
+{
+    Line,
+    Ring,
+    Grid,
+    Random
+};
+
+struct TopologyConfig
+{
+    TopologyKind kind = TopologyKind::Grid;
+    size_t numNodes = 50;
+    float spacingM = 800.0f;  ///< pitch for line / ring / grid layouts
+    float rangeM = 1000.0f;   ///< two nodes are neighbours if closer than this
+    float meanDegree = 6.0f;  ///< random layout: target neighbours per node
+};
+
+struct NodePos
+{
+    float x;
+    float y;
+};
+
+/**
+ * @brief Node placement plus the neighbour sets derived from it.
+ *
+ * Links are symmetric and purely range based (unit disk). Anything more
+ * physical – path loss, fading, capture – belongs to the channel model.
+ */
+class Topology
+{
+public:
+    /**
+     * @brief Place cfg.numNodes nodes. Random layouts are re-drawn until
+     * the graph is connected (or the attempt budget runs out).
+     */
+    static Topology build(const TopologyConfig &cfg, std::mt19937 &rng);
+
+    static bool parseKind(const std::string &name, TopologyKind &out);
+    static const char *kindName(TopologyKind kind);
+
+    size_t size() const { return _pos.size(); }
+    const NodePos &pos(size_t i) const { return _pos[i]; }
+    const std::vector<size_t> &neighbours(size_t i) const { return _nbrs[i]; }
+    float distance(size_t a, size_t b) const;
+    float rangeM() const { return _rangeM; }
+
+    bool isConnected() const;
+
+    /// longest shortest path in hops (0 if disconnected)
+    size_t diameter() const;
+
+    double meanDegree() const;
+
+private:
+    void link();
+    std::vector<size_t> hopsFrom(size_t src) const;
+
+    std::vector<NodePos> _pos;
+    std::vector<std::vector<size_t>> _nbrs;
+    float _rangeM = 0.0f;
+};
+
+#endif // SIM_TOPOLOGY_H
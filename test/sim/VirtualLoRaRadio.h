@@ -0,0 +1,185 @@
+#ifndef VIRTUAL_LORA_RADIO_H
+#define VIRTUAL_LORA_RADIO_H
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include <Arduino.h>
+#include "ILoRaRadio.h"
+#include "LoRaPhy.h"
+#include "SimChannel.h"
+#include "SimEventQueue.h"
+
+/**
+ * @brief ILoRaRadio backed by the simulated channel.
+ *
+ * Host-side sibling of SX1262Config. Modem settings from begin() decide
+ * time-on-air and sensitivity; frames are only picked up while the radio
+ * is in RX mode, and getRSSI()/getSNR() report the values the channel
+ * computed for the last one. isChannelFree() behaves like the SX1262
+ * driver: it drops to standby and clears the DIO1 action before the CAD,
+ * so a node is deaf until the next startReceive() and must re-arm DIO1
+ * after startTransmit().
+ */
+class VirtualLoRaRadio : public ILoRaRadio
+{
+public:
+    // RadioLib codes the firmware checks against
+    static const int ERR_NONE = 0;
+    static const int ERR_PACKET_TOO_LONG = -4;
+    static const int ERR_TX_BUSY = -5;
+    static const int ERR_RX_EMPTY = -6;
+
+    enum class Mode
+    {
+        Standby,
+        Rx,
+        Tx
+    };
+
+    VirtualLoRaRadio(size_t index, SimChannel &channel, SimEventQueue &events)
+        : _index(index), _channel(channel), _events(events)
+    {
+        _channel.setRxHandler(_index, [this](const uint8_t *data, size_t len, float rssi, float snr)
+                              { onFrame(data, len, rssi, snr); });
+    }
+
+    int begin(float freq, float bw, uint8_t sf, uint8_t cr, uint8_t syncWord,
+              int8_t power, uint16_t preambleLength, float tcxoVoltage,
+              bool useRegulatorLDO) override
+    {
+        (void)syncWord;
+        (void)tcxoVoltage;
+        (void)useRegulatorLDO;
+
+        LoRaParams p;
+        p.freqMHz = freq;
+        p.bwKHz = bw;
+        p.sf = sf;
+        p.cr = cr;
+        p.preambleLen = preambleLength;
+        p.powerDbm = power;
+        _channel.setParams(_index, p);
+        _mode = Mode::Standby;
+        return ERR_NONE;
+    }
+
+    int startTransmit(const uint8_t *data, size_t len) override
+    {
+        if (len > 255)
+            return ERR_PACKET_TOO_LONG;
+        if (_mode == Mode::Tx || _off)
+            return ERR_TX_BUSY;
+
+        _mode = Mode::Tx;
+        uint32_t done = _channel.transmit(_index, data, len);
+        _events.schedule(done, [this]()
+                         {
+            _mode = Mode::Standby;
+            irq(); });
+        return ERR_NONE;
+    }
+
+    void startReceive() override
+    {
+        if (_mode != Mode::Tx && !_off)
+            _mode = Mode::Rx;
+    }
+
+    /// the node lost power: a frame on air finishes, nothing is heard or sent after
+    void powerOff()
+    {
+        _off = true;
+        if (_mode == Mode::Rx)
+            _mode = Mode::Standby;
+    }
+
+    int readData(String &receivedData, int len) override
+    {
+        size_t n = (len <= 0) ? _last.size() : std::min((size_t)len, _last.size());
+        receivedData.assign(_last.begin(), _last.begin() + n);
+        return _last.empty() ? ERR_RX_EMPTY : ERR_NONE;
+    }
+
+    int readData(uint8_t *buffer, size_t len) override
+    {
+        if (_last.empty())
+            return ERR_RX_EMPTY;
+        memcpy(buffer, _last.data(), std::min(len, _last.size()));
+        return ERR_NONE;
+    }
+
+    void setDio1Callback(void (*callback)()) override
+    {
+        _dio1 = callback;
+        _dio1Armed = true;
+    }
+
+    /// per-instance DIO1 handler; a plain function pointer cannot tell nodes apart
+    void setDio1Handler(std::function<void()> handler)
+    {
+        _dio1Handler = std::move(handler);
+        _dio1Armed = true;
+    }
+
+    float getRSSI() override { return _rssi; }
+
+    float getSNR() override { return _snr; }
+
+    bool isChannelFree() override
+    {
+        if (_mode == Mode::Tx)
+            return false;
+        _mode = Mode::Standby;
+        _dio1Armed = false;
+        return !_channel.isBusy(_index);
+    }
+
+    size_t getPacketLength() override { return _last.size(); }
+
+    Mode mode() const { return _mode; }
+
+    uint64_t missedNotListening = 0; ///< decodable frames that arrived outside RX mode
+
+private:
+    void onFrame(const uint8_t *data, size_t len, float rssi, float snr)
+    {
+        if (_mode != Mode::Rx)
+        {
+            ++missedNotListening;
+            return;
+        }
+        _last.assign(data, data + len);
+        _rssi = rssi;
+        _snr = snr;
+        irq();
+    }
+
+    void irq()
+    {
+        if (!_dio1Armed)
+            return;
+        if (_dio1Handler)
+            _dio1Handler();
+        else if (_dio1)
+            _dio1();
+    }
+
+    size_t _index;
+    SimChannel &_channel;
+    SimEventQueue &_events;
+
+    Mode _mode = Mode::Standby;
+    bool _off = false;
+    void (*_dio1)() = nullptr;
+    std::function<void()> _dio1Handler;
+    bool _dio1Armed = false;
+
+    std::vector<uint8_t> _last;
+    float _rssi = 0.0f;
+    float _snr = 0.0f;
+};
+
+#endif // VIRTUAL_LORA_RADIO_H
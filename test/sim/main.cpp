@@ -0,0 +1,224 @@
+/*
+ * Host-side mesh simulator entry point.
+ *
+ *   pio run -e sim
+ *   .pio/build/sim/program --nodes 50,100,200,500 --topology random --messages 300
+ *
+ * Every node count given to --nodes is simulated separately with the same
+ * seed and printed as one row, so a firmware change can be compared by
+ * running the sweep before and after it.
+ *
+ * BROADCAST_INFO airtime against density (info_tx / info_air_s columns),
+ * the old fixed beacon next to Trickle:
+ *
+ *   for d in 4 8 16; do for b in fixed trickle; do
+ *     .pio/build/sim/program --nodes 100 --topology random --degree $d --beacon $b
+ *   done; done
+ */
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+#include "MeshSimulator.h"
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --nodes N[,N...]     node counts to sweep            (default 50)\n"
+            "  --topology KIND      line | ring | grid | random     (default grid)\n"
+            "  --spacing M          line/ring/grid pitch in metres  (default 800)\n"
+            "  --range M            radio range in metres           (default 1000)\n"
+            "  --degree D           random: mean neighbours         (default 6)\n"
+            "  --messages N         unicast DATA messages           (default 200)\n"
+            "  --payload BYTES      DATA payload length             (default 32)\n"
+            "  --traffic-s S        traffic window in seconds       (default 600)\n"
+            "  --warmup-s S         quiet time before traffic       (default 120)\n"
+            "  --drain-s S          run-on after traffic            (default 180)\n"
+            "  --loss P             per-link frame loss 0..1        (default 0)\n"
+            "  --no-collisions      ideal channel\n"
+            "  --phy                log-distance path loss, SNR floor, capture, CAD;\n"
+            "                       --range becomes the nominal range (default: unit disk)\n"
+            "  --sf SF              spreading factor 7..12              (default 9)\n"
+            "  --shadowing DB       --phy: per-link shadowing sigma     (default 4)\n"
+            "  --fading DB          --phy: per-frame fading sigma       (default 0)\n"
+            "  --backoff SCHEME     legacy | binary | be                (default legacy)\n"
+            "  --pcsma P            enable PCSMA, transmit probability P\n"
+            "  --ack                set REQ_ACK on DATA\n"
+            "  --fail N             N nodes lose power mid-traffic  (default 0)\n"
+            "  --fail-at-s S        when they do      (default a third into traffic)\n"
+            "  --beacon SCHED       trickle | fixed (60 s BROADCAST_INFO) (default trickle)\n"
+            "  --seed N             RNG seed                        (default 1)\n"
+            "  --verbose            keep the router's Serial output\n",
+            argv0);
+}
+
+static std::vector<size_t> parseList(const char *s)
+{
+    std::vector<size_t> out;
+    while (*s)
+    {
+        char *end = nullptr;
+        unsigned long v = strtoul(s, &end, 10);
+        if (end == s)
+            break;
+        out.push_back(v);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return out;
+}
+
+int main(int argc, char **argv)
+{
+    SimConfig cfg;
+    std::vector<size_t> sweep{cfg.topology.numNodes};
+    bool verbose = false;
+    bool rangeGiven = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        auto next = [&]() -> const char *
+        {
+            if (i + 1 >= argc)
+            {
+                usage(argv[0]);
+                exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (a == "--nodes")
+            sweep = parseList(next());
+        else if (a == "--topology")
+        {
+            if (!Topology::parseKind(next(), cfg.topology.kind))
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (a == "--spacing")
+            cfg.topology.spacingM = atof(next());
+        else if (a == "--range")
+        {
+            cfg.topology.rangeM = atof(next());
+            rangeGiven = true;
+        }
+        else if (a == "--degree")
+            cfg.topology.meanDegree = atof(next());
+        else if (a == "--messages")
+            cfg.messages = strtoul(next(), nullptr, 10);
+        else if (a == "--payload")
+            cfg.payloadLen = strtoul(next(), nullptr, 10);
+        else if (a == "--traffic-s")
+            cfg.trafficMs = 1000u * strtoul(next(), nullptr, 10);
+        else if (a == "--warmup-s")
+            cfg.warmupMs = 1000u * strtoul(next(), nullptr, 10);
+        else if (a == "--drain-s")
+            cfg.drainMs = 1000u * strtoul(next(), nullptr, 10);
+        else if (a == "--loss")
+            cfg.channel.lossRate = atof(next());
+        else if (a == "--no-collisions")
+            cfg.channel.collisions = false;
+        else if (a == "--phy")
+        {
+            cfg.channel.model = PropagationModel::LogDistance;
+            cfg.channel.cadPreambleOnly = true;
+        }
+        else if (a == "--sf")
+            cfg.channel.phy.sf = (uint8_t)strtoul(next(), nullptr, 10);
+        else if (a == "--shadowing")
+            cfg.channel.shadowingSigmaDb = atof(next());
+        else if (a == "--fading")
+            cfg.channel.fadingSigmaDb = atof(next());
+        else if (a == "--backoff")
+        {
+            std::string scheme = next();
+            if (scheme == "legacy")
+                cfg.csma.scheme = CsmaOptions::BackoffScheme::Legacy;
+            else if (scheme == "binary")
+                cfg.csma.scheme = CsmaOptions::BackoffScheme::Binary;
+            else if (scheme == "be")
+                cfg.csma.scheme = CsmaOptions::BackoffScheme::BE;
+            else
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (a == "--pcsma")
+        {
+            cfg.csma.pcsmaEnabled = true;
+            cfg.csma.pTransmit = atof(next());
+        }
+        else if (a == "--ack")
+            cfg.dataFlags = REQ_ACK;
+        else if (a == "--fail")
+            cfg.failNodes = strtoul(next(), nullptr, 10);
+        else if (a == "--fail-at-s")
+            cfg.failAtMs = 1000u * strtoul(next(), nullptr, 10);
+        else if (a == "--beacon")
+        {
+            std::string sched = next();
+            if (sched == "fixed")
+            {
+                // one beacon per 60 s interval, never suppressed: the old timer
+                cfg.trickle.imin = pdMS_TO_TICKS(60000);
+                cfg.trickle.doublings = 0;
+                cfg.trickle.k = 0;
+            }
+            else if (sched != "trickle")
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (a == "--seed")
+            cfg.seed = strtoul(next(), nullptr, 10);
+        else if (a == "--verbose")
+            verbose = true;
+        else
+        {
+            usage(argv[0]);
+            return a == "--help" ? 0 : 2;
+        }
+    }
+
+    Serial.quiet = !verbose;
+
+    /* Under --phy the layout still comes from the unit-disk topology, so
+       size it to the distance the link budget actually reaches. A given
+       --range instead scales the path-loss exponent to match.           */
+    if (cfg.channel.model == PropagationModel::LogDistance)
+    {
+        if (rangeGiven)
+        {
+            float budget = cfg.channel.nominalRangeM();
+            cfg.channel.pathLossExponent *= std::log10(budget / cfg.channel.refDistanceM) /
+                                            std::log10(cfg.topology.rangeM / cfg.channel.refDistanceM);
+        }
+        else
+            cfg.topology.rangeM = cfg.channel.nominalRangeM();
+    }
+
+    bool header = false;
+    for (size_t n : sweep)
+    {
+        cfg.topology.numNodes = n;
+        MeshSimulator sim(cfg);
+        sim.run();
+        if (!header)
+        {
+            sim.printReportHeader(stdout);
+            header = true;
+        }
+        sim.printReport(stdout);
+        fflush(stdout);
+    }
+    return 0;
+}
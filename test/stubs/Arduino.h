@@ -5,18 +5,38 @@
 #include <cstdarg>
 #include <cstdlib>
 #include <stdint.h>
+#include <string>
 
+/* rand() only yields 31 bits on glibc – stitch two calls together so the
+   full 32-bit range esp_random() promises is covered.                  */
 extern "C" inline uint32_t esp_random()
 {
-    return (uint32_t)rand();
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
 }
 
+/* Just enough of Arduino's String for ILoRaRadio::readData(String &) */
+class String : public std::string
+{
+public:
+    using std::string::string;
+    String() = default;
+    String(const std::string &s) : std::string(s) {}
+};
+
 class SerialClass
 {
 public:
-    void println(const char *s) { printf("%s\n", s); }
+    bool quiet = false; /* set by host-side runs that spin up many routers */
+
+    void println(const char *s)
+    {
+        if (!quiet)
+            ::printf("%s\n", s);
+    }
     void printf(const char *fmt, ...)
     {
+        if (quiet)
+            return;
         va_list args;
         va_start(args, fmt);
         vprintf(fmt, args);
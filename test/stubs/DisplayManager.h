@@ -0,0 +1,21 @@
+#ifndef DISPLAY_H          // keep the *real* guard so we shadow it
+#define DISPLAY_H
+
+#include <cstdint>
+#include <cstddef>
+
+/* ----------------------------------------------------------------- */
+/*        No OLED on the host – the router only ever calls showMsg   */
+/* ----------------------------------------------------------------- */
+class DisplayManager
+{
+public:
+    void initialise(uint32_t /*nodeId*/) {}
+    void setWifi(bool /*up*/) {}
+    void showMsg(uint32_t /*fromNode*/, const char * /*txt*/, size_t /*len*/) {}
+};
+
+/* aodvRouter.cpp declares this extern – one shared instance is plenty */
+inline DisplayManager displayManager;
+
+#endif   // DISPLAY_H
@@ -27,14 +27,21 @@ typedef uint32_t   TickType_t;
 #define pdFAIL             0
 #define portMAX_DELAY      0xFFFFFFFFu
 #define pdMS_TO_TICKS(ms)  (ms)          /* 1 ms == 1 tick on host */
+#define portTICK_PERIOD_MS 1
 
 /* Used by xTaskNotifyFromISR – no-op in the stub */
 #define eSetBits           0
 #define portYIELD_FROM_ISR(x)  do { (void)(x); } while(0)
 
 /* ───── stub functions – all trivially succeed ─────────────────────── */
+/*  Host-side simulations install their own clock here so the router sees
+    simulated time.  Left unset, every call just advances the tick by one. */
+inline TickType_t (*stubTickSource)(void) = nullptr;
+
 inline TickType_t xTaskGetTickCount(void)
 {
+    if (stubTickSource)
+        return stubTickSource();
     static TickType_t tick{};   /* monotonic counter */
     return ++tick;
 }
@@ -49,6 +56,7 @@ inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
         pointer, but allocating makes ASan / Valgrind happier.)         */
     return std::malloc(1);
 }
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return std::malloc(1); }
 inline int  xSemaphoreTakeRecursive   (SemaphoreHandle_t, TickType_t) { return pdTRUE; }
 inline int  xSemaphoreGiveRecursive   (SemaphoreHandle_t)            { return pdTRUE; }
 inline int  xSemaphoreTake            (SemaphoreHandle_t, TickType_t) { return pdTRUE; }
@@ -64,6 +72,7 @@ inline int xTaskCreate(void (*)(void*), const char*, uint16_t,
                        void*, int, TaskHandle_t*)                       { return pdPASS; }
 inline int xTaskNotifyWait(uint32_t, uint32_t, uint32_t*, TickType_t)   { return pdFALSE; }
 inline int xTaskNotifyFromISR(TaskHandle_t, uint32_t, int, int*)        { return pdFALSE; }
+inline int xTaskNotify(TaskHandle_t, uint32_t, int)                    { return pdPASS; }
 inline void vTaskDelay(TickType_t)                                      {}
 
 /* ---------- timers --------------------------------------------------- */
@@ -77,7 +86,17 @@ inline EventGroupHandle_t xEventGroupCreate()                           { return
 inline EventBits_t xEventGroupSetBits(EventGroupHandle_t, EventBits_t)  { return 0; }
 
 /* ---------- heap ----------------------------------------------------- */
-#define pvPortMalloc  std::malloc
+/* pvPortMalloc counts its calls so tests can check a path stays off the heap */
+inline size_t &stubPortMallocCalls()
+{
+    static size_t n = 0;
+    return n;
+}
+inline void *pvPortMalloc(size_t n)
+{
+    ++stubPortMallocCalls();
+    return std::malloc(n);
+}
 #define vPortFree     std::free
 
 #if !defined(configASSERT)
@@ -2,5 +2,5 @@
 #include <stdint.h>
 
 extern "C" uint32_t esp_random() {
-    return (uint32_t)rand();
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
 }
@@ -2,6 +2,7 @@
 #define GATEWAY_MANAGER_H
 
 #include <cstdint>
+#include <cstddef>
 
 /* Forward declarations so we don’t need the heavy headers */
 class NetworkMessageHandler;
@@ -30,7 +31,8 @@ public:
        cloud gateway – empty body is fine for unit tests.            */
     void uplink(uint32_t /*srcUser*/,
                 uint32_t /*dstUser*/,
-                const char* /*text*/)
+                const uint8_t* /*data*/,
+                size_t /*len*/)
     {}
 
     /* Wi-Fi event hooks – no-ops here */
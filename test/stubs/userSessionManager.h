@@ -28,6 +28,7 @@ static const uint16_t INVALID_HANDLE = 0xFFFF;
 struct OfflineMsg
 {
     BleType                type;
+    uint32_t               packetId;
     uint32_t               to;
     uint32_t               from;
     std::vector<uint8_t>   data;
@@ -49,7 +50,7 @@ public:
     explicit UserSessionManager(MQTTManager* = nullptr) {}
 
     /* APIs that AODVRouter calls ------------------------------------------- */
-    void   addOrRefresh(uint32_t /*userID*/, uint16_t /*bleHandle*/) {}
+    bool   addOrRefresh(uint32_t /*userID*/, uint16_t /*bleHandle*/) { return false; }
     void   remove(uint32_t /*userID*/) {}
     void   handleBleDisconnect(uint16_t /*bleHandle*/) {}
 
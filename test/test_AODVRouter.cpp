@@ -1,10 +1,13 @@
 #include <gtest/gtest.h>
-#include "AODVRouter.h"
+#include "aodvRouter.h"
 #include "mocks/MockRadioManager.h"
 #include "mocks/MockNotifier.h"
+#include "crypto/softAesGcm.h"
 #include <Arduino.h>
 #include <mqttmanager.h>
 #include <userSessionManager.h>
+#include <atomic>
+#include <thread>
 
 // static const uint8_t PKT_BROADCAST_INFO = 0x00;
 // static const uint8_t PKT_BROADCAST = 0x01;
@@ -25,11 +28,11 @@ TEST(AODVRouterTest, BasicSendDataTest)
     AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
 
     uint8_t testData[] = {0xDE, 0xAD, 0xBE, 0xEF};
-    AODVRouter.sendData(200, testData, sizeof(testData));
+    AODVRouter.sendData(200, testData, sizeof(testData), 0);
 
     // check that there is an addition to the dataBuffer
-    ASSERT_FALSE(AODVRouter._dataBuffer.empty()) << "Expected a new val in dataBuffer";
-    std::vector<dataBufferEntry> entry = AODVRouter._dataBuffer[200];
+    ASSERT_FALSE(AODVRouter._pending.empty()) << "Expected a new val in dataBuffer";
+    std::vector<PendingMessage> entry = AODVRouter._pending.peek(PendingKind::Data, 200);
 
     ASSERT_FALSE(entry.empty()) << "Expected at least one entry for dest 200";
     EXPECT_EQ(entry.size(), 1) << "Expected entry for destNodeId: 200 to be 1";
@@ -221,7 +224,7 @@ TEST(AODVRouterTest, ReceiveRREPFlushDataQueue)
     AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
 
     uint8_t testData[] = {0xDE, 0xAD, 0xBE, 0xEF};
-    AODVRouter.sendData(200, testData, sizeof(testData));
+    AODVRouter.sendData(200, testData, sizeof(testData), 0);
 
     ASSERT_FALSE(mockRadio.txPacketsSent.empty()) << "Expected packet to be transmitted";
 
@@ -426,7 +429,7 @@ TEST(AODVRouterTest, BasicReceiveRREQ)
 
     EXPECT_EQ(rrepTxPacket.RREPDestNodeID, myID) << "Incorrect rrepDestNodeID";
     EXPECT_EQ(rrepTxPacket.numHops, 0) << "Incorrect initial numHops";
-    EXPECT_EQ(rrepTxPacket.lifetime, 0) << "Not using default lifetime";
+    EXPECT_EQ(rrepTxPacket.lifetime, ACTIVE_ROUTE_TIMEOUT_TICKS / pdMS_TO_TICKS(1000)) << "Not using default lifetime";
 }
 
 // Ensure that the correct response when I am not the inteded target of a RREQ
@@ -488,7 +491,7 @@ TEST(AODVRouterTest, RespondToRREQ)
     uint32_t myID = 60;
     MockClientNotifier notifier;
     AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
-    AODVRouter.updateRoute(5738, 400, 2);
+    AODVRouter.updateRoute(5738, 400, 2, 7);
     ASSERT_FALSE(AODVRouter._routeTable.empty()) << "Expected a new route to be added";
     EXPECT_EQ(AODVRouter.hasRoute(5738), true) << "Route to 5738 should have be added";
 
@@ -535,7 +538,9 @@ TEST(AODVRouterTest, RespondToRREQ)
 
     EXPECT_EQ(rrepTxPacket.RREPDestNodeID, 5738) << "Incorrect rrepDestNodeID";
     EXPECT_EQ(rrepTxPacket.numHops, 2) << "Incorrect initial numHops";
-    EXPECT_EQ(rrepTxPacket.lifetime, 0) << "Not using default lifetime";
+    EXPECT_EQ(rrepTxPacket.destSeqNum, 7u) << "Intermediate reply should carry the route's sequence number";
+    EXPECT_GT(rrepTxPacket.lifetime, 0) << "Intermediate reply should carry the remaining lifetime";
+    EXPECT_LE(rrepTxPacket.lifetime, ACTIVE_ROUTE_TIMEOUT_TICKS / pdMS_TO_TICKS(1000)) << "Lifetime cannot exceed the default";
 }
 
 // Ensure that when I am the receiving node everything works
@@ -798,7 +803,7 @@ TEST(AODVRouterTest, DiscardSeenPacket)
 
     EXPECT_EQ(dataTxPacket.finalDestID, 5738) << "Incorrect final destination";
 
-    // test receivedPacketIDs
+    // test the seen-packet cache
     EXPECT_EQ(AODVRouter.isDuplicatePacketID(baseHdr.packetID), true) << "ID not added to the set";
     EXPECT_EQ(AODVRouter.isDuplicatePacketID((uint32_t)454445354354), false) << "Not seen ID showing true";
 
@@ -1004,6 +1009,1694 @@ TEST(AODVRouterTest, ImplicitACKBufferTest)
     // EXPECT_EQ(memcmp(abe.packet + newOffset, payloadData, dataLen), 0) << "Payload data mismatch";
 }
 
+TEST(AODVRouterTest, DuplicateCacheAgesOutAndEvicts)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    AODVRouter AODVRouter(&mockRadio, nullptr, 100, nullptr, &notifier);
+
+    static TickType_t now = 0;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    AODVRouter._seenPackets.setWindow(1000);
+    AODVRouter.storePacketID(1);
+    now = 999;
+    EXPECT_TRUE(AODVRouter.isDuplicatePacketID(1)) << "Entry should still be inside the window";
+    now = 1001;
+    EXPECT_FALSE(AODVRouter.isDuplicatePacketID(1)) << "Entry should have aged out";
+    EXPECT_EQ(AODVRouter.getDuplicateCacheStats().expired, 1u);
+
+    // fill past capacity: the oldest ids are overwritten, the newest survive
+    for (uint32_t id = 10; id < 10 + DUP_CACHE_CAPACITY + 5; ++id)
+        AODVRouter.storePacketID(id);
+    DuplicateCacheStats st = AODVRouter.getDuplicateCacheStats();
+    EXPECT_EQ(st.size, DUP_CACHE_CAPACITY) << "Cache must not grow past its capacity";
+    EXPECT_EQ(st.evictions, 5u);
+    EXPECT_FALSE(AODVRouter.isDuplicatePacketID(10)) << "Oldest id should have been evicted";
+    EXPECT_TRUE(AODVRouter.isDuplicatePacketID(10 + DUP_CACHE_CAPACITY + 4)) << "Newest id should be kept";
+    for (uint32_t id = 15; id < 10 + DUP_CACHE_CAPACITY + 5; ++id)
+        EXPECT_TRUE(AODVRouter.isDuplicatePacketID(id)) << "Lost id " << id;
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, OriginSequenceWindow)
+{
+    static TickType_t now = 1000;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+    AODVRouter.updateRoute(5738, 400, 2);
+
+    auto deliver = [&](uint32_t packetID, uint16_t seq)
+    {
+        BaseHeader baseHdr;
+        baseHdr.destNodeID = myID;
+        baseHdr.prevHopID = 499;
+        baseHdr.originNodeID = 102;
+        baseHdr.packetID = packetID;
+        baseHdr.packetType = PKT_DATA;
+        baseHdr.flags = 0;
+        baseHdr.hopCount = 1;
+        baseHdr.reserved = 0;
+        baseHdr.originSeq = seq;
+
+        DATAHeader dataHdr;
+        dataHdr.finalDestID = 5738;
+
+        RadioPacket packet;
+        size_t offset = serialiseBaseHeader(baseHdr, packet.data);
+        packet.len = serialiseDATAHeader(dataHdr, packet.data, offset);
+        AODVRouter.handlePacket(&packet);
+    };
+
+    deliver(1, 10);
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 1u) << "First packet from origin should be forwarded";
+    deliver(2, 10);
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 1u) << "Same origin sequence must be dropped whatever its packetID";
+    deliver(3, 8);
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 2u) << "Older sequence inside the window not yet seen should pass";
+    deliver(4, 8);
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 2u) << "Older sequence already seen should be dropped";
+
+    // forwarding keeps the origin's sequence number
+    BaseHeader fwd;
+    deserialiseBaseHeader(mockRadio.txPacketsSent[1].data.data(), fwd);
+    EXPECT_EQ(fwd.originSeq, 8) << "Forwarder must not restamp the sequence";
+
+    // far behind the window while the origin is still heard: a late copy, and the window stays put
+    now += 10;
+    deliver(5, 10 - 1000);
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 2u);
+    deliver(6, 10);
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 2u) << "A stale copy must not reopen the window";
+    EXPECT_EQ(AODVRouter.getSeqWindowStats().stale, 1u);
+
+    // far behind after the origin fell silent: it rebooted, accept and restart its window
+    now += pdMS_TO_TICKS(SEQ_WINDOW_RESYNC_MS);
+    deliver(7, 10 - 1000);
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 3u);
+    EXPECT_EQ(AODVRouter.getSeqWindowStats().resyncs, 1u);
+    EXPECT_EQ(AODVRouter.getSeqWindowStats().hits, 3u);
+
+    // own originations are stamped with consecutive non-zero numbers
+    uint8_t testData[] = {0xDE, 0xAD};
+    AODVRouter.sendData(5738, testData, sizeof(testData), 0);
+    AODVRouter.sendData(5738, testData, sizeof(testData), 0);
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 5u);
+    BaseHeader a, b;
+    deserialiseBaseHeader(mockRadio.txPacketsSent[3].data.data(), a);
+    deserialiseBaseHeader(mockRadio.txPacketsSent[4].data.data(), b);
+    EXPECT_NE(a.originSeq, 0);
+    EXPECT_EQ((uint16_t)(b.originSeq - a.originSeq), 1) << "Sequence should increase by one per origination";
+
+    // a full table evicts an origin not heard since the CLOCK hand last passed, not an active one
+    SeqWindowTable<4> table;
+    for (uint32_t origin = 1; origin <= 4; ++origin)
+        table.mark(origin, 1, now);
+    table.mark(5, 1, now); // hand clears every bit, then takes origin 1
+    table.mark(2, 2, now);
+    table.mark(6, 1, now); // 2 was heard again: 3 goes
+    EXPECT_EQ(table.size(), 4u);
+    EXPECT_EQ(table.stats().evictions, 2u);
+    EXPECT_FALSE(table.isDuplicate(1, 1, now));
+    EXPECT_TRUE(table.isDuplicate(2, 2, now));
+    EXPECT_FALSE(table.isDuplicate(3, 1, now));
+    EXPECT_TRUE(table.isDuplicate(6, 1, now));
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, RouteLifetimeExpiry)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    static TickType_t now = 0;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    // lazy expiry on lookup
+    now = 1000;
+    AODVRouter.updateRoute(5738, 400, 2, 0, 1000);
+    now = 1999;
+    EXPECT_TRUE(AODVRouter.hasRoute(5738)) << "Route should still be valid";
+    now = 2000;
+    EXPECT_FALSE(AODVRouter.hasRoute(5738)) << "Route should have expired";
+    EXPECT_TRUE(AODVRouter._routeTable.empty()) << "Expired route should be removed on lookup";
+    ASSERT_EQ(AODVRouter._droppedRoutes.size(), 1u) << "Lookup expiry goes through the shared removal path";
+    AODVRouter.flushDroppedRoutes();
+    EXPECT_TRUE(AODVRouter._droppedRoutes.empty());
+
+    // background sweep
+    AODVRouter.updateRoute(600, 600, 1, 0, 1000);
+    AODVRouter.updateRoute(700, 700, 1);
+    now = 3500;
+    AODVRouter.purgeExpiredRoutes();
+    EXPECT_EQ(AODVRouter._routeTable.count(600), 0u) << "Sweep should drop the expired route";
+    EXPECT_EQ(AODVRouter._routeTable.count(700), 1u) << "Sweep should keep the live route";
+
+    // an expired route triggers discovery instead of a doomed transmission
+    AODVRouter.updateRoute(800, 400, 2, 0, 100);
+    now = 4000;
+    uint8_t testData[] = {0xDE, 0xAD};
+    AODVRouter.sendData(800, testData, sizeof(testData), 0);
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 1u);
+    BaseHeader bh;
+    deserialiseBaseHeader(mockRadio.txPacketsSent[0].data.data(), bh);
+    EXPECT_EQ(bh.packetType, PKT_RREQ) << "Expected a fresh RREQ for the expired route";
+
+    // sending over a route refreshes it
+    AODVRouter.updateRoute(900, 400, 2, 0, 1000);
+    now = 4500;
+    AODVRouter.sendData(900, testData, sizeof(testData), 0);
+    now = 5100;
+    EXPECT_TRUE(AODVRouter.hasRoute(900)) << "Route in use should have been refreshed";
+
+    // a shorter-lived stale route is replaced even by a longer path
+    AODVRouter.updateRoute(1000, 400, 1, 0, 100);
+    now = 5300;
+    AODVRouter.updateRoute(1000, 200, 3);
+    RouteEntry re;
+    ASSERT_TRUE(AODVRouter.getRoute(1000, re));
+    EXPECT_EQ(re.nextHop, 200u) << "Stale route should give way to a new one";
+
+    // RREP lifetime is honoured
+    BaseHeader rrepHdr;
+    rrepHdr.destNodeID = myID;
+    rrepHdr.prevHopID = 200;
+    rrepHdr.packetID = 77;
+    rrepHdr.packetType = PKT_RREP;
+    rrepHdr.flags = 0;
+    rrepHdr.hopCount = 0;
+    rrepHdr.reserved = 0;
+    rrepHdr.originNodeID = myID;
+
+    RREPHeader rrep;
+    rrep.RREPDestNodeID = 5656;
+    rrep.lifetime = 10; // seconds
+    rrep.numHops = 1;
+
+    RadioPacket packet;
+    size_t offset = serialiseBaseHeader(rrepHdr, packet.data);
+    packet.len = serialiseRREPHeader(rrep, packet.data, offset);
+    AODVRouter.handlePacket(&packet);
+    ASSERT_TRUE(AODVRouter.getRoute(5656, re));
+    EXPECT_EQ(re.expiresAt, now + pdMS_TO_TICKS(10000)) << "Route should expire with the RREP lifetime";
+
+    // a beacon from the next hop keeps every route through it alive
+    AODVRouter.updateRoute(1100, 400, 3, 0, 1000);
+    AODVRouter.updateRoute(1200, 300, 3, 0, 1000);
+    now = 6000;
+    BaseHeader beacon;
+    beacon.destNodeID = BROADCAST_ADDR;
+    beacon.prevHopID = 400;
+    beacon.originNodeID = 400;
+    beacon.packetID = 78;
+    beacon.packetType = PKT_BROADCAST_INFO;
+    beacon.flags = 0;
+    beacon.hopCount = 0;
+    beacon.reserved = 0;
+    DiffBroadcastInfoHeader dh{0, 0};
+    offset = serialiseBaseHeader(beacon, packet.data);
+    memcpy(packet.data + offset, &dh, sizeof(dh));
+    packet.len = offset + sizeof(dh);
+    AODVRouter.handlePacket(&packet);
+    now = 6500;
+    EXPECT_TRUE(AODVRouter.hasRoute(1100)) << "Beacon from the next hop should refresh its routes";
+    EXPECT_FALSE(AODVRouter.hasRoute(1200)) << "Routes through a silent neighbour should still expire";
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, FresherSequenceNumberWins)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    // fresher information beats a shorter but older path
+    AODVRouter.updateRoute(5738, 400, 2, 10);
+    AODVRouter.updateRoute(5738, 200, 5, 11);
+    RouteEntry re;
+    ASSERT_TRUE(AODVRouter.getRoute(5738, re));
+    EXPECT_EQ(re.nextHop, 200u) << "Higher sequence number should win";
+    EXPECT_EQ(re.destSeqNum, 11u);
+
+    // an older sequence number is ignored however short
+    AODVRouter.updateRoute(5738, 400, 1, 9);
+    ASSERT_TRUE(AODVRouter.getRoute(5738, re));
+    EXPECT_EQ(re.nextHop, 200u) << "Stale sequence number must not replace the route";
+
+    // equal sequence number falls back to hop count
+    AODVRouter.updateRoute(5738, 300, 3, 11);
+    ASSERT_TRUE(AODVRouter.getRoute(5738, re));
+    EXPECT_EQ(re.nextHop, 300u) << "Same sequence number, fewer hops should win";
+
+    // unsequenced shortcut only wins when it is the destination itself
+    AODVRouter.updateRoute(5738, 400, 2);
+    ASSERT_TRUE(AODVRouter.getRoute(5738, re));
+    EXPECT_EQ(re.nextHop, 300u) << "Unsequenced relay path must not override a sequenced route";
+    AODVRouter.updateRoute(5738, 5738, 1);
+    ASSERT_TRUE(AODVRouter.getRoute(5738, re));
+    EXPECT_EQ(re.nextHop, 5738u) << "Hearing the destination directly is always fresh";
+    EXPECT_EQ(re.destSeqNum, 11u) << "Known sequence number should be kept";
+
+    // RREQ carries our own seq and the last known seq for the destination
+    AODVRouter.invalidateRoute(5738, 5738, myID);
+    EXPECT_EQ(AODVRouter.knownSeqNum(5738), 12u) << "Invalidation should bump the known sequence number";
+    uint8_t testData[] = {0xDE, 0xAD};
+    AODVRouter.sendData(5738, testData, sizeof(testData), 0);
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 1u);
+    BaseHeader bh;
+    RREQHeader rreq;
+    size_t off = deserialiseBaseHeader(mockRadio.txPacketsSent[0].data.data(), bh);
+    deserialiseRREQHeader(mockRadio.txPacketsSent[0].data.data(), rreq, off);
+    ASSERT_EQ(bh.packetType, PKT_RREQ);
+    EXPECT_NE(rreq.originSeqNum, 0u);
+    EXPECT_EQ(rreq.destSeqNum, 12u);
+
+    // as destination we answer with at least the requested seq
+    BaseHeader req;
+    req.destNodeID = BROADCAST_ADDR;
+    req.prevHopID = 200;
+    req.packetID = 4242;
+    req.packetType = PKT_RREQ;
+    req.originNodeID = 50;
+    req.flags = 0;
+    req.hopCount = 0;
+    req.reserved = 0;
+    RREQHeader in;
+    in.RREQDestNodeID = myID;
+    in.originSeqNum = 3;
+    in.destSeqNum = 500;
+    RadioPacket packet;
+    size_t len = serialiseBaseHeader(req, packet.data);
+    packet.len = serialiseRREQHeader(in, packet.data, len);
+    mockRadio.txPacketsSent.clear();
+    AODVRouter.handlePacket(&packet);
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 1u);
+    RREPHeader rrep;
+    off = deserialiseBaseHeader(mockRadio.txPacketsSent[0].data.data(), bh);
+    deserialiseRREPHeader(mockRadio.txPacketsSent[0].data.data(), rrep, off);
+    EXPECT_EQ(bh.packetType, PKT_RREP);
+    EXPECT_EQ(rrep.destSeqNum, 500u) << "Destination should catch up to the requested sequence number";
+    ASSERT_TRUE(AODVRouter.getRoute(50, re));
+    EXPECT_EQ(re.destSeqNum, 3u) << "Reverse route should carry the requester's sequence number";
+
+    // a RERR bumps the seq past the wrap to 1, never to 0 (unknown)
+    AODVRouter.recordSeqNum(60, 0xFFFFFFFFu);
+    mockRadio.txPacketsSent.clear();
+    AODVRouter.sendRERR(myID, 50, 60, 99);
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 1u);
+    RERRHeader rerr;
+    off = deserialiseBaseHeader(mockRadio.txPacketsSent[0].data.data(), bh);
+    deserialiseRERRHeader(mockRadio.txPacketsSent[0].data.data(), rerr, off);
+    EXPECT_EQ(rerr.destSeqNum, 1u);
+}
+
+TEST(AODVRouterTest, RouteTableNextHopIndex)
+{
+    RouteTable<8> table;
+    for (uint32_t d = 1; d <= 8; ++d)
+        ASSERT_NE(table.insert(d, RouteEntry{d % 2 ? 100u : 200u, 2, 0, 0, 0}), nullptr);
+    EXPECT_TRUE(table.full());
+    EXPECT_EQ(table.insert(9, RouteEntry{100, 1, 0, 0, 0}), nullptr) << "Insert beyond capacity must fail";
+
+    // moving a route to another next hop re-indexes it
+    table.insert(1, RouteEntry{200, 3, 0, 0, 0});
+    std::set<uint32_t> dropped;
+    size_t n = table.eraseVia(100, [&](uint32_t dest)
+                              { dropped.insert(dest); });
+    EXPECT_EQ(n, 3u);
+    EXPECT_EQ(dropped, (std::set<uint32_t>{3, 5, 7}));
+    EXPECT_EQ(table.size(), 5u);
+    EXPECT_EQ(table.eraseVia(100, [](uint32_t) {}), 0u) << "Next hop bucket should be gone";
+    ASSERT_NE(table.find(1), nullptr);
+    EXPECT_EQ(table.find(1)->nextHop, 200u);
+
+    // freed slots are reused and the index survives erase/insert churn
+    table.erase(2);
+    table.insert(42, RouteEntry{300, 1, 0, 0, 0});
+    table.insert(43, RouteEntry{300, 1, 0, 0, 0});
+    EXPECT_EQ(table.eraseVia(200, [](uint32_t) {}), 4u);
+    EXPECT_EQ(table.eraseVia(300, [](uint32_t) {}), 2u);
+    EXPECT_TRUE(table.empty());
+
+    // the router drops routes through a broken neighbour via the index
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    AODVRouter AODVRouter(&mockRadio, nullptr, 100, nullptr, &notifier);
+    AODVRouter.updateRoute(400, 400, 1);
+    AODVRouter.updateRoute(500, 400, 2);
+    AODVRouter.updateRoute(600, 700, 2);
+    AODVRouter.invalidateRoute(400, 999, 100);
+    EXPECT_FALSE(AODVRouter.hasRoute(400));
+    EXPECT_FALSE(AODVRouter.hasRoute(500));
+    EXPECT_TRUE(AODVRouter.hasRoute(600));
+
+    // a full table makes room by evicting the route closest to expiry
+    for (uint32_t d = 1000; d < 1000 + ROUTE_TABLE_CAPACITY + 1; ++d)
+        AODVRouter.updateRoute(d, 700, 2);
+    EXPECT_EQ(AODVRouter._routeTable.size(), (size_t)ROUTE_TABLE_CAPACITY);
+    EXPECT_TRUE(AODVRouter.hasRoute(1000 + ROUTE_TABLE_CAPACITY)) << "Newest route must be stored";
+    EXPECT_EQ(AODVRouter._droppedRoutes.size(), 2u) << "Evictions are published like expiries";
+}
+
+TEST(AODVRouterTest, ExpandingRingDiscovery)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    static TickType_t now = 0;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    auto lastTtl = [&]()
+    {
+        BaseHeader bh;
+        RREQHeader rreq;
+        const uint8_t *frame = mockRadio.txPacketsSent.back().data.data();
+        size_t off = deserialiseBaseHeader(frame, bh);
+        deserialiseRREQHeader(frame, rreq, off);
+        EXPECT_EQ(bh.packetType, PKT_RREQ);
+        return rreq.ttl;
+    };
+
+    // nothing known about the destination: one network-wide RREQ
+    uint8_t testData[] = {0xDE, 0xAD};
+    AODVRouter.sendData(5738, testData, sizeof(testData), 4242);
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 1u);
+    EXPECT_EQ(lastTtl(), NET_DIAMETER) << "No known distance: a small ring would find nothing";
+
+    // a ring waits out its traversal time; the network-wide search holds the data longer
+    EXPECT_GE(NODE_TRAVERSAL_TICKS, pdMS_TO_TICKS(loraAirtimeMs(RREQ_FRAME_LEN))) << "A hop is at least one RREQ on air";
+    EXPECT_EQ(AODVRouter.discoveryTimeout(RouteDiscovery{RREQ_TTL_THRESHOLD, 0, 0, false}),
+              AODVRouter.ringTraversalTicks(RREQ_TTL_THRESHOLD));
+    TickType_t timeout = AODVRouter.discoveryTimeout(RouteDiscovery{NET_DIAMETER, 0, 0, false});
+    EXPECT_EQ(timeout, DISCOVERY_HOLD_TICKS);
+
+    // more messages for it wait for the flood already on air, then may start another
+    AODVRouter.sendData(5738, testData, sizeof(testData), 4243);
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 1u) << "Still within the first flood's traversal time";
+    EXPECT_EQ(AODVRouter._pending.count(PendingKind::Data, 5738), 2u);
+    now = AODVRouter.ringTraversalTicks(NET_DIAMETER);
+    AODVRouter.sendData(5738, testData, sizeof(testData), 4244);
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 2u);
+    EXPECT_EQ(lastTtl(), NET_DIAMETER);
+    timeout += now;
+    now = timeout - 1;
+    AODVRouter.checkRouteDiscoveries();
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 2u);
+
+    // the network-wide attempt is not retried: give-up fails the buffered messages back to the phone
+    now = timeout;
+    AODVRouter.checkRouteDiscoveries();
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 2u) << "No flood from the discovery timer";
+    EXPECT_TRUE(AODVRouter._discoveries.empty());
+    EXPECT_EQ(AODVRouter._pending.count(PendingKind::Data, 5738), 0u) << "Buffered data should be released";
+    ASSERT_EQ(notifier.log.size(), 3u);
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(notifier.log[i].msg.type, BleType::BLE_ACK_FAILURE);
+        EXPECT_EQ(notifier.log[i].msg.pktId, 4242u + i);
+    }
+
+    // a route learned by other means ends the discovery on the next timer run, not at its deadline
+    mockRadio.txPacketsSent.clear();
+    AODVRouter.sendData(5738, testData, sizeof(testData), 4343);
+    AODVRouter.updateRoute(5738, 400, 2, 9);
+    AODVRouter.runTimers();
+    EXPECT_TRUE(AODVRouter._discoveries.empty());
+    BaseHeader bh;
+    deserialiseBaseHeader(mockRadio.txPacketsSent.back().data.data(), bh);
+    EXPECT_EQ(bh.packetType, PKT_DATA);
+    EXPECT_EQ(bh.packetID, 4343u);
+
+    // the next discovery starts just beyond the last known distance, then widens and goes network-wide
+    AODVRouter.invalidateRoute(5738, 5738, myID);
+    AODVRouter.sendData(5738, testData, sizeof(testData), 0);
+    std::vector<uint8_t> ttls{lastTtl()};
+    for (int i = 0; i < 20 && !AODVRouter._discoveries.empty(); ++i)
+    {
+        now = AODVRouter._discoveries[5738].deadline;
+        size_t before = mockRadio.txPacketsSent.size();
+        AODVRouter.checkRouteDiscoveries();
+        if (mockRadio.txPacketsSent.size() > before)
+            ttls.push_back(lastTtl());
+    }
+    EXPECT_EQ(ttls, (std::vector<uint8_t>{2 + RREQ_TTL_INCREMENT, RREQ_TTL_THRESHOLD, NET_DIAMETER}));
+
+    // relays do not forward an RREQ past its ring
+    auto relay = [&](uint8_t hopCount, uint8_t ttl)
+    {
+        BaseHeader req;
+        req.destNodeID = BROADCAST_ADDR;
+        req.prevHopID = 200;
+        req.packetID = 9000 + hopCount;
+        req.packetType = PKT_RREQ;
+        req.originNodeID = 50;
+        req.flags = 0;
+        req.hopCount = hopCount;
+        req.reserved = 0;
+        RREQHeader in;
+        in.RREQDestNodeID = 7777;
+        in.ttl = ttl;
+        RadioPacket packet;
+        size_t len = serialiseBaseHeader(req, packet.data);
+        packet.len = serialiseRREQHeader(in, packet.data, len);
+        mockRadio.txPacketsSent.clear();
+        AODVRouter.handlePacket(&packet);
+        return mockRadio.txPacketsSent.size();
+    };
+    EXPECT_EQ(relay(0, 2), 1u) << "One hop out of two: forward";
+    EXPECT_EQ(relay(1, 2), 0u) << "Second hop of a two-hop ring: stop";
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, CoalesceDiscoveries)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    static TickType_t now = 0;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    auto countType = [&](uint8_t type)
+    {
+        size_t n = 0;
+        for (auto &p : mockRadio.txPacketsSent)
+        {
+            BaseHeader bh;
+            deserialiseBaseHeader(p.data.data(), bh);
+            n += bh.packetType == type;
+        }
+        return n;
+    };
+
+    // five messages to an unknown node: one RREQ, five buffered
+    uint8_t testData[] = {0xDE, 0xAD};
+    for (uint32_t i = 0; i < 5; ++i)
+        AODVRouter.sendData(5738, testData, sizeof(testData), 1000 + i);
+    EXPECT_EQ(countType(PKT_RREQ), 1u) << "Misses during a discovery must not flood again";
+    EXPECT_EQ(AODVRouter._pending.count(PendingKind::Data, 5738), 5u);
+    EXPECT_EQ(AODVRouter.getDiscoveryStats().started, 1u);
+    EXPECT_EQ(AODVRouter.getDiscoveryStats().coalesced, 4u);
+
+    // the RREP releases all of them
+    BaseHeader rrepHdr;
+    rrepHdr.destNodeID = myID;
+    rrepHdr.prevHopID = 400;
+    rrepHdr.originNodeID = myID;
+    rrepHdr.packetID = 77;
+    rrepHdr.packetType = PKT_RREP;
+    rrepHdr.flags = 0;
+    rrepHdr.hopCount = 0;
+    rrepHdr.reserved = 0;
+    RREPHeader rrep;
+    rrep.RREPDestNodeID = 5738;
+    rrep.lifetime = 0;
+    rrep.numHops = 1;
+    rrep.destSeqNum = 4;
+    RadioPacket packet;
+    size_t len = serialiseBaseHeader(rrepHdr, packet.data);
+    packet.len = serialiseRREPHeader(rrep, packet.data, len);
+    mockRadio.txPacketsSent.clear();
+    AODVRouter.handlePacket(&packet);
+    EXPECT_EQ(countType(PKT_DATA), 5u);
+    EXPECT_TRUE(AODVRouter._discoveries.empty());
+
+    // unknown user: one UREQ per traversal time, then failed back to the phone after the hold
+    mockRadio.txPacketsSent.clear();
+    uint8_t msg[] = {'h', 'i'};
+    AODVRouter.sendUserMessage(11, 22, msg, sizeof(msg), 2001);
+    AODVRouter.sendUserMessage(11, 22, msg, sizeof(msg), 2002);
+    EXPECT_EQ(countType(PKT_UREQ), 1u) << "Second miss should join the pending UREQ";
+    now += AODVRouter.ringTraversalTicks(NET_DIAMETER);
+    AODVRouter.sendUserMessage(11, 22, msg, sizeof(msg), 2003);
+    EXPECT_EQ(countType(PKT_UREQ), 2u) << "The first UREQ has come back empty: flood again";
+    EXPECT_EQ(AODVRouter.getDiscoveryStats().retries, 1u);
+    now = AODVRouter._userDiscoveries[22].deadline - 1;
+    AODVRouter.checkRouteDiscoveries();
+    EXPECT_TRUE(notifier.log.empty());
+    now += 1;
+    AODVRouter.checkRouteDiscoveries();
+    EXPECT_EQ(countType(PKT_UREQ), 2u) << "The timer does not flood";
+    EXPECT_TRUE(AODVRouter._userDiscoveries.empty());
+    ASSERT_EQ(notifier.log.size(), 3u);
+    EXPECT_EQ(notifier.log[0].msg.type, BleType::BLE_ACK_FAILURE);
+    EXPECT_EQ(notifier.log[0].msg.to, 11u);
+    EXPECT_EQ(notifier.log[2].msg.pktId, 2003u);
+    EXPECT_EQ(AODVRouter.getDiscoveryStats().failed, 1u);
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, PendingStoreBoundsAndExpiry)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    static TickType_t now = 0;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    // per-destination cap: the oldest messages for 5738 are failed back to the phone
+    uint8_t testData[] = {0xDE, 0xAD};
+    for (uint32_t i = 0; i < PENDING_MAX_PER_DEST + 2; ++i)
+        AODVRouter.sendData(5738, testData, sizeof(testData), 1000 + i);
+    EXPECT_EQ(AODVRouter._pending.count(PendingKind::Data, 5738), (size_t)PENDING_MAX_PER_DEST);
+    ASSERT_EQ(notifier.log.size(), 2u);
+    EXPECT_EQ(notifier.log[0].msg.type, BleType::BLE_ACK_FAILURE);
+    EXPECT_EQ(notifier.log[0].msg.pktId, 1000u);
+    EXPECT_EQ(notifier.log[1].msg.pktId, 1001u);
+    EXPECT_EQ(AODVRouter.getPendingStats().droppedCap, 2u);
+    EXPECT_EQ(AODVRouter.getPendingStats().bytes,
+              PENDING_MAX_PER_DEST * (sizeof(PendingMessage) + sizeof(testData)));
+
+    // a user message parked later expires later
+    uint8_t msg[] = {'h', 'i'};
+    now = pdMS_TO_TICKS(1000);
+    AODVRouter.sendUserMessage(11, 22, msg, sizeof(msg), 2001);
+    ASSERT_TRUE(AODVRouter.hasBufferedUserMessages(22));
+
+    notifier.log.clear();
+    now = pdMS_TO_TICKS(PENDING_TTL_MS);
+    AODVRouter.expirePendingMessages();
+    EXPECT_EQ(notifier.log.size(), (size_t)PENDING_MAX_PER_DEST);
+    EXPECT_TRUE(AODVRouter.hasBufferedUserMessages(22));
+
+    notifier.log.clear();
+    now = pdMS_TO_TICKS(PENDING_TTL_MS + 1000);
+    AODVRouter.expirePendingMessages();
+    ASSERT_EQ(notifier.log.size(), 1u);
+    EXPECT_EQ(notifier.log[0].msg.to, 11u);
+    EXPECT_EQ(notifier.log[0].msg.pktId, 2001u);
+
+    PendingStoreStats st = AODVRouter.getPendingStats();
+    EXPECT_EQ(st.entries, 0u);
+    EXPECT_EQ(st.bytes, 0u);
+    EXPECT_EQ(st.expired, (uint32_t)PENDING_MAX_PER_DEST + 1);
+
+    // byte budget: the globally oldest entry goes first, whatever its destination
+    PendingMessage m{PendingKind::Data, 1, 0, 0, 0, nullptr, 16, 0};
+    PendingStore store(8, 3 * PendingStore::cost(m));
+    std::vector<PendingDropped> dropped;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        m.key = i;
+        m.packetID = i;
+        store.push(m, 0, dropped);
+    }
+    ASSERT_EQ(dropped.size(), 1u);
+    EXPECT_EQ(dropped[0].reason, PendingDrop::Budget);
+    EXPECT_EQ(dropped[0].msg.packetID, 0u);
+    EXPECT_EQ(store.stats().peakBytes, 3 * PendingStore::cost(m));
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, DropBeforeDecrypt)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    auto encryptedData = [&](uint32_t dest, uint32_t packetID, RadioPacket &packet)
+    {
+        BaseHeader bh;
+        bh.destNodeID = dest;
+        bh.prevHopID = 400;
+        bh.originNodeID = 400;
+        bh.packetID = packetID;
+        bh.packetType = PKT_DATA;
+        bh.flags = FLAG_ENCRYPTED;
+        bh.hopCount = 0;
+        bh.reserved = 0;
+        DATAHeader dh{dest};
+        size_t len = serialiseBaseHeader(bh, packet.data);
+        memcpy(packet.data + len, &dh, sizeof(dh));
+        len += sizeof(dh);
+        memset(packet.data + len, 0, TAG_LEN);
+        packet.len = len + TAG_LEN;
+    };
+
+    // unicast for a neighbour: dropped on the header, never decrypted
+    RadioPacket packet;
+    encryptedData(300, 1, packet);
+    AODVRouter.handlePacket(&packet);
+
+    // our own frame forwarded on by the next hop: implicit ACK
+    RadioPacket *frame = FramePool::instance().alloc();
+    frame->len = 3;
+    AODVRouter.storeAckPacket(2, frame, 400);
+    encryptedData(300, 2, packet);
+    AODVRouter.handlePacket(&packet);
+    EXPECT_FALSE(AODVRouter.ackBufferHasPacketID(2));
+
+    // for us: decrypted and dispatched once, the repeat is a duplicate
+    encryptedData(myID, 3, packet);
+    AODVRouter.handlePacket(&packet);
+    encryptedData(myID, 3, packet);
+    AODVRouter.handlePacket(&packet);
+
+    // a header-only drop records nothing: a forged copy addressed elsewhere cannot
+    // mark the real frame for us as already seen
+    encryptedData(300, 4, packet);
+    AODVRouter.handlePacket(&packet);
+    EXPECT_FALSE(AODVRouter.isDuplicatePacketID(4));
+    encryptedData(myID, 4, packet);
+    AODVRouter.handlePacket(&packet);
+
+    RxFilterStats st = AODVRouter.getRxFilterStats();
+    EXPECT_EQ(st.received, 6u);
+    EXPECT_EQ(st.notForMe, 2u);
+    EXPECT_EQ(st.implicitAck, 1u);
+    EXPECT_EQ(st.duplicate, 1u);
+    EXPECT_EQ(st.decrypted, 2u);
+    EXPECT_EQ(st.accepted, 2u);
+    EXPECT_EQ(notifier.log.size(), 2u) << "Only the frames for us reach the client";
+}
+
+TEST(AODVRouterTest, AckTimeoutsRunOffTheTimerWheel)
+{
+    static TickType_t now = 1000;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+    AODVRouter.updateRoute(400, 400, 1);
+
+    const uint8_t payload[] = {1, 2, 3};
+    AODVRouter.sendData(400, payload, sizeof(payload), 77, REQ_ACK);
+    ASSERT_TRUE(AODVRouter.ackBufferHasPacketID(77));
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 1u);
+
+    TickType_t at;
+    ASSERT_TRUE(AODVRouter.nextTimerDeadline(at));
+    EXPECT_LE(at, now + ACK_TIMEOUT_TICKS) << "Worker must wake no later than the ACK deadline";
+
+    // one tick early: nothing due
+    now += ACK_TIMEOUT_TICKS - 1;
+    AODVRouter.runTimers();
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), 1u);
+
+    for (uint8_t attempt = 1; attempt <= MAX_RETRANS; ++attempt)
+    {
+        now += 1;
+        AODVRouter.runTimers();
+        EXPECT_EQ(mockRadio.txPacketsSent.size(), 1u + attempt) << "Retransmit " << (int)attempt;
+        now += ACK_TIMEOUT_TICKS - 1;
+    }
+    EXPECT_TRUE(notifier.log.empty());
+
+    // retries exhausted: dropped, RERR back to the origin (us) and the client told
+    now += 1;
+    AODVRouter.runTimers();
+    EXPECT_FALSE(AODVRouter.ackBufferHasPacketID(77));
+    ASSERT_EQ(notifier.log.size(), 1u);
+    EXPECT_EQ(notifier.log[0].msg.type, BleType::BLE_ACK_FAILURE);
+
+    // an ACK disarms the timer, so nothing fires later
+    AODVRouter.sendData(400, payload, sizeof(payload), 78, REQ_ACK);
+    size_t sent = mockRadio.txPacketsSent.size();
+    AODVRouter.removeFromACKBuffer(78);
+    size_t notified = notifier.log.size();
+    now += 10 * ACK_TIMEOUT_TICKS;
+    AODVRouter.runTimers();
+    EXPECT_EQ(mockRadio.txPacketsSent.size(), sent);
+    EXPECT_EQ(notifier.log.size(), notified);
+
+    TimerWheelStats ts = AODVRouter.getTimerStats();
+    EXPECT_EQ(ts.fired, (uint32_t)MAX_RETRANS + 1);
+    EXPECT_GE(ts.cancelled, 1u);
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, TrickleBroadcastInfo)
+{
+    static TickType_t now = 1000;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    TrickleConfig cfg;
+    cfg.imin = 1000;
+    cfg.doublings = 2;
+    cfg.k = 1;
+    AODVRouter.setTrickleConfig(cfg);
+    AODVRouter.begin(); // one BROADCAST_INFO straight away
+
+    auto beaconsSent = [&]()
+    {
+        size_t n = 0;
+        for (const auto &tx : mockRadio.txPacketsSent)
+        {
+            BaseHeader bh;
+            deserialiseBaseHeader(tx.data.data(), bh);
+            n += bh.packetType == PKT_BROADCAST_INFO && bh.originNodeID == myID;
+        }
+        return n;
+    };
+    auto runUntil = [&](TickType_t until)
+    {
+        TickType_t at;
+        while (AODVRouter.nextTimerDeadline(at) && (int32_t)(at - until) <= 0)
+        {
+            now = at;
+            AODVRouter.runTimers();
+        }
+        now = until;
+    };
+    auto neighbourBeacon = [&](uint32_t neighbour)
+    {
+        BaseHeader bh;
+        bh.destNodeID = BROADCAST_ADDR;
+        bh.prevHopID = neighbour;
+        bh.originNodeID = neighbour;
+        bh.packetID = esp_random();
+        bh.packetType = PKT_BROADCAST_INFO;
+        bh.flags = 0;
+        bh.hopCount = 0;
+        bh.reserved = 0;
+        DiffBroadcastInfoHeader dh{0, 0};
+        RadioPacket packet;
+        packet.len = serialiseBaseHeader(bh, packet.data);
+        memcpy(packet.data + packet.len, &dh, sizeof(dh));
+        packet.len += sizeof(dh);
+        AODVRouter.handlePacket(&packet);
+    };
+    EXPECT_EQ(beaconsSent(), 1u);
+
+    // quiet network: one beacon per interval, intervals 1000, 2000, 4000, 4000 ticks
+    runUntil(1000 + 1000 + 2000 + 4000 + 4000);
+    EXPECT_EQ(beaconsSent(), 5u);
+    TrickleStats ts = AODVRouter.getBeaconStats();
+    EXPECT_EQ(ts.transmitted, 4u);
+    EXPECT_EQ(ts.suppressed, 0u);
+
+    // a known neighbour says the same thing first: our beacon is redundant
+    neighbourBeacon(400); // new neighbour: resets to Imin
+    EXPECT_EQ(AODVRouter.getBeaconStats().resets, 1u);
+    runUntil(now + 1000); // decision point of the Imin interval
+    size_t sent = beaconsSent();
+    runUntil(now + 1000); // into the next, 2000-tick interval
+    neighbourBeacon(400);
+    runUntil(now + 2000);
+    EXPECT_EQ(AODVRouter.getBeaconStats().suppressed, 1u);
+    EXPECT_EQ(beaconsSent(), sent) << "Suppressed beacon must not go out";
+
+    // a local user joins: back to Imin and announced even if neighbours are chatty
+    runUntil(now + 8000);
+    sent = beaconsSent();
+    neighbourBeacon(400);
+    AODVRouter.userSessionsChanged();
+    neighbourBeacon(400);
+    runUntil(now + 1000);
+    EXPECT_EQ(beaconsSent(), sent + 1);
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, FloodHopLimitPerType)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    uint32_t packetID = 0;
+    auto hear = [&](uint8_t type, uint8_t hopCount)
+    {
+        BaseHeader bh{BROADCAST_ADDR, 200, 50, ++packetID, type, 0, hopCount, 0};
+        RadioPacket packet;
+        packet.len = serialiseBaseHeader(bh, packet.data);
+        if (type == PKT_RREQ)
+            packet.len = serialiseRREQHeader(RREQHeader{5738}, packet.data, packet.len);
+        else
+            packet.len = serialisePubKeyReq(PubKeyReq{}, packet.data, packet.len);
+        mockRadio.txPacketsSent.clear();
+        AODVRouter.handlePacket(&packet);
+        return mockRadio.txPacketsSent.size();
+    };
+
+    // each type stops at its own hop limit, counted from the relayed copy
+    EXPECT_EQ(hear(PKT_PUBKEY_REQ, FLOOD_HOPS_PUBKEY_REQ - 2), 1u);
+    EXPECT_EQ(hear(PKT_PUBKEY_REQ, FLOOD_HOPS_PUBKEY_REQ - 1), 0u) << "PUBKEY_REQ at its limit";
+    EXPECT_EQ(hear(PKT_RREQ, FLOOD_HOPS_PUBKEY_REQ - 1), 1u) << "RREQs go further than PUBKEY_REQs";
+
+    FloodStats fs = AODVRouter.getFloodStats();
+    EXPECT_EQ(fs.relayed, 2u);
+    EXPECT_EQ(fs.hopLimited, 1u);
+}
+
+TEST(AODVRouterTest, MprRelaySelection)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    // a BROADCAST_INFO with the origin's neighbour list; returns how many frames we relayed
+    auto hear = [&](uint32_t origin, uint32_t prevHop, uint8_t hopCount, uint32_t packetID,
+                    std::vector<uint32_t> neighbours, uint8_t numMprs)
+    {
+        BaseHeader bh{BROADCAST_ADDR, prevHop, origin, packetID, PKT_BROADCAST_INFO, 0, hopCount, 0};
+        DiffBroadcastInfoHeader dh{0, 0};
+        NeighbourListHeader nh{(uint8_t)neighbours.size(), numMprs};
+        RadioPacket packet;
+        packet.len = serialiseBaseHeader(bh, packet.data);
+        memcpy(packet.data + packet.len, &dh, sizeof(dh));
+        packet.len = serialiseNeighbourListHeader(nh, packet.data, packet.len + sizeof(dh));
+        memcpy(packet.data + packet.len, neighbours.data(), neighbours.size() * sizeof(uint32_t));
+        packet.len += neighbours.size() * sizeof(uint32_t);
+        mockRadio.txPacketsSent.clear();
+        AODVRouter.handlePacket(&packet);
+        return mockRadio.txPacketsSent.size();
+    };
+
+    // 200 picked us, 300 picked someone else, 400 nobody
+    EXPECT_EQ(hear(200, 200, 0, 1, {myID, 201}, 1), 1u) << "We are an MPR of 200";
+    EXPECT_EQ(hear(300, 300, 0, 2, {301, myID}, 1), 0u) << "Not an MPR of 300";
+    EXPECT_EQ(hear(400, 400, 0, 3, {201, 401, 402, myID}, 0), 0u);
+
+    // 301 is only reachable through 300, 401 and 402 through 400; 400 covers 201 too
+    std::vector<uint32_t> oneHop;
+    AODVRouter.selectMprs(oneHop);
+    EXPECT_EQ(oneHop, (std::vector<uint32_t>{200, 300, 400}));
+    EXPECT_EQ(AODVRouter._neighbourhood.mprs(), (std::vector<uint32_t>{300, 400}));
+
+    // 300's beacon again, relayed by 200 which did pick us: sent after all, but only once
+    EXPECT_EQ(hear(300, 200, 1, 2, {301, myID}, 1), 1u);
+    EXPECT_EQ(hear(300, 200, 1, 2, {301, myID}, 1), 0u);
+
+    NeighbourhoodStats ns = AODVRouter.getNeighbourhoodStats();
+    EXPECT_EQ(ns.hellos, 3u);
+    EXPECT_EQ(ns.declined, 2u);
+    EXPECT_EQ(ns.rescued, 1u);
+    EXPECT_EQ(ns.relayed, 2u);
+    EXPECT_EQ(ns.mprs, 2u);
+    EXPECT_EQ(ns.twoHop, 4u);
+
+    // our own beacon lists our MPRs first, then the other neighbours
+    mockRadio.txPacketsSent.clear();
+    AODVRouter.sendBroadcastInfo();
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 1u);
+    const std::vector<uint8_t> &out = mockRadio.txPacketsSent[0].data;
+    BaseHeader bh;
+    size_t offset = deserialiseBaseHeader(out.data(), bh);
+    uint8_t nonce[NONCE_LEN], aad[sizeof(BaseHeader)];
+    buildNonce(bh, nonce);
+    size_t aadLen = buildAad(bh, aad);
+    size_t plainLen = out.size() - offset - TAG_LEN;
+    std::vector<uint8_t> plain(plainLen);
+    ASSERT_TRUE(aes_gcm_decrypt(nonce, NONCE_LEN, aad, aadLen, out.data() + offset, plainLen,
+                                out.data() + offset + plainLen, TAG_LEN, plain.data()));
+    NeighbourListHeader nh;
+    size_t at = deserialiseNeighbourListHeader(plain.data(), nh, sizeof(DiffBroadcastInfoHeader));
+    EXPECT_EQ(nh.numNeighbours, 3);
+    EXPECT_EQ(nh.numMprs, 2);
+    ASSERT_EQ(plainLen, at + 3 * sizeof(uint32_t));
+    std::vector<uint32_t> listed(3);
+    memcpy(listed.data(), plain.data() + at, 3 * sizeof(uint32_t));
+    EXPECT_EQ(listed, (std::vector<uint32_t>{300, 400, 200}));
+}
+
+TEST(AODVRouterTest, EtxRouteSelection)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 778;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    // an RREQ from 50 for 5738 heard from prevHop at the given SNR; returns the metric we forwarded
+    auto hear = [&](uint32_t prevHop, uint8_t hopCount, uint32_t packetID, uint16_t metric, int8_t snr)
+    {
+        BaseHeader bh{BROADCAST_ADDR, prevHop, 50, packetID, PKT_RREQ, 0, hopCount, 0};
+        RREQHeader rreq;
+        rreq.RREQDestNodeID = 5738;
+        rreq.originSeqNum = 7;
+        rreq.metric = metric;
+        RadioPacket packet;
+        packet.len = serialiseBaseHeader(bh, packet.data);
+        packet.len = serialiseRREQHeader(rreq, packet.data, packet.len);
+        packet.rssi = -100;
+        packet.snr = snr;
+        mockRadio.txPacketsSent.clear();
+        AODVRouter.handlePacket(&packet);
+        EXPECT_EQ(mockRadio.txPacketsSent.size(), 1u);
+        RREQHeader fwd;
+        if (!mockRadio.txPacketsSent.empty())
+            deserialiseRREQHeader(mockRadio.txPacketsSent[0].data.data(), fwd, sizeof(BaseHeader));
+        return fwd.metric;
+    };
+
+    // 50 heard directly but 4.5 dB above the SF9 floor: p = 0.56, ETX ~3.2
+    uint16_t weak = LinkEstimator<1>::etxFromSnr(-8 * 16);
+    EXPECT_EQ(weak, 50);
+    EXPECT_EQ(hear(50, 0, 1, 0, -8), weak) << "Forwarded RREQ must carry the path ETX";
+    RouteEntry re;
+    ASSERT_TRUE(AODVRouter.getRoute(50, re));
+    EXPECT_EQ(re.nextHop, 50u);
+    EXPECT_EQ(re.metric, weak);
+
+    // two clean hops through 60 cost less than the one marginal hop
+    EXPECT_EQ(hear(60, 1, 2, ETX_UNIT, 5), 2 * ETX_UNIT);
+    ASSERT_TRUE(AODVRouter.getRoute(50, re));
+    EXPECT_EQ(re.nextHop, 60u) << "Cheaper path of more hops should win";
+    EXPECT_EQ(re.hopcount, 2);
+    EXPECT_EQ(re.metric, 2 * ETX_UNIT);
+
+    // as many hops but costlier: kept off
+    hear(70, 1, 3, 2 * ETX_UNIT, 5);
+    ASSERT_TRUE(AODVRouter.getRoute(50, re));
+    EXPECT_EQ(re.nextHop, 60u);
+
+    LinkQuality lq;
+    ASSERT_TRUE(AODVRouter.getLinkQuality(60, lq));
+    EXPECT_EQ(lq.snrQ4, 5 * 16);
+    EXPECT_EQ(lq.rssiQ4, -100 * 16);
+    EXPECT_EQ(lq.etx, ETX_UNIT);
+    EXPECT_FALSE(AODVRouter.getLinkQuality(5738, lq));
+    EXPECT_EQ(AODVRouter.getLinkStats().tracked, 3u);
+}
+
+TEST(AODVRouterTest, NeighbourTimeoutReroutes)
+{
+    static TickType_t now = 1000;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+    AODVRouter.begin();
+
+    // a beacon straight from neighbour puts it in the neighbour table
+    auto hear = [&](uint32_t neighbour, uint32_t packetID)
+    {
+        BaseHeader bh{BROADCAST_ADDR, neighbour, neighbour, packetID, PKT_BROADCAST_INFO, 0, 0, 0};
+        DiffBroadcastInfoHeader dh{0, 0};
+        RadioPacket packet;
+        packet.len = serialiseBaseHeader(bh, packet.data);
+        memcpy(packet.data + packet.len, &dh, sizeof(dh));
+        packet.len += sizeof(dh);
+        AODVRouter.handlePacket(&packet);
+    };
+    hear(400, 1);
+    hear(300, 2);
+    AODVRouter.updateRoute(900, 400, 2);
+
+    // 400 goes quiet while holding our frame: rerouted after two ACK timeouts, not three retries
+    const uint8_t payload[] = {1, 2, 3};
+    now += 10;
+    AODVRouter.sendData(900, payload, sizeof(payload), 77, REQ_ACK);
+    ASSERT_TRUE(AODVRouter.ackBufferHasPacketID(77));
+    now += ACK_TIMEOUT_TICKS;
+    AODVRouter.runTimers();
+    ASSERT_TRUE(AODVRouter.ackBufferHasPacketID(77)) << "One silent timeout is only a retry";
+    mockRadio.txPacketsSent.clear();
+    now += ACK_TIMEOUT_TICKS;
+    AODVRouter.runTimers();
+
+    EXPECT_FALSE(AODVRouter.hasRoute(900)) << "Routes through the lost neighbour must go at once";
+    EXPECT_FALSE(AODVRouter.hasRoute(400));
+    EXPECT_FALSE(AODVRouter.ackBufferHasPacketID(77));
+    EXPECT_TRUE(notifier.log.empty()) << "The client must not hear of a failure while the frame is rerouted";
+    EXPECT_EQ(AODVRouter._pending.count(PendingKind::Data, 900), 1u) << "Our frame waits on a new discovery";
+    bool rreq = false;
+    for (const auto &tx : mockRadio.txPacketsSent)
+    {
+        BaseHeader bh;
+        deserialiseBaseHeader(tx.data.data(), bh);
+        rreq |= bh.packetType == PKT_RREQ;
+    }
+    EXPECT_TRUE(rreq);
+    LinkQuality lq;
+    EXPECT_FALSE(AODVRouter.getLinkQuality(400, lq));
+
+    // 300 sends nothing more: counted out one beacon period at a time
+    now += 2 * BEACON_MAX_SILENCE_TICKS;
+    AODVRouter.runTimers();
+    ASSERT_TRUE(AODVRouter.getLinkQuality(300, lq));
+    EXPECT_EQ(lq.missed, 2);
+    now += BEACON_MAX_SILENCE_TICKS;
+    AODVRouter.runTimers();
+    EXPECT_FALSE(AODVRouter.getLinkQuality(300, lq));
+    EXPECT_EQ(AODVRouter.getLinkStats().timeouts, 1u);
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, BackupRouteFailover)
+{
+    static TickType_t now = 1000;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    uint32_t nextID = 1;
+    auto hear = [&](uint32_t neighbour)
+    {
+        BaseHeader bh{BROADCAST_ADDR, neighbour, neighbour, nextID++, PKT_BROADCAST_INFO, 0, 0, 0};
+        DiffBroadcastInfoHeader dh{0, 0};
+        RadioPacket packet;
+        packet.len = serialiseBaseHeader(bh, packet.data);
+        memcpy(packet.data + packet.len, &dh, sizeof(dh));
+        packet.len += sizeof(dh);
+        AODVRouter.handlePacket(&packet);
+    };
+    hear(400);
+    hear(300);
+
+    // a costlier answer of the same freshness is kept as a backup; an older or much longer one is not
+    AODVRouter.updateRoute(900, 400, 2, 5);
+    AODVRouter.updateRoute(900, 300, 3, 5);
+    AODVRouter.updateRoute(900, 500, 2, 4);
+    AODVRouter.updateRoute(900, 600, 4, 5);
+    uint8_t n;
+    const RouteEntry *alt = AODVRouter._routeTable.backups(900, n);
+    ASSERT_EQ(n, 1u);
+    EXPECT_EQ(alt[0].nextHop, 300u);
+
+    // a RERR for 900 from 400: straight onto the backup, no rediscovery
+    AODVRouter.invalidateRoute(800, 900, 400);
+    RouteEntry re;
+    ASSERT_TRUE(AODVRouter.getRoute(900, re));
+    EXPECT_EQ(re.nextHop, 300u);
+    EXPECT_EQ(re.hopcount, 3);
+    EXPECT_EQ(AODVRouter.knownSeqNum(900), 5u) << "A route that failed over is not stale";
+    AODVRouter._routeTable.backups(900, n);
+    EXPECT_EQ(n, 0u);
+
+    // a later copy of an RREQ through another neighbour leaves a backup to its origin, once authenticated
+    auto rreq = [&](uint32_t prevHop)
+    {
+        BaseHeader bh{BROADCAST_ADDR, prevHop, 50, 4242, PKT_RREQ, FLAG_ENCRYPTED, 1, 0};
+        RREQHeader rq;
+        rq.RREQDestNodeID = 5738;
+        rq.originSeqNum = 7;
+        rq.metric = ETX_UNIT;
+        RadioPacket packet;
+        packet.len = serialiseBaseHeader(bh, packet.data);
+        packet.len = serialiseRREQHeader(rq, packet.data, packet.len);
+        memset(packet.data + packet.len, 0, TAG_LEN);
+        packet.len += TAG_LEN;
+        AODVRouter.handlePacket(&packet);
+    };
+    rreq(300);
+    rreq(400);
+    rreq(700); // not a neighbour: its header is not trusted
+    ASSERT_TRUE(AODVRouter.getRoute(50, re));
+    EXPECT_EQ(re.nextHop, 300u);
+    alt = AODVRouter._routeTable.backups(50, n);
+    ASSERT_EQ(n, 1u);
+    EXPECT_EQ(alt[0].nextHop, 400u);
+    EXPECT_EQ(alt[0].destSeqNum, 7u);
+
+    // 300 is still heard but never acknowledges: the frame moves to the backup, the client hears nothing
+    const uint8_t payload[] = {1, 2, 3};
+    now += 10;
+    AODVRouter.sendData(50, payload, sizeof(payload), 77, REQ_ACK);
+    ASSERT_TRUE(AODVRouter.ackBufferHasPacketID(77));
+    EXPECT_EQ(AODVRouter.ackBuffer[77].expectedNextHop, 300u);
+    now += 10;
+    hear(300);
+    for (uint8_t t = 0; t <= MAX_RETRANS; ++t)
+    {
+        now += ACK_TIMEOUT_TICKS;
+        AODVRouter.runTimers();
+    }
+    ASSERT_TRUE(AODVRouter.ackBufferHasPacketID(77));
+    EXPECT_EQ(AODVRouter.ackBuffer[77].expectedNextHop, 400u);
+    EXPECT_TRUE(notifier.log.empty());
+    ASSERT_TRUE(AODVRouter.getRoute(50, re));
+    EXPECT_EQ(re.nextHop, 400u);
+
+    RouteBackupStats bs = AODVRouter.getRouteBackupStats();
+    EXPECT_EQ(bs.learned, 2u);
+    EXPECT_EQ(bs.failovers, 2u);
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, LocalRepairBeforeRERR)
+{
+    static TickType_t now = 1000;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+    AODVRouter.updateRoute(5738, 600, 2);
+    AODVRouter.removeItemRoutingTable(5738); // the route broke, 5738 was two hops out
+
+    // an encrypted DATA frame from 400 for 5738, relayed through us; returns its sealed body
+    auto relay = [&](uint32_t packetID)
+    {
+        BaseHeader bh{myID, 400, 400, packetID, PKT_DATA, FLAG_ENCRYPTED, 1, 0, (uint16_t)packetID};
+        DATAHeader dh{5738};
+        uint8_t body[] = {'h', 'e', 'l', 'l', 'o'};
+        const uint8_t tag[TAG_LEN] = {0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8};
+        RadioPacket packet;
+        size_t len = serialiseBaseHeader(bh, packet.data);
+        memcpy(packet.data + len, &dh, sizeof(dh));
+        len += sizeof(dh);
+        memcpy(packet.data + len, body, sizeof(body));
+        len += sizeof(body);
+        memcpy(packet.data + len, tag, TAG_LEN);
+        packet.len = len + TAG_LEN;
+        mockRadio.txPacketsSent.clear();
+        AODVRouter.handlePacket(&packet);
+        return std::vector<uint8_t>(packet.data + sizeof(BaseHeader), packet.data + packet.len);
+    };
+    auto sentTypes = [&]()
+    {
+        std::vector<uint8_t> types;
+        for (const auto &tx : mockRadio.txPacketsSent)
+        {
+            BaseHeader bh;
+            deserialiseBaseHeader(tx.data.data(), bh);
+            types.push_back(bh.packetType);
+        }
+        return types;
+    };
+
+    // no RERR yet: a short RREQ from here, the frame held
+    std::vector<uint8_t> onAir = relay(77);
+    ASSERT_EQ(sentTypes(), std::vector<uint8_t>{PKT_RREQ});
+    BaseHeader rq;
+    deserialiseBaseHeader(mockRadio.txPacketsSent[0].data.data(), rq);
+    EXPECT_EQ(rq.originNodeID, myID);
+    RREQHeader rreq;
+    deserialiseRREQHeader(mockRadio.txPacketsSent[0].data.data(), rreq, sizeof(BaseHeader));
+    EXPECT_EQ(rreq.RREQDestNodeID, 5738u);
+    EXPECT_EQ(rreq.ttl, 2 + LOCAL_REPAIR_ADD_TTL);
+    EXPECT_EQ(AODVRouter._repairFrames.size(), 1u);
+
+    // the RREP comes back: the held frame goes on as received, only its header readdressed
+    BaseHeader rb{myID, 650, myID, 1234, PKT_RREP, 0, 0, 0};
+    RREPHeader rrep{5738, 300, 1};
+    RadioPacket reply;
+    reply.len = serialiseBaseHeader(rb, reply.data);
+    reply.len = serialiseRREPHeader(rrep, reply.data, reply.len);
+    mockRadio.txPacketsSent.clear();
+    AODVRouter.handlePacket(&reply);
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 1u);
+    const std::vector<uint8_t> &out = mockRadio.txPacketsSent[0].data;
+    BaseHeader fwd;
+    deserialiseBaseHeader(out.data(), fwd);
+    EXPECT_EQ(fwd.packetID, 77u);
+    EXPECT_EQ(fwd.destNodeID, 650u);
+    EXPECT_EQ(fwd.prevHopID, myID);
+    EXPECT_EQ(fwd.hopCount, 2);
+    EXPECT_EQ(std::vector<uint8_t>(out.begin() + sizeof(BaseHeader), out.end()), onAir);
+    EXPECT_TRUE(AODVRouter._repairFrames.empty());
+
+    // broken again and nobody answers: after one ring, a RERR to the origin and no wider search
+    AODVRouter.removeItemRoutingTable(5738);
+    relay(78);
+    ASSERT_EQ(sentTypes(), std::vector<uint8_t>{PKT_RREQ});
+    mockRadio.txPacketsSent.clear();
+    now += AODVRouter.discoveryTimeout(RouteDiscovery{2 + LOCAL_REPAIR_ADD_TTL, 0, 0, true});
+    AODVRouter.runTimers();
+    ASSERT_EQ(sentTypes(), std::vector<uint8_t>{PKT_RERR});
+    BaseHeader eb;
+    deserialiseBaseHeader(mockRadio.txPacketsSent[0].data.data(), eb);
+    EXPECT_EQ(eb.destNodeID, 400u);
+    EXPECT_TRUE(AODVRouter._repairFrames.empty());
+    EXPECT_FALSE(AODVRouter._discoveries.count(5738));
+
+    DiscoveryStats ds = AODVRouter.getDiscoveryStats();
+    EXPECT_EQ(ds.repairs, 2u);
+    EXPECT_EQ(ds.repairsFailed, 1u);
+    EXPECT_TRUE(notifier.log.empty());
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, PrecursorRERR)
+{
+    static TickType_t now = 1000;
+    stubTickSource = []() -> TickType_t
+    { return now; };
+
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+
+    uint32_t nextID = 1;
+    auto hear = [&](uint32_t neighbour)
+    {
+        BaseHeader bh{BROADCAST_ADDR, neighbour, neighbour, nextID++, PKT_BROADCAST_INFO, 0, 0, 0};
+        DiffBroadcastInfoHeader dh{0, 0};
+        RadioPacket packet;
+        packet.len = serialiseBaseHeader(bh, packet.data);
+        memcpy(packet.data + packet.len, &dh, sizeof(dh));
+        packet.len += sizeof(dh);
+        AODVRouter.handlePacket(&packet);
+    };
+    // a DATA frame from prevHop for finalDest, relayed through us
+    auto relay = [&](uint32_t prevHop, uint32_t finalDest)
+    {
+        BaseHeader bh{myID, prevHop, 50, nextID++, PKT_DATA, 0, 1, 0};
+        DATAHeader dh{finalDest};
+        RadioPacket packet;
+        packet.len = serialiseBaseHeader(bh, packet.data);
+        memcpy(packet.data + packet.len, &dh, sizeof(dh));
+        packet.len += sizeof(dh);
+        AODVRouter.handlePacket(&packet);
+    };
+    // every RERR sent: its header, and all the destinations it lists
+    auto sentRERRs = [&]()
+    {
+        std::vector<std::pair<BaseHeader, std::set<uint32_t>>> out;
+        for (const auto &tx : mockRadio.txPacketsSent)
+        {
+            BaseHeader bh;
+            size_t at = deserialiseBaseHeader(tx.data.data(), bh);
+            if (bh.packetType != PKT_RERR)
+                continue;
+            RERRHeader rerr;
+            at = deserialiseRERRHeader(tx.data.data(), rerr, at);
+            std::set<uint32_t> dests{rerr.originalDestNodeID};
+            RERRDestListHeader lh{0};
+            if (at < tx.data.size())
+                at = deserialiseRERRDestListHeader(tx.data.data(), lh, at);
+            for (uint8_t i = 0; i < lh.numDests; ++i, at += 8)
+            {
+                uint32_t dest;
+                memcpy(&dest, tx.data.data() + at, 4);
+                dests.insert(dest);
+            }
+            EXPECT_EQ(rerr.originalPacketID, 0u);
+            out.emplace_back(bh, dests);
+        }
+        return out;
+    };
+    hear(400);
+    hear(200);
+    hear(300);
+
+    AODVRouter.updateRoute(900, 400, 2, 5);
+    AODVRouter.updateRoute(901, 400, 3);
+    AODVRouter.updateRoute(950, 300, 2);
+    relay(200, 900);
+    relay(300, 901);
+    relay(300, 901);
+    relay(200, 950);
+    uint8_t n;
+    const uint32_t *pre = AODVRouter._routeTable.precursors(901, n);
+    ASSERT_EQ(n, 1u) << "A precursor is listed once";
+    EXPECT_EQ(pre[0], 300u);
+
+    // 400 is gone: one RERR for everything behind it, to both upstream neighbours that used it
+    mockRadio.txPacketsSent.clear();
+    AODVRouter.neighbourLost(400);
+    auto rerrs = sentRERRs();
+    ASSERT_EQ(rerrs.size(), 1u);
+    EXPECT_EQ(rerrs[0].first.destNodeID, BROADCAST_ADDR);
+    EXPECT_EQ(rerrs[0].first.originNodeID, myID);
+    EXPECT_EQ(rerrs[0].second, (std::set<uint32_t>{400, 900, 901}));
+    EXPECT_FALSE(AODVRouter.hasRoute(900));
+    EXPECT_FALSE(AODVRouter.hasRoute(901));
+    EXPECT_EQ(AODVRouter.knownSeqNum(900), 6u);
+
+    // 300 reports its own break: only what we route through 300 goes, and only 200, which used it, hears
+    AODVRouter.updateRoute(951, 200, 2);
+    RERRHeader in;
+    in.reporterNodeID = 300;
+    in.brokenNodeID = 700;
+    in.originalDestNodeID = 950;
+    in.originalPacketID = 0;
+    in.destSeqNum = 9;
+    BaseHeader eb{myID, 300, 300, nextID++, PKT_RERR, 0, 0, 0};
+    RadioPacket packet;
+    packet.len = serialiseBaseHeader(eb, packet.data);
+    packet.len = serialiseRERRHeader(in, packet.data, packet.len);
+    packet.len = serialiseRERRDestListHeader(RERRDestListHeader{1}, packet.data, packet.len);
+    uint32_t extra[2] = {951, 4};
+    memcpy(packet.data + packet.len, extra, sizeof(extra));
+    packet.len += sizeof(extra);
+    mockRadio.txPacketsSent.clear();
+    AODVRouter.handlePacket(&packet);
+
+    EXPECT_FALSE(AODVRouter.hasRoute(950));
+    EXPECT_TRUE(AODVRouter.hasRoute(951)) << "Not routed through the sender";
+    EXPECT_EQ(AODVRouter.knownSeqNum(950), 9u);
+    rerrs = sentRERRs();
+    ASSERT_EQ(rerrs.size(), 1u);
+    EXPECT_EQ(rerrs[0].first.destNodeID, 200u) << "A lone precursor is told by unicast";
+    EXPECT_EQ(rerrs[0].second, (std::set<uint32_t>{950}));
+
+    RouteErrorStats es = AODVRouter.getRouteErrorStats();
+    EXPECT_EQ(es.sent, 2u);
+    EXPECT_EQ(es.listed, 4u);
+    EXPECT_EQ(es.received, 1u);
+    EXPECT_EQ(es.invalidated, 1u);
+    EXPECT_TRUE(notifier.log.empty());
+
+    stubTickSource = nullptr;
+}
+
+TEST(AODVRouterTest, CryptoBatchMatchesSingleCalls)
+{
+    uint8_t nonces[3][NONCE_LEN] = {{1}, {2}, {3}};
+    uint8_t aad[4] = {9, 8, 7, 6};
+    uint8_t plain[3][24];
+    for (int f = 0; f < 3; ++f)
+        memset(plain[f], 0x10 + f, sizeof(plain[f]));
+
+    uint8_t single[3][24], singleTag[3][TAG_LEN];
+    for (int f = 0; f < 3; ++f)
+        ASSERT_TRUE(aes_gcm_encrypt(nonces[f], NONCE_LEN, aad, sizeof(aad), plain[f], sizeof(plain[f]),
+                                    single[f], singleTag[f], TAG_LEN));
+
+    uint8_t batch[3][24], batchTag[3][TAG_LEN];
+    GcmFrame frames[3];
+    for (int f = 0; f < 3; ++f)
+        frames[f] = {nonces[f], NONCE_LEN, aad, sizeof(aad), plain[f], sizeof(plain[f]), batch[f], batchTag[f], TAG_LEN, false};
+    ASSERT_EQ(aes_gcm_encrypt_batch(frames, 3), 3u);
+    EXPECT_EQ(memcmp(single, batch, sizeof(single)), 0);
+    EXPECT_EQ(memcmp(singleTag, batchTag, sizeof(singleTag)), 0);
+
+    // and back again, with the key re-expanded in between
+    ASSERT_TRUE(aes_gcm_set_key(NWK_KEY));
+    uint8_t back[3][24];
+    for (int f = 0; f < 3; ++f)
+        frames[f] = {nonces[f], NONCE_LEN, aad, sizeof(aad), batch[f], sizeof(batch[f]), back[f], batchTag[f], TAG_LEN, false};
+    ASSERT_EQ(aes_gcm_decrypt_batch(frames, 3), 3u);
+    EXPECT_EQ(memcmp(back, plain, sizeof(plain)), 0);
+}
+
+static std::vector<uint8_t> fromHex(const char *s)
+{
+    std::vector<uint8_t> out;
+    for (; s[0] && s[1]; s += 2)
+        out.push_back((uint8_t)strtoul(std::string(s, 2).c_str(), nullptr, 16));
+    return out;
+}
+
+TEST(SoftAesGcmTest, NistVectors)
+{
+    // McGrew & Viega, "The Galois/Counter Mode of Operation", test cases 1, 2, 4, 6 and 16
+    struct Vector
+    {
+        const char *key, *iv, *plain, *aad, *cipher, *tag;
+    } vectors[] = {
+        {"00000000000000000000000000000000", "000000000000000000000000", "", "", "",
+         "58e2fccefa7e3061367f1d57a4e7455a"},
+        {"00000000000000000000000000000000", "000000000000000000000000",
+         "00000000000000000000000000000000", "", "0388dace60b6a392f328c2b971b2fe78",
+         "ab6e47d42cec13bdf53a67b21257bddf"},
+        {"feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888",
+         "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+         "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+         "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091",
+         "5bc94fbc3221a5db94fae95ae7121a47"},
+        {"feffe9928665731c6d6a8f9467308308",
+         "9313225df88406e555909c5aff5269aa6a7a9538534f7da1e4c303d2a318a728c3c0c95156809539fcf0e2429a6b525416aedbf5a0de6a57a637b39b",
+         "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+         "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+         "8ce24998625615b603a033aca13fb894be9112a5c3a211a8ba262a3cca7e2ca701e4a9a4fba43c90ccdcb281d48c7c6fd62875d2aca417034c34aee5",
+         "619cc5aefffe0bfa462af43c1699d050"},
+        {"feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888",
+         "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+         "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+         "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662",
+         "76fc6ece0f4e1768cddf8853bb2d551b"},
+    };
+
+    for (const Vector &v : vectors)
+    {
+        auto key = fromHex(v.key), iv = fromHex(v.iv), plain = fromHex(v.plain);
+        auto aad = fromHex(v.aad), cipher = fromHex(v.cipher), tag = fromHex(v.tag);
+
+        SoftAesGcm gcm;
+        ASSERT_TRUE(gcm.setKey(key.data(), key.size() * 8));
+
+        std::vector<uint8_t> out(plain.size() + 1), outTag(16);
+        ASSERT_TRUE(gcm.encrypt(iv.data(), iv.size(), aad.data(), aad.size(), plain.data(), plain.size(),
+                                out.data(), outTag.data(), 16));
+        out.resize(plain.size());
+        EXPECT_EQ(out, cipher) << "key " << v.key;
+        EXPECT_EQ(outTag, tag) << "key " << v.key;
+
+        // truncated tag as on air, then a flipped bit must fail and leave no plaintext behind
+        std::vector<uint8_t> back(cipher.size() + 1);
+        EXPECT_TRUE(gcm.decrypt(iv.data(), iv.size(), aad.data(), aad.size(), cipher.data(), cipher.size(),
+                                tag.data(), TAG_LEN, back.data()));
+        back.resize(cipher.size());
+        EXPECT_EQ(back, plain);
+
+        if (!cipher.empty())
+        {
+            cipher[0] ^= 1;
+            EXPECT_FALSE(gcm.decrypt(iv.data(), iv.size(), aad.data(), aad.size(), cipher.data(), cipher.size(),
+                                     tag.data(), TAG_LEN, back.data()));
+            EXPECT_EQ(back, std::vector<uint8_t>(cipher.size(), 0));
+        }
+    }
+}
+
+TEST(AODVRouterTest, RelayForwardsCiphertextUntouched)
+{
+    MockRadioManager mockRadio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    AODVRouter AODVRouter(&mockRadio, nullptr, myID, nullptr, &notifier);
+    AODVRouter.updateRoute(5738, 600, 2);
+
+    // per-hop fields do not enter the nonce or AAD of a hop-invariant type
+    BaseHeader hop1{myID, 400, 400, 77, PKT_DATA, FLAG_ENCRYPTED, 1, 0, 9};
+    BaseHeader hop2 = hop1;
+    hop2.destNodeID = 600;
+    hop2.prevHopID = myID;
+    hop2.hopCount = 2;
+    uint8_t n1[NONCE_LEN], n2[NONCE_LEN], a1[sizeof(BaseHeader)], a2[sizeof(BaseHeader)];
+    buildNonce(hop1, n1);
+    buildNonce(hop2, n2);
+    EXPECT_EQ(memcmp(n1, n2, NONCE_LEN), 0);
+    ASSERT_EQ(buildAad(hop1, a1), buildAad(hop2, a2));
+    EXPECT_EQ(memcmp(a1, a2, buildAad(hop1, a1)), 0);
+    hop1.packetType = hop2.packetType = PKT_RREQ;
+    buildNonce(hop1, n1);
+    buildNonce(hop2, n2);
+    EXPECT_NE(memcmp(n1, n2, NONCE_LEN), 0) << "Rebuilt types stay bound to the hop";
+
+    // an encrypted DATA frame passing through us
+    BaseHeader bh{myID, 400, 400, 77, PKT_DATA, FLAG_ENCRYPTED, 1, 0, 9};
+    DATAHeader dh{5738};
+    uint8_t body[] = {'h', 'e', 'l', 'l', 'o'};
+    const uint8_t tag[TAG_LEN] = {0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8};
+    RadioPacket packet;
+    size_t len = serialiseBaseHeader(bh, packet.data);
+    memcpy(packet.data + len, &dh, sizeof(dh));
+    len += sizeof(dh);
+    memcpy(packet.data + len, body, sizeof(body));
+    len += sizeof(body);
+    memcpy(packet.data + len, tag, TAG_LEN);
+    packet.len = len + TAG_LEN;
+    std::vector<uint8_t> onAir(packet.data + sizeof(BaseHeader), packet.data + packet.len);
+
+    AODVRouter.handlePacket(&packet);
+
+    ASSERT_EQ(mockRadio.txPacketsSent.size(), 1u);
+    const std::vector<uint8_t> &out = mockRadio.txPacketsSent[0].data;
+    BaseHeader fwd;
+    deserialiseBaseHeader(out.data(), fwd);
+    EXPECT_EQ(fwd.destNodeID, 600u);
+    EXPECT_EQ(fwd.prevHopID, myID);
+    EXPECT_EQ(fwd.hopCount, 2);
+    EXPECT_EQ(fwd.flags, FLAG_ENCRYPTED);
+    EXPECT_EQ(fwd.originSeq, 9);
+    EXPECT_EQ(std::vector<uint8_t>(out.begin() + sizeof(BaseHeader), out.end()), onAir)
+        << "Ciphertext and tag should be relayed as received";
+    EXPECT_EQ(AODVRouter.getRxFilterStats().relayedSealed, 1u);
+}
+
+TEST(AODVRouterTest, ForwardSharesOneFrame)
+{
+    // a radio that queues the frame itself, as RadioManager does
+    struct QueueingRadio : MockRadioManager
+    {
+        std::vector<RadioPacket *> queued;
+        bool enqueueTxFrame(RadioPacket *frame) override
+        {
+            queued.push_back(frame);
+            return true;
+        }
+    } radio;
+    MockClientNotifier notifier;
+    uint32_t myID = 100;
+    FramePool &pool = FramePool::instance();
+    FramePoolStats before = pool.stats();
+    {
+        AODVRouter AODVRouter(&radio, nullptr, myID, nullptr, &notifier);
+        AODVRouter.updateRoute(5738, 600, 2);
+        AODVRouter.updateRoute(600, 600, 1);
+        size_t mallocs = stubPortMallocCalls();
+
+        // an encrypted DATA frame that wants an ACK, read off the air into the pool
+        RadioPacket *rx = pool.alloc();
+        ASSERT_NE(rx, nullptr);
+        BaseHeader bh{myID, 400, 400, 77, PKT_DATA, FLAG_ENCRYPTED | REQ_ACK, 1, 0, 9};
+        DATAHeader dh{5738};
+        size_t len = serialiseBaseHeader(bh, rx->data);
+        memcpy(rx->data + len, &dh, sizeof(dh));
+        len += sizeof(dh);
+        memset(rx->data + len, 0, TAG_LEN);
+        rx->len = len + TAG_LEN;
+
+        AODVRouter.handlePacket(rx);
+        pool.release(rx); // routerTask is done with it
+
+        ASSERT_EQ(radio.queued.size(), 2u) << "Per-hop ACK, then the relayed frame";
+        EXPECT_EQ(radio.queued[1], rx) << "The received buffer itself should go out";
+        EXPECT_EQ(pool.refs(rx), 2) << "Held by the TX queue and the ACK buffer";
+        EXPECT_EQ(AODVRouter.ackBuffer.at(77).frame, rx);
+        EXPECT_EQ(pool.stats().allocs - before.allocs, 2u) << "The RX frame and our ACK, nothing else";
+        EXPECT_EQ(pool.stats().copies, before.copies);
+        EXPECT_EQ(stubPortMallocCalls(), mallocs) << "Forwarding should not touch the heap";
+
+        // sent, then heard relayed by the next hop: every reference goes
+        for (RadioPacket *frame : radio.queued)
+            pool.release(frame);
+        EXPECT_TRUE(AODVRouter.tryImplicitAck(77));
+        EXPECT_EQ(pool.stats().inUse, before.inUse);
+    }
+}
+
+TEST(FramePoolTest, ExhaustionAndHighWatermark)
+{
+    FramePool &pool = FramePool::instance();
+    FramePoolStats before = pool.stats();
+
+    std::vector<RadioPacket *> held;
+    while (RadioPacket *p = pool.alloc())
+        held.push_back(p);
+
+    EXPECT_EQ(held.size(), FramePool::capacity() - before.inUse);
+    EXPECT_EQ(pool.stats().peak, FramePool::capacity());
+    EXPECT_EQ(pool.stats().exhausted, before.exhausted + 1);
+    EXPECT_EQ(pool.alloc(), nullptr);
+    EXPECT_EQ(pool.stats().exhausted, before.exhausted + 2);
+
+    for (RadioPacket *p : held)
+        pool.release(p);
+    EXPECT_EQ(pool.stats().inUse, before.inUse);
+    EXPECT_NE(pool.alloc(), nullptr) << "Frames should be back in the pool";
+}
+
+TEST(FramePoolTest, ConcurrentAllocFree)
+{
+    FramePool &pool = FramePool::instance();
+    FramePoolStats before = pool.stats();
+    const int THREADS = 4;
+    const int ROUNDS = 50000;
+    const size_t HOLD = 12; // per thread, so together they run the pool dry
+
+    // one owner per frame: a frame handed out twice at once trips this
+    std::vector<std::atomic<int>> owner(FramePool::capacity());
+    for (auto &o : owner)
+        o.store(-1);
+    std::atomic<uint32_t> doubleHanded{0}, corrupted{0}, allocated{0};
+
+    auto worker = [&](int id)
+    {
+        std::vector<RadioPacket *> mine;
+        for (int r = 0; r < ROUNDS; ++r)
+        {
+            if (mine.size() < HOLD && r % 4 != 3)
+            {
+                RadioPacket *p = pool.alloc();
+                if (p)
+                {
+                    ++allocated;
+                    int none = -1;
+                    if (!owner[pool.index(p)].compare_exchange_strong(none, id))
+                        ++doubleHanded;
+                    memset(p->data, id, 16);
+                    p->len = 16;
+                    pool.retain(p); // a second holder, as the ACK buffer would be
+                    mine.push_back(p);
+                }
+            }
+            else if (!mine.empty())
+            {
+                RadioPacket *p = mine[r % mine.size()];
+                mine.erase(mine.begin() + r % mine.size());
+                for (int b = 0; b < 16; ++b)
+                    corrupted += p->data[b] != (uint8_t)id;
+                pool.release(p);
+                owner[pool.index(p)].store(-1);
+                pool.release(p);
+            }
+        }
+        for (RadioPacket *p : mine)
+        {
+            owner[pool.index(p)].store(-1);
+            pool.release(p);
+            pool.release(p);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t)
+        threads.emplace_back(worker, t);
+    for (auto &t : threads)
+        t.join();
+
+    FramePoolStats after = pool.stats();
+    EXPECT_EQ(doubleHanded.load(), 0u);
+    EXPECT_EQ(corrupted.load(), 0u);
+    EXPECT_EQ(after.allocs - before.allocs, allocated.load());
+    EXPECT_EQ(after.frees - before.frees, allocated.load());
+    EXPECT_EQ(after.inUse, before.inUse);
+    EXPECT_LE(after.peak, FramePool::capacity());
+
+    // every frame is back on the free list exactly once
+    std::vector<RadioPacket *> all;
+    while (RadioPacket *p = pool.alloc())
+        all.push_back(p);
+    EXPECT_EQ(all.size(), FramePool::capacity() - before.inUse);
+    for (RadioPacket *p : all)
+        pool.release(p);
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -1011,4 +2704,4 @@ int main(int argc, char **argv)
         ;
     // Always return zero-code and allow PlatformIO to parse results
     return 0;
-}
\ No newline at end of file
+}